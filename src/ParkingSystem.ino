@@ -1,377 +1,1107 @@
 #include "config.h"
 #include "modules/Barrier.h"
 #include "modules/SlotSensor.h"
+#include "modules/RemoteSlotSensor.h"
 #include "modules/Platform.h"
 #include "modules/Display.h"
 #include "modules/BluetoothCmd.h"
 #include "modules/Timer.h"
+#include "modules/Scheduler.h"
+#include "modules/Clock.h"
+#include "modules/I2cBus.h"
+#include "modules/SlotAllocator.h"
+#include "modules/Session.h"
+#include "modules/IrSensors.h"
+#include "modules/FastPin.h"
+#include "modules/Profiler.h"
+#include "modules/SerialReport.h"
+#include "modules/SessionJournal.h"
+#include "modules/Analytics.h"
+#include "modules/Annunciator.h"
+#include "modules/StateMachine.h"
+#include "modules/TraceRecorder.h"
+#include "modules/Telemetry.h"
 
 // --- Module Objects ---
 Barrier barrier;
+#if SLOT_SENSOR_REMOTE
+RemoteSlotSensor slotSensor; // Slots ranged by the sensor board, read over I2C on change
+#else
 SlotSensor slotSensor;
+#endif
 Platform platform;
 Display display;
 BluetoothCmd bluetoothCmd;
 ParkingTimer parkingTimer;
+Scheduler scheduler;
+SlotAllocator slotAllocator;
+IrSensors irSensors;
+SerialReport serialReport; // Non-blocking multi-line replies (STATUS, STATS, JOURNAL, TRACE)
+SessionJournal journal;    // Parking history in EEPROM, running sessions survive a reset
+ParkingAnalytics analytics; // Dwell/occupancy statistics, updated per park/departure
+Annunciator annunciator;    // Buzzer and LED patterns, played from a scheduled edge task
+Telemetry telemetry;        // Binary status stream (TELEMETRY <ms>), shares the port with serialReport
 
-// --- State Machine Definition ---
-enum SystemState {
+// Buzzer pin with compile-time port access
+typedef FastPin<PIN_BUZZER> Buzzer;
+
+// --- Annunciator Channels & Patterns ---
+enum AnnunciatorChannel : uint8_t {
+    ANNUNCIATOR_BUZZER = 0,
+    ANNUNCIATOR_GUIDE_LED // Green LED of the guided car's slot
+};
+static_assert(ANNUNCIATOR_GUIDE_LED < ANNUNCIATOR_CHANNELS, "ANNUNCIATOR_CHANNELS too small");
+constexpr AnnunciatorPattern BEEP_READY = annunciatorPattern(TONE_READY, 1);
+constexpr AnnunciatorPattern BEEP_ARRIVAL = annunciatorPattern(TONE_ARRIVAL, 1);
+constexpr AnnunciatorPattern BEEP_ADMIT = annunciatorPattern(TONE_ADMIT, 1, ANNUNCIATE_NOTICE);
+constexpr AnnunciatorPattern BEEP_FULL = annunciatorPattern(TONE_FULL, 1, ANNUNCIATE_ALERT);
+constexpr AnnunciatorPattern BEEP_PARKED = annunciatorPattern(TONE_PARKED, 1, ANNUNCIATE_NOTICE);
+constexpr AnnunciatorPattern BEEP_EXIT = annunciatorPattern(TONE_EXIT, 1, ANNUNCIATE_NOTICE);
+constexpr AnnunciatorPattern CHIRP_GUIDE = annunciatorPattern(TONE_GUIDE, 0); // Background until parked
+constexpr AnnunciatorPattern FLASH_GUIDE_LED = annunciatorPattern(FLASH_GUIDE, 0);
+
+// --- Vehicle Sessions ---
+// Every car in the garage has its own session (slot, phase, parking time), so
+// the entry lane, the platform and the exit lane can each work on a different car.
+SessionTable sessions;
+// Parked cars restored from the journal at boot, until their slot reading confirms them
+SlotMask restoredMask = 0;
+Deadline restoreConfirmDeadline;
+
+// --- Entry Lane State Machine ---
+// Table-driven (see ENTRY_TRANSITIONS below): beam edges, allocation results
+// and freed space are events, the tables say what each one does per state.
+enum SystemState : uint8_t {
     IDLE,
     WEIGHT_CHECK, // Renamed from docs for clarity (IR check)
     BARRIER_OPEN,
-    PLATFORM_ALIGN,
-    GUIDE,
-    PARKED,
-    EXIT,
     FULL
 };
-SystemState currentState = IDLE;
-int targetSlot = -1; // To store the assigned slot index
-
-// --- IR Sensor Debouncing ---
-// Entry Sensor
-int irEntryState = HIGH;           // Current reading
-int lastIrEntryState = HIGH;       // Previous reading
-unsigned long lastEntryDebounceTime = 0; // Last time input pin was toggled
-bool entryTriggered = false;       // Debounced state change flag (LOW -> HIGH)
-bool vehicleEntered = false;     // Debounced state change flag (HIGH -> LOW)
-
-// Exit Sensor
-int irExitState = HIGH;
-int lastIrExitState = HIGH;
-unsigned long lastExitDebounceTime = 0;
-bool exitTriggered = false;       // Debounced state change flag (LOW -> HIGH)
-bool vehicleExited = false;      // Debounced state change flag (HIGH -> LOW)
+const uint8_t ENTRY_STATE_COUNT = FULL + 1;
+static_assert(ENTRY_STATE_COUNT <= PROFILE_STATES, "PROFILE_STATES (config.h) must cover every SystemState");
+enum EntryEvent : uint8_t {
+    ENTRY_TIMEOUT = FSM_EVENT_TIMEOUT,
+    ENTRY_CAR_ARRIVED,  // Entry beam triggered
+    ENTRY_CAR_PASSED,   // Entry beam cleared behind the car
+    ENTRY_BARRIER_FREE, // Barrier not held by the exit lane (WEIGHT_CHECK entry, exit lane release)
+    ENTRY_SLOT_FOUND,   // Slot reserved, session opened
+    ENTRY_NO_SLOT,      // No slot or session table full
+    ENTRY_SPACE_FREED,  // A slot or a session table entry became free
+    ENTRY_EVENT_COUNT
+};
+int8_t entrySession = -1; // Session being admitted at the entry barrier
+
+// --- Exit Lane State Machine ---
+enum ExitState {
+    EXIT_IDLE,
+    EXIT_MATCH, // Exit beam triggered, waiting for a departing session and the barrier
+    EXIT_OPEN   // Barrier open, waiting for the car to pass
+};
+ExitState exitState = EXIT_IDLE;
+int8_t exitSession = -1;    // Session leaving through the barrier (-1 = car without a departed session)
+uint8_t unmatchedExits = 0; // Cars let out before their slot read free
+unsigned long lostDepartures = 0; // Cars that left their slot while the session table was full
+
+// --- Shared Resources ---
+// One barrier serves both lanes; whoever opened it keeps it until their car has passed
+enum BarrierUser {
+    BARRIER_FREE,
+    BARRIER_ENTRY,
+    BARRIER_EXIT
+};
+BarrierUser barrierUser = BARRIER_FREE;
+int8_t platformSession = -1; // Session aligning/guiding on the platform (one at a time)
+
+// --- LCD ---
+// The screen shows the latest event of the entry lane, the platform or the exit lane
+enum Screen {
+    SCREEN_ENTRY,
+    SCREEN_SESSION,
+    SCREEN_EXIT
+};
+Screen currentScreen = SCREEN_ENTRY;
+int8_t screenSession = -1; // Session shown on SCREEN_SESSION
+
+// --- Non-blocking timing for the state machine ---
+Deadline guideCheckDeadline;  // Next slot sensor check while guiding
+Deadline exitMatchDeadline;   // Give up waiting for a departing session
+int8_t annunciatorTask = Scheduler::INVALID_TASK; // Reserved task entry for the next annunciator edge
+int8_t restoreTask = Scheduler::INVALID_TASK;     // Pending screen restore after STATUS/SLOTS
+
+// --- Non-blocking slot ranging ---
+SlotMask slotScanMask = 0;  // Slots waiting for a fresh scan (0 = nothing requested)
+SlotMask ledFreeMask = 0;   // Available mask currently shown on the slot LEDs
+int8_t ledGuideSlot = -1;   // Slot currently flashing for the guided car
+bool ledsPending = false;   // Force an LED refresh (session or lane changed)
+bool guideScanPending = false; // GUIDE: target slot measurement in flight
 
 // --- Forward Declarations for Bluetooth Callbacks ---
-void handleRotateCommand(int angle);
-void handleStatusCommand();
+void handleRotateCommand(const int16_t* args, uint8_t argc);
+void handleStatusCommand(const int16_t* args, uint8_t argc);
+void handlePolicyCommand(const int16_t* args, uint8_t argc);
+void handleSlotsCommand(const int16_t* args, uint8_t argc);
+void handleStatsCommand(const int16_t* args, uint8_t argc);
+void handleJournalCommand(const int16_t* args, uint8_t argc);
+void handleAnalyticsCommand(const int16_t* args, uint8_t argc);
+void handleFsmCommand(const int16_t* args, uint8_t argc);
+void handleTraceCommand(const int16_t* args, uint8_t argc);
+void handleTelemetryCommand(const int16_t* args, uint8_t argc);
+
+// --- Bluetooth Command Table ---
+// Text: "<NAME> [args]\n". Binary frames use the table index as opcode,
+// so only append new commands at the end.
+constexpr BluetoothCommand BT_COMMANDS[] = {
+    {"ROTATE", 1, handleRotateCommand}, // ROTATE <deg>
+    {"STATUS", 0, handleStatusCommand}, // STATUS
+    {"START", 0, nullptr},              // START (handler not implemented yet)
+    {"POLICY", 1, handlePolicyCommand}, // POLICY <0..3> (see SLOT_ALLOCATION_POLICY)
+    {"SLOTS", 0, handleSlotsCommand},   // SLOTS (slot count, per-slot RAM, allocation time)
+    {"STATS", 0, handleStatsCommand},   // STATS (allocation savings, command/LCD/I2C counters, profiling probes)
+    {"JOURNAL", 0, handleJournalCommand}, // JOURNAL (binary export of the session journal)
+    {"ANALYTICS", 0, handleAnalyticsCommand}, // ANALYTICS (dwell, occupancy, arrivals, utilisation)
+    {"FSM", 0, handleFsmCommand},       // FSM (entry lane transition table with hit counts)
+    {"TRACE", 0, handleTraceCommand},   // TRACE (binary export of the input/transition trace)
+    {"TELEMETRY", 1, handleTelemetryCommand}, // TELEMETRY <ms> (binary status frames every ms, 0 = off)
+};
+const uint8_t BT_COMMAND_COUNT = sizeof(BT_COMMANDS) / sizeof(BT_COMMANDS[0]);
 
 // --- Helper Functions ---
-void changeState(SystemState newState); // Function to handle state transitions
-void updateIrSensors();                // Function to read and debounce IR sensors
-void beep(int durationMs);
+void changeExitState(ExitState newState); // Exit lane state transitions
+void changeSessionPhase(int8_t index, SessionPhase phase); // Session phase transitions + entry actions
+void updateEntryLane();                // Entry lane: beam events and timeouts into the state machine
+void enterIdle();                      // Entry lane handlers (ENTRY_STATES / ENTRY_TRANSITIONS)
+void enterWeightCheck();
+void allocateEntrySlot();
+void enterBarrierOpen();
+void exitBarrierOpen();
+void queueEntryCar();
+void enterFull();
+bool entryHasSpace();
+void onEntryTransition(uint8_t from, uint8_t event, uint8_t to);
+void updateSessions();                 // Platform hand-over, parking and departures
+void updateExitLane();                 // Exit lane: let departing cars out
+void updateSlotLeds();                 // Slot LEDs from the snapshot and reservations
+SlotMask availableSlots();             // Free on the sensors, not reserved and not parked in
+void showStateMessage(SystemState state); // Draw the LCD screen for an entry lane state
+void showSessionMessage(int8_t index); // Draw the LCD screen for a session phase
+void showExitMessage();                // Draw the LCD screen for the exit lane
+void restoreStateMessage();            // Redraw the screen for the current state
+void holdCommandScreen();              // Keep a command's LCD message up, then restore the screen
+void restoreScreenTask();              // Scheduler task behind holdCommandScreen()
+bool statusReportLine(uint8_t index, char* line, uint8_t size); // STATUS reply lines
+bool statsReportLine(uint8_t index, char* line, uint8_t size);  // STATS reply lines
+uint8_t journalExportFrame(uint8_t index, uint8_t* frame, uint8_t size); // JOURNAL reply frames
+bool analyticsReportLine(uint8_t index, char* line, uint8_t size); // ANALYTICS reply lines
+void confirmRestoredSessions();        // Close restored sessions whose slot turned out empty
+bool takeIrEvent(IrChannel channel, IrEdge edge); // Next debounced IR event with this edge
+void pollBluetooth();                  // Scheduler task: check for Bluetooth commands
+void refreshSlotSnapshot();            // Scheduler task: refresh one slot of the snapshot
+void refreshDisplay();                 // Scheduler task: push changed LCD cells
+void updatePlatform();                 // Scheduler task: step the platform motion profile
+void requestSlotScan(SlotMask slotMask = ALL_SLOTS_MASK); // Ask for fresh readings
+bool slotScanReady();                  // True once requested readings are available
+void annunciate(uint8_t channel, const AnnunciatorPattern& pattern); // Start a pattern, returns at once
+void silence(uint8_t channel, const AnnunciatorPattern& pattern);    // Stop a pattern
+void scheduleAnnunciator();            // Play due edges, re-arm the edge task
+void annunciatorEdge();                // Scheduler task: next annunciator edge
+void annunciatorOutput(uint8_t channel, bool on); // Buzzer pin / guided slot LED
+bool entryLaneReportLine(uint8_t index, char* line, uint8_t size); // FSM reply lines
+void telemetrySample(TelemetrySample& sample);       // TELEMETRY: lane states, cars
+void telemetrySlot(uint8_t slot, TelemetrySlot& out); // TELEMETRY: one slot
+
+// --- Entry Lane Tables ---
+// Checked at compile time (fsmTableValid): keep the rows sorted by state, then event.
+constexpr FsmState ENTRY_STATES[ENTRY_STATE_COUNT] = {
+    // name          enter             tick     exit             timeout
+    {"IDLE",         enterIdle,        nullptr, nullptr,         0},
+    {"WEIGHT_CHECK", enterWeightCheck, nullptr, nullptr,         0},
+    {"BARRIER_OPEN", enterBarrierOpen, nullptr, exitBarrierOpen, 0},
+    {"FULL",         enterFull,        nullptr, nullptr,         FULL_TIMEOUT_MS},
+};
+const char* const ENTRY_EVENT_NAMES[ENTRY_EVENT_COUNT] = {
+    "TIMEOUT", "CAR_ARRIVED", "CAR_PASSED", "BARRIER_FREE", "SLOT_FOUND", "NO_SLOT", "SPACE_FREED"};
+constexpr FsmTransition ENTRY_TRANSITIONS[] = {
+    // from        event               guard          to            action
+    {IDLE,         ENTRY_CAR_ARRIVED,  nullptr,       WEIGHT_CHECK, nullptr},
+    {WEIGHT_CHECK, ENTRY_BARRIER_FREE, nullptr,       FSM_INTERNAL, allocateEntrySlot},
+    {WEIGHT_CHECK, ENTRY_SLOT_FOUND,   nullptr,       BARRIER_OPEN, nullptr},
+    {WEIGHT_CHECK, ENTRY_NO_SLOT,      nullptr,       FULL,         nullptr},
+    {BARRIER_OPEN, ENTRY_CAR_PASSED,   nullptr,       IDLE,         queueEntryCar},
+    {FULL,         ENTRY_TIMEOUT,      nullptr,       IDLE,         nullptr},
+    {FULL,         ENTRY_SPACE_FREED,  entryHasSpace, IDLE,         nullptr},
+};
+const uint8_t ENTRY_TRANSITION_COUNT = sizeof(ENTRY_TRANSITIONS) / sizeof(ENTRY_TRANSITIONS[0]);
+static_assert(fsmTableValid(ENTRY_TRANSITIONS, ENTRY_TRANSITION_COUNT, ENTRY_STATE_COUNT, ENTRY_EVENT_COUNT),
+              "ENTRY_TRANSITIONS: state/event out of range or rows not sorted");
+StateMachine<ENTRY_STATE_COUNT, ENTRY_EVENT_COUNT, ENTRY_TRANSITION_COUNT> entryLane;
 
 // =================== SETUP ===================
 void setup() {
+    Clock::update(); // Everything below reads the time from this snapshot
+    TRACE_BOOT();
     // Module Setups
+    I2cBus::setup(); // Shared I2C queue (LCD, sensor board)
     display.setup(); // Setup display first for messages
     barrier.setup();
     slotSensor.setup();
     platform.setup();
-    // parkingTimer doesn't need a setup unless linked to display
-    bluetoothCmd.setup(handleRotateCommand, handleStatusCommand); // Pass callbacks
+    // Cars that were parked when the power went keep their running timers
+    restoredMask = journal.setup(parkingTimer);
+    sessions.continueIds(journal.lastSession());
+    restoreConfirmDeadline.set(JOURNAL_RESTORE_CONFIRM_MS);
+    analytics.setup(journal.nowS(), restoredMask);
+    bluetoothCmd.setup(BT_COMMANDS, BT_COMMAND_COUNT); // Pass command table
+    telemetry.setup(telemetrySample, telemetrySlot);
 
-    // Initialize IR Sensor Pins
-    pinMode(PIN_IR_ENTRY, INPUT_PULLUP); // Use internal pull-up if needed
-    pinMode(PIN_IR_EXIT, INPUT_PULLUP);
+    // IR beams: edges are captured by the pin-change interrupt
+    irSensors.setup();
 
     // Initialize Buzzer Pin
-    pinMode(PIN_BUZZER, OUTPUT);
-    digitalWrite(PIN_BUZZER, LOW);
+    Buzzer::output();
+    Buzzer::low();
+    annunciator.setup(annunciatorOutput);
+    // Its own task entry, taken before the others: a full table must not leave a pattern on
+    annunciatorTask = scheduler.reserve(annunciatorEdge);
+
+    // Background tasks
+    scheduler.every(BT_POLL_PERIOD_MS, pollBluetooth);
+    scheduler.every(SLOT_REFRESH_PERIOD_MS, refreshSlotSnapshot);
+    scheduler.every(DISPLAY_REFRESH_MS, refreshDisplay);
+    scheduler.every(PLATFORM_TICK_MS, updatePlatform);
+
+    // Prime the occupancy snapshot with one full scan
+    slotSensor.startScan();
 
     // Initial State
-    changeState(IDLE);
+    entryLane.setup(ENTRY_STATES, ENTRY_TRANSITIONS, ENTRY_EVENT_NAMES, IDLE, onEntryTransition);
 
     // Short beep to indicate system ready
-    beep(100);
+    annunciate(ANNUNCIATOR_BUZZER, BEEP_READY);
 }
 
 // =================== LOOP ===================
 void loop() {
-    // 1. Check Inputs
-    updateIrSensors();       // Read and debounce IR sensors
-    bluetoothCmd.checkCommands(); // Check for Bluetooth commands
+    // 0. One time snapshot for the whole pass (64-bit, does not wrap)
+    Clock::update();
+    PROFILE_SCOPE(PROBE_LOOP);
+    // 1. Run due background tasks (Bluetooth polling, annunciator edges)
+    scheduler.run();
+    // IR edges captured by the interrupt: debounce and queue entry/exit events
+    irSensors.update();
+    // I2C completions (LCD row transfers, sensor board reads)
+    I2cBus::poll();
+    // Pending STATUS/STATS reply and telemetry: as much as fits in the serial
+    // TX buffer. Neither starts while the other is halfway through a line/frame.
+    if (!telemetry.isSending()) serialReport.update();
+    telemetry.update(serialReport.isBusy());
+    // Journal clock and EEPROM writes (one byte when the EEPROM is ready)
+    journal.update();
+    // Ranging engine: fire triggers, publish echo results
+    slotSensor.update();
+    if (slotScanMask && slotSensor.startScan(slotScanMask)) {
+        slotScanMask = 0;
+    }
 
-    // 2. Run State Machine Logic
-    switch (currentState) {
-        case IDLE:
-            // Entry: Display "Waiting"
-            // Exit Condition: Entry IR Triggered (LOW -> HIGH)
-            if (entryTriggered) {
-                changeState(WEIGHT_CHECK);
-            }
-            break;
+    // 2. Run State Machine Logic (the lanes and the platform progress independently)
+    updateEntryLane();
+    updateSessions();
+    updateExitLane();
+    updateSlotLeds();
+}
 
-        case WEIGHT_CHECK:
-            // Entry: Check for free slot
-            targetSlot = slotSensor.findFirstFreeSlot();
-            if (targetSlot != -1) { // Free slot found
-                 changeState(BARRIER_OPEN);
-            } else { // No slots free
-                changeState(FULL);
-            }
-            break;
+// =================== STATE MACHINES ===================
 
-        case BARRIER_OPEN:
-            // Entry: Open barrier, Display "Welcome"
-            // Exit Condition: Vehicle passes Entry IR (HIGH -> LOW)
-            if (vehicleEntered) {
-                barrier.close(); // Close barrier after vehicle passes
-                 changeState(PLATFORM_ALIGN);
-            }
-            break;
+// --- Entry Lane ---
+// Debounced entry beam edges become events; the table decides what they mean
+// in the current state (edges the state does not wait for are dropped). While
+// a car waits in WEIGHT_CHECK for the exit lane its edges stay queued for
+// BARRIER_OPEN.
+void updateEntryLane() {
+    IrEvent event;
+    while (entryLane.state() != WEIGHT_CHECK && irSensors.peek(IR_ENTRY, event)) {
+        irSensors.pop(IR_ENTRY);
+        entryLane.dispatch(event.edge == IR_TRIGGERED ? ENTRY_CAR_ARRIVED : ENTRY_CAR_PASSED);
+    }
+    entryLane.update(); // FULL timeout
+}
 
-        case PLATFORM_ALIGN:
-            // Entry: Rotate platform to target slot
-            // TODO: Handle rotation failure? (platform.rotateToSlot returns bool)
-            platform.rotateToSlot(targetSlot);
-            // Exit Condition: Rotation presumed complete (blocking call)
-            changeState(GUIDE);
-            break;
+// Entry and transition actions of ENTRY_STATES / ENTRY_TRANSITIONS. Each one
+// runs once per event and returns at once; results come back as events.
+void enterIdle() {
+    ledsPending = true; // Slot LEDs are refreshed from the snapshot in loop()
+}
 
-        case GUIDE:
-            // Entry: Flash target slot GREEN LED, short beeps
-            // (Flashing/beeps need non-blocking implementation or happen once)
-            display.setSlotLED(targetSlot, FLASHING_GREEN); // Note: Currently just turns ON green
-            beep(50);
-            // Exit Condition: Slot sensor detects vehicle (distance < threshold)
-            // Add a short delay to prevent immediate trigger if sensor reading fluctuates
-            delay(100); 
-            if (!slotSensor.isSlotFree(targetSlot)) {
-                 changeState(PARKED);
-            }
-            break;
+void enterWeightCheck() {
+    annunciate(ANNUNCIATOR_BUZZER, BEEP_ARRIVAL);
+    // While the exit lane holds the barrier, its release sends ENTRY_BARRIER_FREE
+    if (barrierUser != BARRIER_EXIT) entryLane.post(ENTRY_BARRIER_FREE);
+}
+
+// Choose a free slot (allocation policy over the occupancy snapshot), once per car.
+// The platform may still be busy with another car, so plan from where it will end up.
+void allocateEntrySlot() {
+    int8_t slot = -1;
+    if (!sessions.isFull()) {
+        slot = slotAllocator.allocate(availableSlots(), platform.targetAngle());
+    }
+    analytics.recordArrival(journal.nowS(), slot != -1);
+    if (slot != -1) {
+        entrySession = sessions.open(slot);
+        entryLane.post(ENTRY_SLOT_FOUND);
+    } else {
+        entryLane.post(ENTRY_NO_SLOT);
+    }
+}
+
+void enterBarrierOpen() {
+    barrierUser = BARRIER_ENTRY;
+    barrier.open(); // Returns immediately, servo keeps moving
+    ledsPending = true;
+    annunciate(ANNUNCIATOR_BUZZER, BEEP_ADMIT);
+}
+
+void exitBarrierOpen() {
+    barrier.close(); // Close barrier after vehicle passes
+    barrierUser = BARRIER_FREE;
+}
+
+void queueEntryCar() {
+    changeSessionPhase(entrySession, SESSION_QUEUED); // Platform picks it up
+    entrySession = -1;
+}
 
-        case PARKED:
-            // Entry: Set slot LED RED, start timer
+// A car at the gate has to trigger the beam again once there is space
+void enterFull() {
+    annunciate(ANNUNCIATOR_BUZZER, BEEP_FULL); // Longer beep for full
+}
+
+bool entryHasSpace() {
+    return availableSlots() != 0 && !sessions.isFull();
+}
+
+void onEntryTransition(uint8_t, uint8_t, uint8_t to) {
+    if (to == FSM_INTERNAL) return;
+    // Serial.print("State Change: "); Serial.println(entryLane.stateName(to));
+    PROFILE_STATE(to);
+    TRACE_STATE(TRACE_ENTRY_LANE, 0, to);
+    showStateMessage((SystemState)to);
+}
+
+// --- Platform and Parked Vehicles ---
+void updateSessions() {
+    // The platform serves one car at a time, in the order they passed the entry barrier
+    if (platformSession < 0) {
+        platformSession = sessions.oldest(SESSION_QUEUED);
+        if (platformSession >= 0) {
+            changeSessionPhase(platformSession, SESSION_ALIGNING);
+        }
+    }
+
+    if (platformSession >= 0) {
+        Session& session = sessions[platformSession];
+        switch (session.phase) {
+            case SESSION_ALIGNING:
+                // Exit Condition: Profile finished (immediately if already facing the slot)
+                if (platform.isRotationComplete()) {
+                    changeSessionPhase(platformSession, SESSION_GUIDING);
+                }
+                break;
+
+            case SESSION_GUIDING:
+                // Chirps and the flashing slot LED run on the annunciator
+                // Exit Condition: Slot sensor detects vehicle (distance < threshold)
+                // Checked on an interval to prevent immediate trigger if sensor reading fluctuates
+                if (guideCheckDeadline.expired()) {
+                    guideCheckDeadline.set(GUIDE_CHECK_INTERVAL_MS);
+                    requestSlotScan(slotBit(session.slot));
+                    guideScanPending = true;
+                }
+                if (guideScanPending && slotScanReady()) {
+                    guideScanPending = false;
+                    if (!slotSensor.isSlotFree(session.slot)) {
+                        changeSessionPhase(platformSession, SESSION_PARKED);
+                        platformSession = -1; // Platform is free for the next car
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (restoredMask) {
+        confirmRestoredSessions();
+    }
+
+    // A parked car whose slot reads free again is on its way out
+    // (the snapshot is kept fresh by the background refresh task).
+    // Parked cars are the running timers, so this is one mask test however many slots there are.
+    for (SlotMask departed = parkingTimer.runningMask & slotSensor.freeMask() & ~restoredMask; departed;
+         departed &= departed - 1) {
+        int8_t slot = lowestSlot(departed);
+        uint16_t id = parkingTimer.sessionId[slot];
+        parkingTimer.stop(slot);
+        uint32_t parkedS = parkingTimer.durationS(slot); // Kept with the session for the exit screen
+        parkingTimer.reset(slot);
+        journal.recordEnd(slot, id, parkedS);
+        analytics.recordDeparture(slot, parkedS, journal.nowS());
+        ledsPending = true;
+        if (unmatchedExits > 0) {
+            // This car already went through the exit before its slot read free
+            unmatchedExits--;
+            continue;
+        }
+        if (sessions.resume(slot, id, parkedS) < 0) {
+            lostDepartures++; // Its exit will be let out unmatched
+        }
+    }
+}
+
+// Restored timers stay out of the departure check until the slot has a
+// decided reading: right after boot an unmeasured slot reads free. A slot
+// that is empty by then lost its car while the power was off, so there is
+// no one to let out; the session is closed in the journal only.
+void confirmRestoredSessions() {
+    bool timeout = restoreConfirmDeadline.expired();
+    for (SlotMask pending = restoredMask; pending; pending &= pending - 1) {
+        int8_t slot = lowestSlot(pending);
+        if (!timeout && slotSensor.confidence(slot) < SLOT_FILTER_MIN_VALID) continue;
+        restoredMask &= ~slotBit(slot);
+        if (slotSensor.freeMask() & slotBit(slot)) {
+            journal.recordEnd(slot, parkingTimer.sessionId[slot], parkingTimer.durationS(slot),
+                              JOURNAL_FLAG_OFFLINE);
+            analytics.recordDeparture(slot, parkingTimer.durationS(slot), journal.nowS());
+            parkingTimer.reset(slot);
+            ledsPending = true;
+        }
+    }
+}
+
+// --- Exit Lane ---
+void updateExitLane() {
+    switch (exitState) {
+        case EXIT_IDLE:
             // Exit Condition: Exit IR Triggered (LOW -> HIGH)
-             if (exitTriggered) {
-                 changeState(EXIT);
-             }
+            if (takeIrEvent(IR_EXIT, IR_TRIGGERED)) {
+                changeExitState(EXIT_MATCH);
+            }
             break;
 
-        case EXIT:
-            // Entry: Open barrier, Stop timer, Show duration on LCD
-            {
-                unsigned long duration = parkingTimer.getDurationSeconds(targetSlot);
-                int hours = duration / 3600;
-                int mins = (duration % 3600) / 60;
-                int secs = duration % 60;
-                char timeStr[17];
-                snprintf(timeStr, sizeof(timeStr), "Slot %d %02d:%02d:%02d", targetSlot + 1, hours, mins, secs);
-                display.print("Park Duration:", 0);
-                display.print(timeStr, 1);
+        case EXIT_MATCH:
+            // The car at the exit is the one that left its slot first. If the slot
+            // sensors have not caught up yet, give them EXIT_MATCH_TIMEOUT_MS.
+            if (barrierUser == BARRIER_ENTRY) break; // Barrier busy with an entering car
+            exitSession = sessions.oldest(SESSION_DEPARTING);
+            if (exitSession >= 0 || exitMatchDeadline.expired()) {
+                changeExitState(EXIT_OPEN);
             }
+            break;
+
+        case EXIT_OPEN:
+            // Entry: Open barrier, Show duration on LCD (drawn once on entry)
             // Exit Condition: Vehicle passes Exit IR (HIGH -> LOW)
-            if (vehicleExited) {
+            if (takeIrEvent(IR_EXIT, IR_PASSED)) {
                 barrier.close();
-                display.setSlotLED(targetSlot, GREEN); // Reset slot LED
-                parkingTimer.reset(targetSlot); // Reset timer for the slot
-                targetSlot = -1; // Clear target slot
-                changeState(IDLE);
+                barrierUser = BARRIER_FREE;
+                sessions.close(exitSession);
+                exitSession = -1;
+                changeExitState(EXIT_IDLE);
+                entryLane.dispatch(ENTRY_BARRIER_FREE); // A car may be waiting at the entry
+                entryLane.dispatch(ENTRY_SPACE_FREED);
             }
             break;
+    }
+}
 
-        case FULL:
-            // Entry: Display "No Space"
-            // Exit Condition: Timeout (e.g., 5 seconds) OR a slot becomes free
-            // Simple timeout implementation:
-            {
-                static unsigned long fullStartTime = 0;
-                if (fullStartTime == 0) fullStartTime = millis();
-                
-                if (millis() - fullStartTime > 5000) { // 5 second timeout
-                    fullStartTime = 0; // Reset for next time
-                     changeState(IDLE);
-                }
-            }
-            // Check if a slot becomes free
-            if (slotSensor.findFirstFreeSlot() != -1) {
-                 changeState(IDLE); // Go back to IDLE if space opens up
-            }
-            break;
+// --- Slot LEDs ---
+// Green = free for the next car, flashing green = slot of the guided car, red otherwise
+void updateSlotLeds() {
+    SlotMask available = availableSlots();
+    if (available & ~ledFreeMask) {
+        entryLane.dispatch(ENTRY_SPACE_FREED); // Ends FULL early
+    }
+    int8_t guideSlot = -1;
+    if (platformSession >= 0 && sessions[platformSession].phase == SESSION_GUIDING) {
+        guideSlot = sessions[platformSession].slot;
+    }
+    if (!ledsPending && available == ledFreeMask && guideSlot == ledGuideSlot) return;
+
+    ledsPending = false;
+    ledFreeMask = available;
+    ledGuideSlot = guideSlot;
+    SlotMask green = available;
+    SlotMask red = ALL_SLOTS_MASK & ~available;
+    if (guideSlot >= 0) {
+        // Flashing green: the annunciator switches it and sets ledsPending on every edge
+        SlotMask bit = slotBit(guideSlot);
+        red &= ~bit;
+        if (annunciator.isOn(ANNUNCIATOR_GUIDE_LED)) {
+            green |= bit;
+        } else {
+            green &= ~bit;
+        }
     }
+    display.setSlotLEDs(green, red); // One pass over all slot LEDs
 
-    // 3. Small delay to prevent high-speed looping (optional)
-    delay(10); 
+    // Predictive policy: face the slot the next car will get,
+    // but only while nobody is waiting for the platform
+    if (entryLane.state() == IDLE && platformSession < 0 && sessions.count(SESSION_QUEUED) == 0) {
+        int8_t preposition = slotAllocator.prepositionSlot(available);
+        if (preposition >= 0) {
+            platform.rotateToSlot(preposition);
+        }
+    }
+}
+
+SlotMask availableSlots() {
+    return slotSensor.freeMask() & ~sessions.reservedMask() & ~parkingTimer.runningMask;
 }
 
 // =================== HELPER FUNCTIONS ===================
 
-// --- State Transition Handler ---
-void changeState(SystemState newState) {
-    if (currentState == newState) return; // No change
+// --- Exit Lane State Transition Handler ---
+void changeExitState(ExitState newState) {
+    if (exitState == newState) return;
+    exitState = newState;
+    TRACE_STATE(TRACE_EXIT_LANE, 0, newState);
 
-    // Serial.print("State Change: ");
-    // Serial.print(currentState); // Print previous state index
-    // Serial.print(" -> ");
-    // Serial.println(newState);   // Print new state index
+    switch (exitState) {
+        case EXIT_IDLE:
+            break;
+        case EXIT_MATCH:
+            exitMatchDeadline.set(EXIT_MATCH_TIMEOUT_MS);
+            break;
+        case EXIT_OPEN:
+            barrierUser = BARRIER_EXIT;
+            barrier.open();
+            if (exitSession >= 0) {
+                changeSessionPhase(exitSession, SESSION_EXITING);
+            } else {
+                unmatchedExits++; // Its session is closed once the slot reads free
+            }
+            annunciate(ANNUNCIATOR_BUZZER, BEEP_EXIT); // Double beep for exit
+            showExitMessage();
+            break;
+    }
+}
+
+// --- Session Phase Transition Handler ---
+void changeSessionPhase(int8_t index, SessionPhase phase) {
+    if (!sessions.isValid(index)) return;
+    Session& session = sessions[index];
+    if (session.phase == phase) return;
+
+    // Serial.print("Session "); Serial.print(session.id);
+    // Serial.print(": "); Serial.print(session.phase);
+    // Serial.print(" -> "); Serial.println(phase);
+
+    sessions.setPhase(index, phase);
+    TRACE_STATE(TRACE_SESSION, session.slot, phase);
+    ledsPending = true;
+
+    // Perform Entry Actions for the new phase
+    switch (phase) {
+        case SESSION_ALIGNING:
+            // TODO: Handle rotation failure? (platform.rotateToSlot returns bool)
+            platform.rotateToSlot(session.slot);
+            break;
+        case SESSION_GUIDING:
+            annunciate(ANNUNCIATOR_BUZZER, CHIRP_GUIDE);     // First chirp right away
+            annunciate(ANNUNCIATOR_GUIDE_LED, FLASH_GUIDE_LED);
+            guideCheckDeadline.set(GUIDE_CHECK_INTERVAL_MS); // Let the sensor reading settle first
+            guideScanPending = false;
+            break;
+        case SESSION_PARKED:
+            // The slot's timer takes over; the session comes back with resume() when the car leaves
+            parkingTimer.start(session.slot, session.id);
+            journal.recordStart(session.slot, session.id);
+            analytics.recordParked(session.slot, journal.nowS());
+            silence(ANNUNCIATOR_BUZZER, CHIRP_GUIDE);
+            silence(ANNUNCIATOR_GUIDE_LED, FLASH_GUIDE_LED);
+            annunciate(ANNUNCIATOR_BUZZER, BEEP_PARKED);
+            showSessionMessage(index);
+            sessions.close(index);
+            entryLane.dispatch(ENTRY_SPACE_FREED); // Session table entry free again
+            return;
+        default:
+            return; // No screen for the other phases
+    }
 
-    currentState = newState;
-    // Reset IR trigger flags on state change
-    entryTriggered = false;
-    vehicleEntered = false;
-    exitTriggered = false;
-    vehicleExited = false;
+    showSessionMessage(index);
+}
 
-    // Perform Entry Actions for the new state
-    switch (currentState) {
+// --- LCD Screen per State ---
+void showStateMessage(SystemState state) {
+    currentScreen = SCREEN_ENTRY;
+    switch (state) {
         case IDLE:
             display.print("Auto Parking Sys", 0);
             display.print("Waiting...", 1);
-            // Ensure all slot LEDs are in correct initial state (e.g., green if free)
-            for(int i=0; i<NUM_SLOTS; ++i) {
-                if(slotSensor.isSlotFree(i)) display.setSlotLED(i, GREEN);
-                else display.setSlotLED(i, RED);
-            }
             break;
         case WEIGHT_CHECK:
             display.print("Checking slots...", 0);
             display.print("", 1); 
-            beep(50);
             break;
         case BARRIER_OPEN:
             display.print("Slot Found!", 0);
             display.print("Welcome!", 1);
-            barrier.open();
-            beep(100);
             break;
-        case PLATFORM_ALIGN:
+        case FULL:
+            display.print("Sorry, Garage", 0);
+            display.print("Is Full", 1);
+            break;
+    }
+}
+
+void showSessionMessage(int8_t index) {
+    const Session& session = sessions[index];
+    char msg[17];
+    currentScreen = SCREEN_SESSION;
+    screenSession = index;
+    switch (session.phase) {
+        case SESSION_ALIGNING:
             display.print("Aligning Platform", 0);
-            char msg[17];
-            snprintf(msg, sizeof(msg), "To Slot %d...", targetSlot + 1);
+            snprintf(msg, sizeof(msg), "To Slot %d...", session.slot + 1);
             display.print(msg, 1);
             break;
-        case GUIDE:
+        case SESSION_GUIDING:
             display.print("Proceed to Slot", 0);
-            snprintf(msg, sizeof(msg), "<<< Slot %d >>>", targetSlot + 1);
+            snprintf(msg, sizeof(msg), "<<< Slot %u >>>", (uint8_t)(session.slot + 1));
             display.print(msg, 1);
-            // Flashing/beeping logic here if needed
             break;
-        case PARKED:
+        case SESSION_PARKED:
             display.print("Vehicle Parked", 0);
-            snprintf(msg, sizeof(msg), "In Slot %d", targetSlot + 1);
+            snprintf(msg, sizeof(msg), "In Slot %d", session.slot + 1);
             display.print(msg, 1);
-            display.setSlotLED(targetSlot, RED);
-            parkingTimer.start(targetSlot);
-            beep(200);
             break;
-        case EXIT:
-            display.print("Vehicle Leaving", 0);
-            display.print("Opening barrier", 1);
-            barrier.open();
-            parkingTimer.stop(targetSlot);
-            beep(100); delay(50); beep(100); // Double beep for exit
+        case SESSION_EXITING:
+            showExitMessage();
             break;
-        case FULL:
-            display.print("Sorry, Garage", 0);
-            display.print("Is Full", 1);
-            beep(500); // Longer beep for full
+        default:
+            showStateMessage((SystemState)entryLane.state());
             break;
     }
 }
 
-// --- IR Sensor Update & Debounce ---
-void updateIrSensors() {
-    unsigned long currentMillis = millis();
+void showExitMessage() {
+    currentScreen = SCREEN_EXIT;
+    if (exitSession < 0) {
+        display.print("Exit Open", 0);
+        display.print("Goodbye!", 1);
+        return;
+    }
+    // Duration was captured when the car left its slot, so it only needs formatting once
+    const Session& session = sessions[exitSession];
+    unsigned long duration = session.parkedS;
+    uint8_t slotNumber = session.slot + 1;
+    char msg[19]; // 16 columns up to slot 99; sized for any uint8_t so nothing is cut mid-field
+    if (duration < 100UL * 3600) {
+        uint8_t hours = duration / 3600;
+        uint8_t mins = (duration % 3600) / 60;
+        uint8_t secs = duration % 60;
+        snprintf(msg, sizeof(msg), "Slot %u %02u:%02u:%02u", slotNumber, hours, mins, secs);
+    } else {
+        // 100 h and more: days and hours still fit the 16 columns
+        unsigned long days = duration / 86400UL;
+        uint16_t shownDays = days < 999 ? days : 999;
+        uint8_t hours = (duration % 86400UL) / 3600;
+        snprintf(msg, sizeof(msg), "Slot %u %ud%02uh", slotNumber, shownDays, hours);
+    }
+    display.print("Park Duration:", 0);
+    display.print(msg, 1);
+}
 
-    // --- Entry Sensor ---
-    int readingEntry = digitalRead(PIN_IR_ENTRY);
-    if (readingEntry != lastIrEntryState) {
-        lastEntryDebounceTime = currentMillis; // Reset debounce timer
+// One restore pending at most: a repeated command re-arms it instead of
+// taking another task entry
+void holdCommandScreen() {
+    scheduler.cancel(restoreTask);
+    restoreTask = scheduler.after(STATUS_DISPLAY_HOLD_MS, restoreScreenTask);
+    if (restoreTask == Scheduler::INVALID_TASK) {
+        restoreStateMessage(); // Table full: do not leave the message up for good
     }
-    if ((currentMillis - lastEntryDebounceTime) > IR_DEBOUNCE_DELAY_MS) {
-        // If the state has been stable for longer than the debounce delay
-        if (readingEntry != irEntryState) {
-            irEntryState = readingEntry;
-            if (irEntryState == HIGH) {
-                // LOW to HIGH transition (beam unblocked / vehicle arrived at sensor)
-                entryTriggered = true; 
-                // Serial.println("Entry IR Triggered (LOW->HIGH)");
+}
+
+void restoreScreenTask() {
+    restoreTask = Scheduler::INVALID_TASK; // One-shot: its table entry is already free
+    restoreStateMessage();
+}
+
+void restoreStateMessage() {
+    switch (currentScreen) {
+        case SCREEN_SESSION:
+            if (sessions.isValid(screenSession)) {
+                showSessionMessage(screenSession);
             } else {
-                // HIGH to LOW transition (beam blocked / vehicle passed sensor)
-                 vehicleEntered = true;
-                // Serial.println("Entry IR Passed (HIGH->LOW)");
+                showStateMessage((SystemState)entryLane.state());
             }
+            break;
+        case SCREEN_EXIT:
+            if (exitState == EXIT_OPEN) {
+                showExitMessage();
+            } else {
+                showStateMessage((SystemState)entryLane.state());
+            }
+            break;
+        default:
+            showStateMessage((SystemState)entryLane.state());
+            break;
+    }
+}
+
+// --- IR Events ---
+// Consumes the channel's events up to the first one with the wanted edge.
+// Other edges are stale for the current state and are dropped on the way.
+bool takeIrEvent(IrChannel channel, IrEdge edge) {
+    IrEvent event;
+    while (irSensors.peek(channel, event)) {
+        irSensors.pop(channel);
+        if (event.edge == edge) return true;
+    }
+    return false;
+}
+
+// --- Occupancy Snapshot Refresh ---
+void refreshSlotSnapshot() {
+    slotSensor.refreshNext();
+}
+
+// --- Platform Motion ---
+void updatePlatform() {
+    platform.update();
+}
+
+// --- LCD Refresh ---
+void refreshDisplay() {
+    display.update();
+}
+
+// --- Slot Scan Requests ---
+// Several states want fresh readings; requests are merged and the scan is
+// started from loop() as soon as the ranging engine is free.
+void requestSlotScan(SlotMask slotMask) {
+    slotScanMask |= slotMask;
+}
+
+bool slotScanReady() {
+    return slotScanMask == 0 && slotSensor.isScanComplete();
+}
+
+// --- Bluetooth Polling ---
+void pollBluetooth() {
+    bluetoothCmd.checkCommands();
+}
+
+// --- Annunciator ---
+// Patterns start and stop from entry actions and return at once; the edges
+// are played by a reserved task re-armed for the next edge, so nothing runs
+// in between.
+void annunciate(uint8_t channel, const AnnunciatorPattern& pattern) {
+    annunciator.play(channel, pattern);
+    scheduleAnnunciator();
+}
+
+void silence(uint8_t channel, const AnnunciatorPattern& pattern) {
+    annunciator.stop(channel, pattern);
+    scheduleAnnunciator();
+}
+
+void scheduleAnnunciator() {
+    uint32_t nextMs = annunciator.update();
+    if (nextMs == 0) {
+        scheduler.disarm(annunciatorTask);
+    } else if (!scheduler.rearm(annunciatorTask, nextMs)) {
+        // No edge task (the reservation failed): nothing would switch the
+        // outputs off again, so stop everything rather than leave it on
+        for (uint8_t channel = 0; channel < ANNUNCIATOR_CHANNELS; ++channel) {
+            annunciator.stop(channel);
         }
     }
-    lastIrEntryState = readingEntry;
-
-    // --- Exit Sensor ---
-     int readingExit = digitalRead(PIN_IR_EXIT);
-     if (readingExit != lastIrExitState) {
-         lastExitDebounceTime = currentMillis; // Reset debounce timer
-     }
-     if ((currentMillis - lastExitDebounceTime) > IR_DEBOUNCE_DELAY_MS) {
-         if (readingExit != irExitState) {
-             irExitState = readingExit;
-             if (irExitState == HIGH) {
-                 // LOW to HIGH transition (beam unblocked / vehicle arrived at sensor)
-                 exitTriggered = true;
-                // Serial.println("Exit IR Triggered (LOW->HIGH)");
-             } else {
-                 // HIGH to LOW transition (beam blocked / vehicle passed sensor)
-                 vehicleExited = true;
-                // Serial.println("Exit IR Passed (HIGH->LOW)");
-             }
-         }
-     }
-     lastIrExitState = readingExit;
-}
-
-// --- Buzzer Beep --- 
-void beep(int durationMs) {
-    digitalWrite(PIN_BUZZER, HIGH);
-    delay(durationMs);
-    digitalWrite(PIN_BUZZER, LOW);
+}
+
+void annunciatorEdge() {
+    scheduleAnnunciator();
+}
+
+void annunciatorOutput(uint8_t channel, bool on) {
+    if (channel == ANNUNCIATOR_BUZZER) {
+        Buzzer::write(on);
+    } else {
+        ledsPending = true; // updateSlotLeds() reads the LED channel in this loop pass
+    }
 }
 
 // =================== BLUETOOTH CALLBACKS ===================
 
-void handleRotateCommand(int angle) {
-    // Example: Directly control platform servo via Bluetooth
-    // Note: This bypasses the state machine logic for rotation.
+void handlePolicyCommand(const int16_t* args, uint8_t) {
+    if (args[0] < 0 || args[0] >= POLICY_COUNT) return;
+    slotAllocator.setPolicy((AllocationPolicy)args[0]);
+    // Serial.print("Allocation policy: "); Serial.println(args[0]);
+}
+
+void handleRotateCommand(const int16_t* args, uint8_t) {
+    // Example: Directly control platform via Bluetooth
+    // Note: This bypasses the state machine logic for rotation (position tracking is kept).
     // Consider if this should only work in specific states or be disabled.
-    // Serial.print("Bluetooth: Rotate command received: "); Serial.println(angle);
+    // Serial.print("Bluetooth: Rotate command received: "); Serial.println(args[0]);
     
     // Constrain angle if needed
-    angle = constrain(angle, 0, 180); 
-    platform._servo.write(angle); // Accessing private member - better to add public method in Platform class
+    int angle = constrain(args[0], 0, 180); 
+    platform.rotateToAngle(angle);
     display.print("Manual Rotate:", 0);
     char msg[17];
     snprintf(msg, sizeof(msg), "%d degrees", angle);
     display.print(msg, 1);
 }
 
-void handleStatusCommand() {
-    // Example: Report current status via Bluetooth/Serial
-    // Serial.println("--- System Status ---");
-    // Serial.print("Current State: "); Serial.println(currentState); 
-    // Serial.print("Target Slot: "); Serial.println(targetSlot);
-    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
-        // Serial.print("Slot "); Serial.print(i);
-        // Serial.print(": ");
-        float dist = slotSensor.getSlotDistanceCm(i);
-        if (dist < 0) {
-            // Serial.print("Sensor Error ");
-        } else {
-            // Serial.print(dist); Serial.print(" cm ");
-        }
-        if (slotSensor.isSlotFree(i)) {
-            // Serial.print("(Free)");
-        } else {
-            // Serial.print("(Occupied)");
-        }
-        if (parkingTimer.isRunning[i]) {
-           // Serial.print(" Timer: "); Serial.print(parkingTimer.getDurationSeconds(i)); Serial.print("s");
-        } else if (parkingTimer.durationMs[i] > 0) {
-             // Serial.print(" Last Time: "); Serial.print(parkingTimer.getDurationSeconds(i)); Serial.print("s");
-        }
-        // Serial.println();
-    }
-    // Serial.println("---------------------");
+void handleStatusCommand(const int16_t*, uint8_t) {
+    // Report current status via Bluetooth/Serial (streamed from loop(), see statusReportLine)
+    serialReport.start(statusReportLine);
 
     // Send basic status to LCD as well
     display.print("Status Requested", 0);
     char statusLine[17];
-    snprintf(statusLine, sizeof(statusLine), "State:%d Slot:%d", currentState, targetSlot != -1 ? targetSlot+1 : 0);
+    uint8_t cars = sessions.active() + slotCount(parkingTimer.runningMask);
+    snprintf(statusLine, sizeof(statusLine), "St:%u Cars:%u", entryLane.state(), cars); // At most 15 columns
     display.print(statusLine, 1);
-    // Maybe add a short delay so the message is visible
-    delay(2000); 
-    // Restore previous display based on current state? Requires more logic.
-    changeState(currentState); // Re-trigger entry action to reset display
+    // Keep the message visible for a while, then restore the screen for the current state
+    holdCommandScreen();
+}
+
+// STATUS reply, one line per call: a summary, then one line per slot from the
+// occupancy snapshot (nothing is ranged for it)
+//   STATUS state=<entry> exit=<exit> cars=<n> free=<n>
+//   SLOT <n> <dist>mm|err free|occ [car=<id> t=<s>]
+bool statusReportLine(uint8_t index, char* line, uint8_t size) {
+    if (index == 0) {
+        snprintf(line, size, "STATUS state=%d exit=%d cars=%d free=%d", entryLane.state(), exitState,
+                 sessions.active() + slotCount(parkingTimer.runningMask), slotCount(availableSlots()));
+        return true;
+    }
+    uint8_t slot = index - 1;
+    if (slot > NUM_SLOTS) return false;
+    if (slot == NUM_SLOTS) {
+        snprintf(line, size, "END");
+        return true;
+    }
+
+    int length = snprintf(line, size, "SLOT %d ", slot + 1);
+    float dist = slotSensor.latestDistance(slot); // From the snapshot, no ranging
+    if (dist < 0) {
+        length += snprintf(line + length, size - length, "err ");
+    } else {
+        length += snprintf(line + length, size - length, "%dmm ", (int)(dist * 10));
+    }
+    length += snprintf(line + length, size - length, (slotSensor.freeMask() & slotBit(slot)) ? "free" : "occ");
+    if (parkingTimer.isRunning(slot)) {
+        snprintf(line + length, size - length, " car=%u t=%lus", parkingTimer.sessionId[slot],
+                 parkingTimer.getDurationSeconds(slot));
+    }
+    return true;
+}
+
+void handleSlotsCommand(const int16_t*, uint8_t) {
+    // RAM of everything that grows with NUM_SLOTS (sensor snapshot + filters,
+    // parking timers, allocator LRU stamps, session table)
+    unsigned int ram = sizeof(slotSensor) + sizeof(parkingTimer) + sizeof(slotAllocator) + sizeof(sessions);
+    // 16-bit values keep both lines within the 16 LCD columns
+    uint16_t ramB = ram < 0xFFFF ? ram : 0xFFFF;
+    unsigned int allocUs = slotAllocator.maxAllocateUs();
+    uint16_t maxUs = allocUs < 0xFFFF ? allocUs : 0xFFFF;
+    char msg[17];
+    snprintf(msg, sizeof(msg), "S:%u RAM:%uB", (uint8_t)NUM_SLOTS, ramB);
+    display.print(msg, 0);
+    snprintf(msg, sizeof(msg), "AllocMax:%uus", maxUs);
+    display.print(msg, 1);
+    // Serial.print("Free slots: "); Serial.println(slotCount(availableSlots()));
+    holdCommandScreen();
+}
+
+void handleStatsCommand(const int16_t*, uint8_t) {
+    serialReport.start(statsReportLine);
+}
+
+// STATS reply: the profiler's header, the counters below (always built in),
+// then the rest of the profiler report
+//   ALLOC policy=<n> n=<allocations> saved=<ms>
+//   ALLOCLAST saved=<ms> align=<ms>
+//   BT text=<n> bin=<n> disp=<us> max=<us>
+//   BTERR unknown=<n> badargs=<n> crc=<n> ovf=<n>
+//   LCD chars=<n> moves=<n>
+//   I2C done=<n> err=<n> maxq=<n>
+//   JOURNAL records=<n>/<capacity> dropped=<n>
+//   IR ovf=<n> maxq=<n> drops=<n> glitch=<n>
+const uint8_t STATS_COUNTER_LINES = 8;
 
+bool statsReportLine(uint8_t index, char* line, uint8_t size) {
+    if (index == 0 || index > STATS_COUNTER_LINES) {
+        return Profiler::reportLine(index == 0 ? 0 : index - STATS_COUNTER_LINES, line, size);
+    }
+    switch (index) {
+        case 1:
+            // Expected alignment time saved against first-free, in total
+            snprintf(line, size, "ALLOC policy=%u n=%lu saved=%ldms", slotAllocator.policy(),
+                     slotAllocator.allocations(), slotAllocator.totalSavedMs());
+            return true;
+        case 2:
+            // The last car: time saved and expected alignment time
+            snprintf(line, size, "ALLOCLAST saved=%ldms align=%lums", slotAllocator.lastSavedMs(),
+                     slotAllocator.lastAlignMs());
+            return true;
+        case 3: {
+            // Commands per mode, parse + lookup time (last, longest)
+            const BluetoothCmd::Stats& bt = bluetoothCmd.stats();
+            snprintf(line, size, "BT text=%u bin=%u disp=%uus max=%uus", bt.textCommands, bt.binaryFrames,
+                     bt.lastDispatchUs, bt.maxDispatchUs);
+            return true;
+        }
+        case 4: {
+            const BluetoothCmd::Stats& bt = bluetoothCmd.stats();
+            snprintf(line, size, "BTERR unknown=%u badargs=%u crc=%u ovf=%u", bt.unknown, bt.badArgs,
+                     bt.crcErrors, bt.overflows);
+            return true;
+        }
+        case 5:
+            // Characters and cursor commands actually sent (unchanged cells are skipped)
+            snprintf(line, size, "LCD chars=%lu moves=%lu", display.charsWritten(), display.cursorMoves());
+            return true;
+        case 6:
+            // Shared queue (LCD, sensor board): transfers, failed ones, deepest queue seen
+            snprintf(line, size, "I2C done=%lu err=%lu maxq=%u", I2cBus::completed(), I2cBus::errors(),
+                     I2cBus::maxQueued());
+            return true;
+        case 7:
+            // Records lost to a full write queue or to more running sessions than the ring carries
+            snprintf(line, size, "JOURNAL records=%u/%u dropped=%u", journal.records(), SessionJournal::CAPACITY,
+                     journal.dropped());
+            return true;
+        case 8:
+            // Gate beams: raw edges lost to a full ring, its deepest fill, events lost, short pulses
+            snprintf(line, size, "IR ovf=%lu maxq=%u drops=%lu glitch=%lu", IrSensors::overflows(),
+                     IrSensors::maxDepth(), irSensors.eventDrops(), irSensors.glitches());
+            return true;
+    }
+    return false;
 }
 
+void handleJournalCommand(const int16_t*, uint8_t) {
+    serialReport.start(journalExportFrame);
+}
 
+uint8_t journalExportFrame(uint8_t index, uint8_t* frame, uint8_t size) {
+    return journal.exportFrame(index, frame, size);
+}
+
+void handleAnalyticsCommand(const int16_t*, uint8_t) {
+    serialReport.start(analyticsReportLine);
+}
+
+// ANALYTICS reply, one line per call (times in s on the journal clock, since boot):
+//   ANALYTICS up=<s> arrivals=<n>
+//   CARS rejected=<n> departed=<n>
+//   OCC now=<n> peak=<n>@<s> avg=<cars>
+//   DWELL mean=<s> sd=<s>
+//   DWELLR min=<s> max=<s>
+//   DWELLP p50=<s> p90=<s> p99=<s>
+//   HIST <count per ANALYTICS_DWELL_EDGES_S bucket>
+//   ARR.<h> <arrivals h, h+1, ... hours ago> (8 per line)
+//   SLOT <n> util=<%> busy=<s>
+// (split so that every line fits SerialReport's 63 characters with 10-digit counters)
+const uint8_t ANALYTICS_FIXED_LINES = 7;
+const uint8_t ANALYTICS_HOURS_PER_LINE = 8;
+const uint8_t ANALYTICS_HOUR_LINES = (ANALYTICS_ARRIVAL_HOURS + ANALYTICS_HOURS_PER_LINE - 1) / ANALYTICS_HOURS_PER_LINE;
+
+bool analyticsReportLine(uint8_t index, char* line, uint8_t size) {
+    uint32_t now = journal.nowS();
+    switch (index) {
+        case 0:
+            snprintf(line, size, "ANALYTICS up=%lus arrivals=%lu", (unsigned long)analytics.sinceS(now),
+                     analytics.arrivals());
+            return true;
+        case 1:
+            snprintf(line, size, "CARS rejected=%lu departed=%lu", analytics.rejected(), analytics.departures());
+            return true;
+        case 2: {
+            uint16_t average = analytics.averageOccupancyX100(now);
+            snprintf(line, size, "OCC now=%u peak=%u@%lus avg=%u.%02u", analytics.occupied(),
+                     analytics.peakOccupied(), (unsigned long)analytics.peakAtS(), average / 100, average % 100);
+            return true;
+        }
+        case 3:
+            snprintf(line, size, "DWELL mean=%lus sd=%lus", (unsigned long)analytics.dwellMeanS(),
+                     (unsigned long)analytics.dwellStdDevS());
+            return true;
+        case 4:
+            snprintf(line, size, "DWELLR min=%lus max=%lus", (unsigned long)analytics.dwellMinS(),
+                     (unsigned long)analytics.dwellMaxS());
+            return true;
+        case 5:
+            snprintf(line, size, "DWELLP p50=%lus p90=%lus p99=%lus",
+                     (unsigned long)analytics.dwellPercentileS(50), (unsigned long)analytics.dwellPercentileS(90),
+                     (unsigned long)analytics.dwellPercentileS(99));
+            return true;
+        case 6: {
+            int length = snprintf(line, size, "HIST");
+            for (uint8_t b = 0; b < ParkingAnalytics::DWELL_BUCKETS; ++b) {
+                length += snprintf(line + length, size - length, " %u", analytics.dwellBucket(b));
+            }
+            return true;
+        }
+    }
+
+    uint8_t row = index - ANALYTICS_FIXED_LINES;
+    if (row < ANALYTICS_HOUR_LINES) {
+        uint8_t first = row * ANALYTICS_HOURS_PER_LINE;
+        int length = snprintf(line, size, "ARR.%u", first);
+        for (uint8_t h = first; h < first + ANALYTICS_HOURS_PER_LINE && h < ANALYTICS_ARRIVAL_HOURS; ++h) {
+            length += snprintf(line + length, size - length, " %u", analytics.arrivalsInHour(h, now));
+        }
+        return true;
+    }
+
+    uint8_t slot = row - ANALYTICS_HOUR_LINES;
+    if (slot > NUM_SLOTS) return false;
+    if (slot == NUM_SLOTS) {
+        snprintf(line, size, "END");
+        return true;
+    }
+    uint32_t runningS = parkingTimer.isRunning(slot) ? parkingTimer.durationS(slot) : 0;
+    uint16_t permille = analytics.utilisationPermille(slot, now, runningS);
+    snprintf(line, size, "SLOT %d util=%u.%u%% busy=%lus", slot + 1, permille / 10, permille % 10,
+             (unsigned long)analytics.busyS(slot, now, runningS));
+    return true;
+}
+
+void handleFsmCommand(const int16_t*, uint8_t) {
+    serialReport.start(entryLaneReportLine);
+}
+
+// FSM reply: the entry lane table as StateMachine::describe() prints it
+bool entryLaneReportLine(uint8_t index, char* line, uint8_t size) {
+    return entryLane.describe(index, line, size);
+}
+
+void handleTraceCommand(const int16_t*, uint8_t) {
+    serialReport.start(TraceRecorder::exportFrame);
+}
+
+void handleTelemetryCommand(const int16_t* args, uint8_t) {
+    telemetry.start(args[0] > 0 ? args[0] : 0);
+}
+
+// TELEMETRY samples: the garage side (loop statistics come from Telemetry)
+void telemetrySample(TelemetrySample& sample) {
+    sample.entryState = entryLane.state();
+    sample.exitState = exitState;
+    sample.cars = sessions.active() + slotCount(parkingTimer.runningMask);
+    unsigned long lateMs = scheduler.maxLatenessMs();
+    sample.lateMs = lateMs < 0xFFFF ? lateMs : 0xFFFF;
+}
+
+void telemetrySlot(uint8_t slot, TelemetrySlot& out) {
+    out.free = (slotSensor.freeMask() & slotBit(slot)) != 0;
+    out.parked = parkingTimer.isRunning(slot);
+    float dist = slotSensor.latestDistance(slot); // From the snapshot, no ranging
+    out.distanceMm = dist < 0 ? TELEMETRY_NO_ECHO : (uint16_t)(dist * 10);
+    out.parkedS = out.parked ? parkingTimer.durationS(slot) : 0;
+}
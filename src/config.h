@@ -11,19 +11,64 @@ const uint8_t PIN_BARRIER_SERVO = 9;
 // Platform Servo/Motor
 const uint8_t PIN_PLATFORM_SERVO = 10; // Or motor driver pins if using DC motor
 
+// --- Slot I/O ---
+// Small garages wire every slot to its own pins (3 slots use 12 pins on the UNO).
+// Larger ones build with -DSLOT_IO_MULTIPLEXED=1 (see platformio.ini): the
+// HC-SR04s share one trigger and one echo line through a pair of analog
+// multiplexers (e.g. cascaded CD74HC4067) addressed by PINS_SENSOR_ADDR, and the
+// slot LEDs hang off a chain of 74HC595 shift registers (2 bits per slot,
+// green then red, slot 0 last in the chain). SLOT_MUX_SLOTS sets the slot count.
+#ifndef SLOT_IO_MULTIPLEXED
+#define SLOT_IO_MULTIPLEXED 0
+#endif
+
+#if SLOT_IO_MULTIPLEXED
+
+#ifndef SLOT_MUX_SLOTS
+#define SLOT_MUX_SLOTS 32
+#endif
+const uint8_t NUM_SLOTS = SLOT_MUX_SLOTS;
+
+// Ultrasonic Sensors (HC-SR04): one shared trigger/echo channel
+const uint8_t SLOT_ECHO_CHANNELS = 1;
+constexpr uint8_t PINS_TRIG[SLOT_ECHO_CHANNELS] = {2};
+constexpr uint8_t PINS_ECHO[SLOT_ECHO_CHANNELS] = {3};
+// Multiplexer address lines, least significant bit first (6 lines = 64 slots)
+constexpr uint8_t PINS_SENSOR_ADDR[] = {4, 5, 7, 8, 12, A3};
+const unsigned int SLOT_MUX_SETTLE_US = 2; // Address change to stable trigger/echo path
+
+// Status LEDs: 74HC595 chain
+const uint8_t PIN_LED_DATA = 11;
+const uint8_t PIN_LED_CLOCK = 13;
+const uint8_t PIN_LED_LATCH = A2;
+
+#else
+
 // Ultrasonic Sensors (HC-SR04) - Assuming 3 slots
 const uint8_t NUM_SLOTS = 3;
-const uint8_t PINS_TRIG[NUM_SLOTS] = {2, 4, 7};
-const uint8_t PINS_ECHO[NUM_SLOTS] = {3, 5, 8};
+const uint8_t SLOT_ECHO_CHANNELS = NUM_SLOTS; // One trigger/echo pair per slot
+constexpr uint8_t PINS_TRIG[NUM_SLOTS] = {2, 4, 7};
+constexpr uint8_t PINS_ECHO[NUM_SLOTS] = {3, 5, 8}; // Must support pin-change interrupts (all UNO pins do)
+
+// Status LEDs (Green/Red per slot)
+constexpr uint8_t PINS_LED_GREEN[NUM_SLOTS] = {11, 12, 13}; // Example pins
+constexpr uint8_t PINS_LED_RED[NUM_SLOTS] = {A2, A3, A4};   // Example pins
+// NOTE: A4/A5 are SDA/SCL on the UNO and belong to the LCD's I2C bus, so the
+// slot 3 red LED is not driven (Display skips TWI pins) and that slot shows
+// occupied as green off. Move it to a free pin on a board that has one.
+
+#endif
+
+// Address lines needed for NUM_SLOTS sensors (multiplexed wiring)
+constexpr uint8_t slotAddressBits(uint8_t slots, uint8_t bits = 0) {
+    return (1u << bits) >= slots ? bits : slotAddressBits(slots, bits + 1);
+}
+const uint8_t SLOT_MUX_ADDR_BITS = slotAddressBits(NUM_SLOTS);
 
 // IR Break-beam Sensors
 const uint8_t PIN_IR_ENTRY = A0;
 const uint8_t PIN_IR_EXIT = A1;
 
-// Status LEDs (Green/Red per slot)
-const uint8_t PINS_LED_GREEN[NUM_SLOTS] = {11, 12, 13}; // Example pins
-const uint8_t PINS_LED_RED[NUM_SLOTS] = {A2, A3, A4};   // Example pins
-
 // Buzzer
 const uint8_t PIN_BUZZER = 6;
 
@@ -31,6 +76,23 @@ const uint8_t PIN_BUZZER = 6;
 const uint8_t LCD_ADDR = 0x27; // Common address, check yours
 const uint8_t LCD_COLS = 16;
 const uint8_t LCD_ROWS = 2;
+const unsigned long DISPLAY_REFRESH_MS = 100; // Max LCD update rate (changed cells only)
+
+// I2C bus (LCD, sensor board)
+const unsigned long I2C_CLOCK_HZ = 100000;
+const uint8_t I2C_QUEUE_DEPTH = 4; // Pending transactions (buffers are owned by callers)
+
+// Sensor board (env uno_sensor): ranges the slots on its own and serves the
+// results as I2C slave. Build the main board with -DSLOT_SENSOR_REMOTE=1
+// (env uno_main_remote) to read the slots from it instead of local sensors.
+#ifndef SLOT_SENSOR_REMOTE
+#define SLOT_SENSOR_REMOTE 0
+#endif
+const uint8_t SENSOR_BOARD_ADDR = 0x28;
+const uint8_t PIN_SENSOR_IRQ = 2;     // Main board: "changed" line from the sensor board (active low, pulled up)
+const uint8_t PIN_SENSOR_IRQ_OUT = 9; // Sensor board: drives the "changed" line (open drain)
+const unsigned long SENSOR_BOARD_TIMEOUT_MS = 1000; // No answer / scan not done for this long = offline
+const unsigned long SENSOR_BOARD_ROUND_MS = 25;     // Sensor board: minimum time between full ranging rounds
 
 // Bluetooth (HC-05) - Using SoftwareSerial or Hardware Serial
 // If using pins 0, 1 (Hardware Serial), connect TX->RX, RX->TX
@@ -41,19 +103,156 @@ const uint8_t LCD_ROWS = 2;
 // --- Thresholds & Settings ---
 
 // Slot Sensor distance threshold (cm) for occupied/free
-const float SLOT_OCCUPIED_THRESHOLD_CM = 20.0;
+constexpr float SLOT_OCCUPIED_THRESHOLD_CM = 20.0;
+// Echo round trip per cm: 2 / 0.0343 cm/us (speed of sound 343 m/s)
+constexpr float SLOT_ECHO_US_PER_CM = 58.3;
+
+// Streaming occupancy filter: median over the last SLOT_FILTER_SIZE readings,
+// a decision needs SLOT_FILTER_MIN_VALID valid readings and the median has to
+// cross the threshold by SLOT_HYSTERESIS_CM to flip the state
+const uint8_t SLOT_FILTER_SIZE = 5;
+const uint8_t SLOT_FILTER_MIN_VALID = 3;
+constexpr float SLOT_HYSTERESIS_CM = 3.0;
+
+// Range-gated detection: occupancy only needs to know whether the echo returns
+// within the threshold (+ hysteresis + margin), so the measurement stops as
+// soon as that echo-time gate has passed (~2-3 ms instead of up to 30 ms).
+// Distances beyond the gate are reported as the gate distance; use the
+// blocking getSlotDistanceCm() for full-range diagnostics.
+const bool SLOT_RANGE_GATED = true;
+constexpr float SLOT_GATE_MARGIN_CM = 5.0;
+
+// Non-blocking ranging: echo timeout (~5 m), max trigger-to-echo-start delay
+// and the spacing between triggers of different sensors (avoids crosstalk)
+const unsigned long SLOT_ECHO_TIMEOUT_US = 30000;
+const unsigned long SLOT_ECHO_RISE_MAX_US = 2000;
+const unsigned long SLOT_SENSOR_STAGGER_US = 2000;
+
+// Occupancy snapshot: one slot is refreshed per period (round-robin), readers
+// accept values up to SLOT_SNAPSHOT_MAX_AGE_MS old before re-measuring.
+// With many slots the period shrinks so a full round still fits in half the max age.
+const unsigned long SLOT_SNAPSHOT_MAX_AGE_MS = 1000;
+const unsigned long SLOT_REFRESH_PERIOD_MS =
+    SLOT_SNAPSHOT_MAX_AGE_MS / 2 / NUM_SLOTS < 40 ? SLOT_SNAPSHOT_MAX_AGE_MS / 2 / NUM_SLOTS : 40;
+
+// Pin-change interrupt routing table size (echo pins + IR sensors)
+const uint8_t PIN_CHANGE_MAX_PINS = 6;
 
 // Barrier Servo angles
 const int BARRIER_OPEN_ANGLE = 90;
 const int BARRIER_CLOSED_ANGLE = 0;
-const int BARRIER_DELAY_MS = 500; // Delay after moving barrier
 
-// Platform Rotation (Example: Target angles for slots)
-const int PLATFORM_SLOT_ANGLES[NUM_SLOTS] = {30, 90, 150};
-const int PLATFORM_ROTATION_SPEED = 5; // Example speed factor
+// Platform Rotation: slots are spread evenly between the first and last angle
+// (3 slots -> 30, 90, 150 degrees)
+const int PLATFORM_FIRST_SLOT_ANGLE = 30;
+const int PLATFORM_LAST_SLOT_ANGLE = 150;
+constexpr int platformSlotAngle(uint8_t slot) {
+    return NUM_SLOTS < 2 ? PLATFORM_FIRST_SLOT_ANGLE
+        : PLATFORM_FIRST_SLOT_ANGLE +
+          (int)((long)(PLATFORM_LAST_SLOT_ANGLE - PLATFORM_FIRST_SLOT_ANGLE) * slot / (NUM_SLOTS - 1));
+}
+// Motion profile (tune to the servo and platform load)
+const int PLATFORM_MAX_SPEED_DEG_S = 120;      // Cruise speed
+const int PLATFORM_ACCEL_DEG_S2 = 360;         // Acceleration and deceleration
+const unsigned long PLATFORM_TICK_MS = 20;     // Profile step period (one servo frame)
+const unsigned long PLATFORM_SETTLE_MS = 100;  // Servo lag after the profile ends
+const unsigned long PLATFORM_INIT_TIME_MS = 500; // Time allowed to reach the initial position
+const int PLATFORM_SERVO_MIN_US = 544;         // Pulse width at 0 deg (Servo library default)
+const int PLATFORM_SERVO_MAX_US = 2400;        // Pulse width at 180 deg
+
+// Slot allocation policy at the gate (can be changed with "POLICY <n>"):
+// 0 = first free, 1 = nearest to platform, 2 = least recently used,
+// 3 = predictive (least recently used, the platform turned to it while idle)
+const uint8_t SLOT_ALLOCATION_POLICY = 1;
+
+// Vehicle sessions: one entry per car on its way in or out. Parked cars live
+// in ParkingTimer (one bit + start time per slot), so the table does not grow
+// with NUM_SLOTS.
+const uint8_t SESSION_MAX = 6;
+// Exit beam broken but no car has left its slot yet (sensor lag): how long to
+// wait for the departure before opening the barrier anyway
+const unsigned long EXIT_MATCH_TIMEOUT_MS = 3000;
 
 // Debounce delay for IR sensors (ms)
 const unsigned long IR_DEBOUNCE_DELAY_MS = 50;
+// Raw IR edges buffered between the pin-change interrupt and loop() (power of
+// two), and debounced events kept per beam until the state machine takes them
+const uint8_t IR_EDGE_RING_SIZE = 16;
+const uint8_t IR_EVENT_QUEUE_DEPTH = 4;
+
+// --- Session Journal (EEPROM) ---
+// Parked/left records appended to a ring of fixed 16-byte records in EEPROM
+// (see SessionJournal.h). Nothing is ever rewritten in place, so each cell
+// sees one write per JOURNAL_EEPROM_BYTES / 16 records (48: ~4.8M records at
+// 100k cycles per cell).
+const uint16_t JOURNAL_EEPROM_START = 0;
+// The ring also carries the running sessions (up to 6 fewer than it has
+// records): above 32 slots it takes the whole 1 KB, otherwise the rest is left free
+const uint16_t JOURNAL_EEPROM_BYTES = NUM_SLOTS > 32 ? 1024 : 768;
+const uint8_t JOURNAL_QUEUE_DEPTH = 4;      // Records waiting for EEPROM (one byte per loop pass)
+// While cars are parked, the journal clock is saved at least this often, so a
+// power cut loses at most this much of their parking time
+const unsigned long JOURNAL_CHECKPOINT_S = 900;
+// Sessions restored at boot: an empty slot only closes them once its reading
+// is decided, or after this long (no-echo slots never get valid readings)
+const unsigned long JOURNAL_RESTORE_CONFIRM_MS = 10000;
+
+// --- Parking Analytics ---
+// Dwell-time histogram: upper bucket edges in seconds (5 min .. 24 h), one
+// more bucket above the last edge. Percentiles are interpolated inside a bucket.
+constexpr uint32_t ANALYTICS_DWELL_EDGES_S[] = {300, 900, 1800, 3600, 7200, 14400, 28800, 86400};
+const uint8_t ANALYTICS_ARRIVAL_HOURS = 24; // Arrivals per hour, last N hours
+
+// --- Annunciator (buzzer and slot LED patterns) ---
+// Alternating on/off times in ms, starting with "on" (see Annunciator.h).
+// Repeat counts and priorities are set where the sketch pairs them up.
+const uint8_t ANNUNCIATOR_CHANNELS = 2;        // Buzzer, guided slot's LED
+constexpr uint16_t TONE_READY[] = {100};       // Boot finished
+constexpr uint16_t TONE_ARRIVAL[] = {50};      // Car at the entry beam
+constexpr uint16_t TONE_ADMIT[] = {100};       // Entry barrier opening
+constexpr uint16_t TONE_FULL[] = {500};        // No space
+constexpr uint16_t TONE_PARKED[] = {200};
+constexpr uint16_t TONE_EXIT[] = {100, 50, 100}; // Double beep
+constexpr uint16_t TONE_GUIDE[] = {50, 450};   // Chirp every 500 ms while guiding
+constexpr uint16_t FLASH_GUIDE[] = {250, 250}; // Guided slot's green LED
+
+// --- Scheduler & Timing ---
+const uint8_t SCHEDULER_MAX_TASKS = 8;             // Fixed task table size (no heap)
+const unsigned long BT_POLL_PERIOD_MS = 5;         // Bluetooth input polling period
+const unsigned long GUIDE_CHECK_INTERVAL_MS = 100; // Slot sensor check interval while guiding
+const unsigned long FULL_TIMEOUT_MS = 5000;        // "No Space" shown this long, then back to IDLE
+const uint8_t FSM_EVENT_QUEUE_DEPTH = 4;           // Events posted by state handlers, handled in order
+const unsigned long STATUS_DISPLAY_HOLD_MS = 2000;  // How long the STATUS screen stays on the LCD
+
+// Bluetooth: accept length-prefixed, CRC-checked binary command frames
+// alongside text lines (see BluetoothCmd.h for the frame layout)
+const bool BT_BINARY_FRAMES_ENABLED = true;
+
+// Telemetry stream ("TELEMETRY <ms>", see Telemetry.h): binary samples queued
+// in a TX ring and written as the UART takes them. At 9600 baud a 3-slot
+// sample (50 bytes) needs about 52 ms of line time.
+const uint16_t TELEMETRY_MIN_PERIOD_MS = 100;
+const uint8_t TELEMETRY_TX_RING_BYTES = 96;  // At least one frame
+const uint8_t TELEMETRY_SLOTS_PER_FRAME = 8; // Slots per TELEMETRY_FRAME_SLOTS frame
+
+// --- Diagnostics ---
+// Profiling probes (loop, slot allocation, rotation, LCD, commands), dumped by
+// the STATS command; see Profiler.h. Off by default: about 70 bytes of RAM per
+// probe. Build with -DPROFILING_ENABLED=1 (env uno_main_profile).
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 0
+#endif
+const uint8_t PROFILE_STATES = 4; // SystemState values tracked per probe
+
+// Input trace (IR edges, echo times, commands) and what the firmware made of
+// it (state changes, barrier and platform commands) in a RAM ring, streamed
+// by the TRACE command and replayed on the host (env native_replay); see
+// TraceRecorder.h. Off by default. Build with -DTRACE_ENABLED=1 (env uno_main_trace).
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+const uint16_t TRACE_RAM_BYTES = 256;    // Ring size; the oldest records are overwritten
+const uint16_t TRACE_ECHO_STEP_US = 290; // Echo time change (about 5 cm) that is worth a record
 
 // Serial Monitor Baud Rate
 const unsigned long SERIAL_BAUD_RATE = 9600;
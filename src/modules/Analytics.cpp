@@ -0,0 +1,147 @@
+#include "Analytics.h"
+
+void ParkingAnalytics::setup(uint32_t nowS, SlotMask parkedMask) {
+    _startS = nowS;
+    _changeS = nowS;
+    _hour = nowS / 3600;
+    _occupied = slotCount(parkedMask);
+    _peak = _occupied;
+    _peakAtS = nowS;
+}
+
+// Adds the car-seconds since the last change at the current occupancy
+void ParkingAnalytics::integrate(uint32_t nowS) {
+    _occupancyS += (uint64_t)_occupied * (nowS - _changeS);
+    _changeS = nowS;
+}
+
+void ParkingAnalytics::recordArrival(uint32_t nowS, bool admitted) {
+    _arrivals++;
+    if (!admitted) _rejected++;
+
+    // Move the hour ring forward, clearing the hours without arrivals
+    uint32_t hour = nowS / 3600;
+    uint32_t elapsed = hour - _hour;
+    if (elapsed > ANALYTICS_ARRIVAL_HOURS) elapsed = ANALYTICS_ARRIVAL_HOURS;
+    while (elapsed--) {
+        _hourIndex = (_hourIndex + 1) % ANALYTICS_ARRIVAL_HOURS;
+        _hourly[_hourIndex] = 0;
+    }
+    _hour = hour;
+    if (_hourly[_hourIndex] < 0xFFFF) _hourly[_hourIndex]++;
+}
+
+void ParkingAnalytics::recordParked(uint8_t slot, uint32_t nowS) {
+    if (slot >= NUM_SLOTS) return;
+    integrate(nowS);
+    _occupied++;
+    if (_occupied > _peak) {
+        _peak = _occupied;
+        _peakAtS = nowS;
+    }
+}
+
+void ParkingAnalytics::recordDeparture(uint8_t slot, uint32_t dwellS, uint32_t nowS) {
+    if (slot >= NUM_SLOTS) return;
+    integrate(nowS);
+    if (_occupied > 0) _occupied--;
+
+    // Only the part since setup() counts as busy time (restored cars parked earlier)
+    uint32_t spanS = nowS - _startS;
+    _busyS[slot] += dwellS < spanS ? dwellS : spanS;
+
+    if (_dwellCount == 0 || dwellS < _dwellMinS) _dwellMinS = dwellS;
+    if (dwellS > _dwellMaxS) _dwellMaxS = dwellS;
+    _dwellCount++;
+    _dwellSumS += dwellS;
+    _dwellSumSqS += (uint64_t)dwellS * dwellS;
+
+    uint8_t bucket = 0;
+    while (bucket < DWELL_BUCKETS - 1 && dwellS >= ANALYTICS_DWELL_EDGES_S[bucket]) bucket++;
+    if (_dwellHistogram[bucket] == 0xFFFF) {
+        for (uint8_t b = 0; b < DWELL_BUCKETS; ++b) {
+            _dwellHistogram[b] /= 2; // Same shape, room to count on
+        }
+    }
+    _dwellHistogram[bucket]++;
+}
+
+uint32_t ParkingAnalytics::dwellStdDevS() const {
+    if (_dwellCount < 2) return 0;
+    // Sample variance from the sums: (sum(x^2) - mean * sum(x)) / (n - 1).
+    // The integer mean makes it at most one mean (s^2) too large.
+    uint64_t meanTimesSum = (_dwellSumS / _dwellCount) * _dwellSumS;
+    if (_dwellSumSqS <= meanTimesSum) return 0;
+    return isqrt((_dwellSumSqS - meanTimesSum) / (_dwellCount - 1));
+}
+
+uint32_t ParkingAnalytics::dwellPercentileS(uint8_t percent) const {
+    uint32_t total = 0;
+    for (uint8_t b = 0; b < DWELL_BUCKETS; ++b) total += _dwellHistogram[b];
+    if (total == 0) return 0;
+
+    // Rank of the wanted car (1-based), then linear inside its bucket
+    uint32_t rank = (total * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint32_t below = 0;
+    for (uint8_t b = 0; b < DWELL_BUCKETS; ++b) {
+        uint16_t count = _dwellHistogram[b];
+        if (below + count >= rank) {
+            uint32_t lowS = b > 0 ? ANALYTICS_DWELL_EDGES_S[b - 1] : 0;
+            uint32_t highS = b < DWELL_BUCKETS - 1 ? ANALYTICS_DWELL_EDGES_S[b] : _dwellMaxS;
+            // Clamp to what was actually seen
+            if (lowS < dwellMinS()) lowS = dwellMinS();
+            if (highS > _dwellMaxS) highS = _dwellMaxS;
+            if (highS <= lowS) return lowS;
+            return lowS + (uint32_t)((uint64_t)(highS - lowS) * (rank - below) / count);
+        }
+        below += count;
+    }
+    return _dwellMaxS;
+}
+
+uint16_t ParkingAnalytics::averageOccupancyX100(uint32_t nowS) const {
+    uint32_t spanS = nowS - _startS;
+    if (spanS == 0) return _occupied * 100;
+    uint64_t carSeconds = _occupancyS + (uint64_t)_occupied * (nowS - _changeS);
+    return (uint16_t)(carSeconds * 100 / spanS);
+}
+
+uint32_t ParkingAnalytics::busyS(uint8_t slot, uint32_t nowS, uint32_t runningS) const {
+    if (slot >= NUM_SLOTS) return 0;
+    uint32_t spanS = nowS - _startS;
+    uint32_t busy = _busyS[slot] + runningS;
+    return busy < spanS ? busy : spanS;
+}
+
+uint16_t ParkingAnalytics::utilisationPermille(uint8_t slot, uint32_t nowS, uint32_t runningS) const {
+    uint32_t spanS = nowS - _startS;
+    if (spanS == 0) return runningS ? 1000 : 0;
+    return (uint16_t)((uint64_t)busyS(slot, nowS, runningS) * 1000 / spanS);
+}
+
+uint16_t ParkingAnalytics::arrivalsInHour(uint8_t hoursAgo, uint32_t nowS) const {
+    // Hours since the last arrival have no entries in the ring yet
+    uint32_t idle = nowS / 3600 - _hour;
+    if (hoursAgo < idle) return 0;
+    uint32_t back = hoursAgo - idle;
+    if (back >= ANALYTICS_ARRIVAL_HOURS) return 0;
+    return _hourly[(_hourIndex + ANALYTICS_ARRIVAL_HOURS - back) % ANALYTICS_ARRIVAL_HOURS];
+}
+
+uint32_t ParkingAnalytics::isqrt(uint64_t value) {
+    // Bit-by-bit integer square root
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
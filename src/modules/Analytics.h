@@ -0,0 +1,83 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "SlotMask.h"
+
+// Running parking statistics, updated in O(1) per event and answered without
+// any history: dwell-time sums (mean/variance) and a fixed-bucket histogram
+// (percentiles), arrivals per hour for the last ANALYTICS_ARRIVAL_HOURS,
+// occupancy (car-seconds integral, peak) and busy time per slot.
+// Fixed RAM, integer math only. Times are seconds on the caller's clock
+// (the journal clock in the sketch); everything counts from setup().
+class ParkingAnalytics {
+public:
+    // Start counting at nowS with the cars in parkedMask already parked
+    void setup(uint32_t nowS, SlotMask parkedMask);
+
+    // --- Events ---
+    void recordArrival(uint32_t nowS, bool admitted); // Car at the entry beam
+    void recordParked(uint8_t slot, uint32_t nowS);
+    void recordDeparture(uint8_t slot, uint32_t dwellS, uint32_t nowS);
+
+    // --- Queries ---
+    unsigned long arrivals() const { return _arrivals; }
+    unsigned long rejected() const { return _rejected; } // Turned away, garage full
+    unsigned long departures() const { return _dwellCount; }
+    uint8_t occupied() const { return _occupied; }
+    uint8_t peakOccupied() const { return _peak; }
+    uint32_t peakAtS() const { return _peakAtS; }
+    uint32_t sinceS(uint32_t nowS) const { return nowS - _startS; }
+
+    uint32_t dwellMinS() const { return _dwellCount ? _dwellMinS : 0; }
+    uint32_t dwellMaxS() const { return _dwellMaxS; }
+    uint32_t dwellMeanS() const { return _dwellCount ? (uint32_t)(_dwellSumS / _dwellCount) : 0; }
+    uint32_t dwellStdDevS() const;
+    // Dwell time below which percent of the cars left (histogram, interpolated)
+    uint32_t dwellPercentileS(uint8_t percent) const;
+    uint16_t dwellBucket(uint8_t bucket) const { return bucket < DWELL_BUCKETS ? _dwellHistogram[bucket] : 0; }
+
+    // Average number of parked cars since setup() x100
+    uint16_t averageOccupancyX100(uint32_t nowS) const;
+    // Time since setup() the slot was occupied, and its share in 0.1 %.
+    // runningS: parking time of the car in the slot now (0 if empty).
+    uint32_t busyS(uint8_t slot, uint32_t nowS, uint32_t runningS) const;
+    uint16_t utilisationPermille(uint8_t slot, uint32_t nowS, uint32_t runningS) const;
+    // Arrivals in the clock hour hoursAgo hours before the current one
+    uint16_t arrivalsInHour(uint8_t hoursAgo, uint32_t nowS) const;
+
+    static const uint8_t DWELL_BUCKETS = sizeof(ANALYTICS_DWELL_EDGES_S) / sizeof(ANALYTICS_DWELL_EDGES_S[0]) + 1;
+
+private:
+    uint32_t _startS = 0;
+    unsigned long _arrivals = 0;
+    unsigned long _rejected = 0;
+
+    // Occupancy: integral of parked cars over time, up to _changeS
+    uint64_t _occupancyS = 0;
+    uint32_t _changeS = 0;
+    uint8_t _occupied = 0;
+    uint8_t _peak = 0;
+    uint32_t _peakAtS = 0;
+
+    // Dwell times of departed cars
+    uint32_t _dwellCount = 0;
+    uint64_t _dwellSumS = 0;
+    uint64_t _dwellSumSqS = 0;
+    uint32_t _dwellMinS = 0;
+    uint32_t _dwellMaxS = 0;
+    uint16_t _dwellHistogram[DWELL_BUCKETS] = {0}; // Halved together when one saturates
+
+    // Arrivals per clock hour, ring ending at _hour (= nowS / 3600)
+    uint16_t _hourly[ANALYTICS_ARRIVAL_HOURS] = {0};
+    uint8_t _hourIndex = 0;
+    uint32_t _hour = 0;
+
+    uint32_t _busyS[NUM_SLOTS] = {0}; // Parking time of departed cars per slot
+
+    void integrate(uint32_t nowS);
+    static uint32_t isqrt(uint64_t value);
+};
+
+#endif // ANALYTICS_H
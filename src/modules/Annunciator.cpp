@@ -0,0 +1,88 @@
+#include "Annunciator.h"
+
+void Annunciator::setup(AnnunciatorOutput output) {
+    _output = output;
+    for (uint8_t i = 0; i < ANNUNCIATOR_CHANNELS; ++i) {
+        stop(i);
+    }
+    // Serial.println("Annunciator setup complete.");
+}
+
+bool Annunciator::play(uint8_t channel, const AnnunciatorPattern& pattern) {
+    if (channel >= ANNUNCIATOR_CHANNELS || pattern.stepCount == 0) return false;
+    Channel& c = _channels[channel];
+    bool oneShotPlaying = c.pattern && c.pattern->repeats != 0;
+    if (pattern.repeats == 0) {
+        c.loop = &pattern;
+        if (oneShotPlaying) return true; // Starts when the one-shot has ended
+    } else if (oneShotPlaying && pattern.priority < c.pattern->priority) {
+        _refused++;
+        return false;
+    }
+    start(channel, &pattern, Clock::ms());
+    return true;
+}
+
+void Annunciator::stop(uint8_t channel, const AnnunciatorPattern& pattern) {
+    if (channel >= ANNUNCIATOR_CHANNELS) return;
+    Channel& c = _channels[channel];
+    if (c.loop == &pattern) c.loop = nullptr;
+    if (c.pattern == &pattern) start(channel, c.loop, Clock::ms());
+}
+
+void Annunciator::stop(uint8_t channel) {
+    if (channel >= ANNUNCIATOR_CHANNELS) return;
+    _channels[channel].loop = nullptr;
+    start(channel, nullptr, 0);
+}
+
+uint32_t Annunciator::update() {
+    uint64_t now = Clock::ms();
+    uint64_t next = 0;
+    for (uint8_t i = 0; i < ANNUNCIATOR_CHANNELS; ++i) {
+        Channel& c = _channels[i];
+        bool wasOn = c.on;
+        // Several edges at once only if update() came late; the output gets the last level
+        while (c.pattern && c.edgeMs <= now) {
+            advance(c);
+        }
+        if (c.on != wasOn && _output) _output(i, c.on);
+        if (c.pattern && (next == 0 || c.edgeMs < next)) next = c.edgeMs;
+    }
+    return next ? (uint32_t)(next - now) : 0;
+}
+
+void Annunciator::start(uint8_t channel, const AnnunciatorPattern* pattern, uint64_t atMs) {
+    Channel& c = _channels[channel];
+    c.pattern = pattern;
+    c.step = 0;
+    c.round = 0;
+    if (pattern) c.edgeMs = atMs + pattern->steps[0];
+    setOutput(channel, pattern != nullptr);
+}
+
+// Next step of the playing pattern, timed from the edge that just passed
+void Annunciator::advance(Channel& c) {
+    const AnnunciatorPattern* pattern = c.pattern;
+    if (++c.step >= pattern->stepCount) {
+        c.step = 0;
+        if (pattern->repeats != 0 && ++c.round >= pattern->repeats) {
+            // One-shot done: the background loop starts over, or the channel goes quiet
+            c.round = 0;
+            c.pattern = pattern = c.loop;
+            if (!pattern) {
+                c.on = false;
+                return;
+            }
+        }
+    }
+    c.on = (c.step & 1) == 0; // Even steps are "on"
+    c.edgeMs += pattern->steps[c.step];
+}
+
+void Annunciator::setOutput(uint8_t channel, bool on) {
+    Channel& c = _channels[channel];
+    if (c.on == on) return;
+    c.on = on;
+    if (_output) _output(channel, on);
+}
@@ -0,0 +1,84 @@
+#ifndef ANNUNCIATOR_H
+#define ANNUNCIATOR_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "Clock.h"
+
+// One-shot patterns of a higher priority are not cut off by lower ones
+enum AnnunciatorPriority : uint8_t {
+    ANNUNCIATE_INFO = 0,
+    ANNUNCIATE_NOTICE,
+    ANNUNCIATE_ALERT
+};
+
+// Declarative on/off pattern: steps are alternating on and off times in ms,
+// starting with "on" (all > 0). The output is off once a pattern has ended,
+// so a single step is a plain beep. Repeated patterns should have an even
+// step count.
+struct AnnunciatorPattern {
+    const uint16_t* steps;
+    uint8_t stepCount;
+    uint8_t repeats;  // Times the steps are played; 0 = until stopped (background loop)
+    uint8_t priority; // AnnunciatorPriority, one-shots only
+};
+
+// Pattern over a constexpr step array from config.h
+template <uint8_t N>
+constexpr AnnunciatorPattern annunciatorPattern(const uint16_t (&steps)[N], uint8_t repeats,
+                                                uint8_t priority = ANNUNCIATE_INFO) {
+    return AnnunciatorPattern{steps, N, repeats, priority};
+}
+
+// Called on every output change (channel, on)
+typedef void (*AnnunciatorOutput)(uint8_t channel, bool on);
+
+// Plays on/off patterns on ANNUNCIATOR_CHANNELS outputs (buzzer, LEDs) without
+// polling: update() handles the edges that are due and returns the time to
+// the next one, so the caller can park it in a one-shot Scheduler task and
+// nothing runs between edges. Each channel plays one pattern at a time. A
+// looping pattern (repeats == 0) is the channel's background: a one-shot
+// plays over it and it starts again from its first step when the one-shot
+// ends. Edge times add up from the pattern start, so a late update() does
+// not make a pattern drift.
+class Annunciator {
+public:
+    void setup(AnnunciatorOutput output);
+
+    // Start pattern on channel (pattern must outlive it: static storage).
+    // False if a one-shot of a higher priority is playing.
+    // Call update() afterwards to reschedule.
+    bool play(uint8_t channel, const AnnunciatorPattern& pattern);
+    // Stop pattern if it is playing or looped on channel
+    void stop(uint8_t channel, const AnnunciatorPattern& pattern);
+    // Silence channel, background loop included
+    void stop(uint8_t channel);
+
+    // Apply every edge that is due; ms to the next edge, 0 if all are idle
+    uint32_t update();
+
+    bool isOn(uint8_t channel) const { return channel < ANNUNCIATOR_CHANNELS && _channels[channel].on; }
+    bool isPlaying(uint8_t channel) const {
+        return channel < ANNUNCIATOR_CHANNELS && _channels[channel].pattern != nullptr;
+    }
+    unsigned long refused() const { return _refused; } // One-shots not played (priority)
+
+private:
+    struct Channel {
+        const AnnunciatorPattern* pattern = nullptr; // Playing now
+        const AnnunciatorPattern* loop = nullptr;    // Background, resumes after a one-shot
+        uint64_t edgeMs = 0;                         // Clock::ms() of the next edge
+        uint8_t step = 0;
+        uint8_t round = 0;
+        bool on = false;
+    };
+    Channel _channels[ANNUNCIATOR_CHANNELS];
+    AnnunciatorOutput _output = nullptr;
+    unsigned long _refused = 0;
+
+    void start(uint8_t channel, const AnnunciatorPattern* pattern, uint64_t atMs);
+    void advance(Channel& c);
+    void setOutput(uint8_t channel, bool on);
+};
+
+#endif // ANNUNCIATOR_H
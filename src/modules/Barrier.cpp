@@ -1,25 +1,28 @@
 #include "Barrier.h"
+#include "TraceRecorder.h"
 
 void Barrier::setup() {
     _servo.attach(PIN_BARRIER_SERVO);
-    close(); // Start with the barrier closed
+    // Start with the barrier closed (write directly: close() skips an already-closed barrier)
+    _servo.write(BARRIER_CLOSED_ANGLE);
+    _isOpen = false;
     // Serial.println("Barrier setup complete.");
 }
 
 void Barrier::open() {
     if (!_isOpen) {
         _servo.write(BARRIER_OPEN_ANGLE);
-        delay(BARRIER_DELAY_MS); // Wait for servo to reach position
         _isOpen = true;
-        // Serial.println("Barrier opened.");
+        TRACE_BARRIER(true);
+        // Serial.println("Barrier opening.");
     }
 }
 
 void Barrier::close() {
     if (_isOpen) {
         _servo.write(BARRIER_CLOSED_ANGLE);
-        delay(BARRIER_DELAY_MS); // Wait for servo to reach position
         _isOpen = false;
-        // Serial.println("Barrier closed.");
+        TRACE_BARRIER(false);
+        // Serial.println("Barrier closing.");
     }
 }
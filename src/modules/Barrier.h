@@ -8,8 +8,10 @@
 class Barrier {
 public:
     void setup();
+    // Start moving the barrier; both return immediately
     void open();
     void close();
+    bool isOpen() const { return _isOpen; }
 
 private:
     Servo _servo;    // Servo object
@@ -1,70 +1,169 @@
 #include "BluetoothCmd.h"
+#include "Profiler.h"
+#include "TraceRecorder.h"
 
-// Setup: Initialize Serial and store callbacks
-void BluetoothCmd::setup(RotateCmdCallback rotateCallback, StatusCmdCallback statusCallback) {
+// Setup: Initialize Serial and store the command table
+void BluetoothCmd::setup(const BluetoothCommand* commands, uint8_t commandCount) {
     // Assuming HC-05 default baud rate is often 9600, but might be 38400 or other.
     // Make sure this matches the HC-05 configuration AND monitor_speed in platformio.ini if debugging.
     // Note: Using Hardware Serial (Serial) conflicts with USB programming/Serial Monitor
     // unless you disconnect the HC-05 during upload or use SoftwareSerial.
     Serial.begin(SERIAL_BAUD_RATE); // Use baud rate from config.h
-    _commandBuffer.reserve(64); // Pre-allocate buffer space
-    _onRotateCmd = rotateCallback;
-    _onStatusCmd = statusCallback;
+    _commands = commands;
+    _commandCount = commandCount;
     // Serial.println("BluetoothCmd setup complete. Ready for commands...");
 }
 
 // Check for incoming commands from Serial
 void BluetoothCmd::checkCommands() {
+    PROFILE_SCOPE(PROBE_COMMANDS);
     while (Serial.available() > 0) {
-        char receivedChar = Serial.read();
+        uint8_t received = Serial.read();
 
-        if (receivedChar == COMMAND_TERMINATOR) {
-            // End of command reached, process it
-            _commandBuffer.trim(); // Remove leading/trailing whitespace
-            if (_commandBuffer.length() > 0) {
-                // Serial.print("Received command: "); Serial.println(_commandBuffer);
-                processCommand(_commandBuffer);
-            }
-            _commandBuffer = ""; // Clear buffer for next command
-        } else if (isPrintable(receivedChar)) {
-            // Append printable characters to the buffer
-            if (_commandBuffer.length() < 63) { // Prevent buffer overflow
-                 _commandBuffer += receivedChar;
-            }
-        } 
-        // Ignore non-printable characters (except terminator)
+        switch (_rxMode) {
+            case RX_TEXT:
+                if (received == (uint8_t)COMMAND_TERMINATOR) {
+                    // End of command reached, process it
+                    if (_lineOverflow) {
+                        _stats.overflows++;
+                    } else if (_lineLength > 0) {
+                        processLine(micros());
+                    }
+                    _lineLength = 0;
+                    _lineOverflow = false;
+                } else if (BT_BINARY_FRAMES_ENABLED && received == FRAME_SYNC && _lineLength == 0) {
+                    _rxMode = RX_FRAME_LEN; // Start of a binary frame
+                } else if (isPrintable(received)) {
+                    // Store upper-cased so the compare is case-insensitive
+                    if (_lineLength < LINE_BUFFER_SIZE - 1) {
+                        _line[_lineLength++] = (received >= 'a' && received <= 'z') ? received - 32 : received;
+                    } else {
+                        _lineOverflow = true; // Drop the whole line
+                    }
+                }
+                // Ignore non-printable characters (except terminator)
+                break;
+
+            case RX_FRAME_LEN:
+                if (received == 0 || received > sizeof(_frame) - 1) {
+                    _stats.crcErrors++; // Impossible length: resync on the next byte
+                    _rxMode = RX_TEXT;
+                } else {
+                    _frameLength = received;
+                    _frameReceived = 0;
+                    _rxMode = RX_FRAME_BODY;
+                }
+                break;
+
+            case RX_FRAME_BODY:
+                _frame[_frameReceived++] = received;
+                if (_frameReceived == _frameLength + 1) { // Body + CRC
+                    processFrame(micros());
+                    _rxMode = RX_TEXT;
+                }
+                break;
+        }
     }
 }
 
-// Parse and act on a received command line
-void BluetoothCmd::processCommand(String commandLine) {
-    // Convert command to uppercase for case-insensitive comparison
-    commandLine.toUpperCase(); 
+// Tokenize the text line in place and look the command up in the table
+void BluetoothCmd::processLine(uint32_t startUs) {
+    _line[_lineLength] = '\0';
+
+    char* tokens[1 + MAX_ARGS];
+    uint8_t tokenCount = 0;
+    char* p = _line;
+    while (*p) {
+        while (*p == ' ') *p++ = '\0';
+        if (!*p) break;
+        if (tokenCount == 1 + MAX_ARGS) { tokenCount++; break; } // Too many arguments
+        tokens[tokenCount++] = p;
+        while (*p && *p != ' ') p++;
+    }
+    if (tokenCount == 0) return;
 
-    if (commandLine.startsWith("ROTATE ")) {
-        // Extract angle value
-        String angleStr = commandLine.substring(7); // Get text after "ROTATE "
-        angleStr.trim();
-        int angle = angleStr.toInt(); // Convert to integer
+    for (uint8_t i = 0; i < _commandCount; ++i) {
+        const BluetoothCommand& cmd = _commands[i];
+        if (strcmp(tokens[0], cmd.name) != 0) continue;
 
-        // Check if conversion was successful (toInt returns 0 on failure)
-        // and if a callback is registered
-        if ((angle != 0 || angleStr == "0") && _onRotateCmd) { 
-             _onRotateCmd(angle);
-        } else {
-            // Serial.println("Error: Invalid angle for ROTATE command.");
+        int16_t args[MAX_ARGS];
+        uint8_t argc = tokenCount - 1;
+        if (argc != cmd.arity) {
+            _stats.badArgs++;
+            // Serial.print("Error: wrong argument count for "); Serial.println(cmd.name);
+            return;
         }
-    } else if (commandLine == "STATUS") {
-        if (_onStatusCmd) {
-            _onStatusCmd();
+        for (uint8_t a = 0; a < argc; ++a) {
+            if (!parseInt(tokens[a + 1], args[a])) {
+                _stats.badArgs++;
+                return;
+            }
+        }
+        _stats.textCommands++;
+        dispatch(cmd, args, argc, startUs);
+        return;
+    }
+    _stats.unknown++;
+    // Serial.print("Unknown command: "); Serial.println(tokens[0]);
+}
+
+// Validate a binary frame and dispatch it by opcode
+void BluetoothCmd::processFrame(uint32_t startUs) {
+    uint8_t crc = crc8(&_frameLength, 1);
+    crc = crc8(_frame, _frameLength, crc);
+    if (crc != _frame[_frameLength] || (_frameLength - 1) % 2 != 0) {
+        _stats.crcErrors++;
+        return;
+    }
+
+    uint8_t opcode = _frame[0];
+    if (opcode >= _commandCount) {
+        _stats.unknown++;
+        return;
+    }
+    const BluetoothCommand& cmd = _commands[opcode];
+    uint8_t argc = (_frameLength - 1) / 2;
+    if (argc != cmd.arity) {
+        _stats.badArgs++;
+        return;
+    }
+    int16_t args[MAX_ARGS];
+    for (uint8_t a = 0; a < argc; ++a) {
+        args[a] = (int16_t)(_frame[1 + 2 * a] | (_frame[2 + 2 * a] << 8));
+    }
+    _stats.binaryFrames++;
+    dispatch(cmd, args, argc, startUs);
+}
+
+void BluetoothCmd::dispatch(const BluetoothCommand& cmd, const int16_t* args, uint8_t argc, uint32_t startUs) {
+    uint32_t elapsed = micros() - startUs;
+    _stats.lastDispatchUs = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+    if (_stats.lastDispatchUs > _stats.maxDispatchUs) {
+        _stats.maxDispatchUs = _stats.lastDispatchUs;
+    }
+    TRACE_COMMAND(&cmd - _commands, args, argc);
+    if (cmd.handler) {
+        cmd.handler(args, argc);
+    }
+}
+
+// Strict decimal parse: the whole token must be a number in int16 range
+bool BluetoothCmd::parseInt(const char* token, int16_t& value) {
+    char* end;
+    long parsed = strtol(token, &end, 10);
+    if (end == token || *end != '\0' || parsed < -32768 || parsed > 32767) {
+        return false;
+    }
+    value = (int16_t)parsed;
+    return true;
+}
+
+uint8_t BluetoothCmd::crc8(const uint8_t* data, uint8_t len, uint8_t crc) {
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
         }
-    } else if (commandLine == "START") {
-        // Add handling for START command if needed (e.g., trigger entry)
-        // if (_onStartCmd) _onStartCmd();
-        // Serial.println("Received START command (handler not implemented)");
-    } 
-    // Add more else if blocks for other commands (e.g., OPEN, CLOSE, RESET)
-    else {
-        // Serial.print("Unknown command: "); Serial.println(commandLine);
     }
+    return crc;
 }
@@ -4,30 +4,73 @@
 #include "../config.h"
 #include <Arduino.h>
 
-// Forward declare main sketch functions or use function pointers/callbacks
-// Example callbacks (adjust signature as needed):
-typedef void (*RotateCmdCallback)(int angle);
-typedef void (*StatusCmdCallback)();
-// Add more callback types for other commands (START, etc.)
+// Command handler: receives the command's integer arguments, already parsed
+// (text "ROTATE 90" and a binary ROTATE frame end up in the same call)
+typedef void (*CommandHandler)(const int16_t* args, uint8_t argc);
 
+// One entry of the command table defined in the main sketch
+struct BluetoothCommand {
+    const char* name;       // Upper-case keyword, e.g. "ROTATE"
+    uint8_t arity;          // Number of integer arguments expected
+    CommandHandler handler;
+};
+
+// Line/frame parser for the HC-05 link. No String, no heap:
+// - Text mode: "<NAME> [arg ...]\n", case-insensitive, tokenized in place.
+// - Binary mode (BT_BINARY_FRAMES_ENABLED): 0xA5, LEN, OPCODE, args as int16
+//   little-endian, CRC-8 (poly 0x07) over LEN..args. OPCODE is the index of
+//   the command in the table, LEN = 1 + 2 * arity.
 class BluetoothCmd {
 public:
-    // Pass function pointers during setup
-    void setup(RotateCmdCallback rotateCallback, StatusCmdCallback statusCallback);
+    // Pass the command table during setup (must outlive the parser)
+    void setup(const BluetoothCommand* commands, uint8_t commandCount);
     
     // Call this regularly in the main loop to check for incoming commands
     void checkCommands(); 
 
+    // Counters and timing to compare both modes
+    struct Stats {
+        uint16_t textCommands = 0;  // Dispatched text commands
+        uint16_t binaryFrames = 0;  // Dispatched binary frames
+        uint16_t unknown = 0;       // Unknown name or opcode
+        uint16_t badArgs = 0;       // Wrong argument count or non-numeric argument
+        uint16_t crcErrors = 0;     // Binary frames with a bad CRC or length
+        uint16_t overflows = 0;     // Text lines longer than the buffer
+        uint16_t lastDispatchUs = 0; // Parse + lookup time of the last command (handler excluded)
+        uint16_t maxDispatchUs = 0;
+    };
+    const Stats& stats() const { return _stats; }
+
+    // CRC-8, polynomial 0x07, init 0 (also used by anything that builds frames)
+    static uint8_t crc8(const uint8_t* data, uint8_t len, uint8_t crc = 0);
+
+    static const uint8_t FRAME_SYNC = 0xA5;
+
 private:
-    String _commandBuffer = ""; // Buffer for incoming serial data
+    static const uint8_t LINE_BUFFER_SIZE = 64;
+    static const uint8_t MAX_ARGS = 4;
     const char COMMAND_TERMINATOR = '\n'; // Character indicating end of command
 
-    // Pointers to callback functions in the main sketch
-    RotateCmdCallback _onRotateCmd = nullptr;
-    StatusCmdCallback _onStatusCmd = nullptr;
+    const BluetoothCommand* _commands = nullptr;
+    uint8_t _commandCount = 0;
+
+    char _line[LINE_BUFFER_SIZE]; // Text line, upper-cased as it arrives
+    uint8_t _lineLength = 0;
+    bool _lineOverflow = false;
+
+    // Binary frame receive state
+    enum RxMode : uint8_t { RX_TEXT, RX_FRAME_LEN, RX_FRAME_BODY };
+    RxMode _rxMode = RX_TEXT;
+    uint8_t _frame[1 + 2 * MAX_ARGS + 1]; // OPCODE, args, CRC
+    uint8_t _frameLength = 0;   // Expected OPCODE+args length
+    uint8_t _frameReceived = 0;
+
+    Stats _stats;
 
-    // Function to process a complete command line
-    void processCommand(String commandLine);
+    void processLine(uint32_t startUs);
+    void processFrame(uint32_t startUs);
+    void dispatch(const BluetoothCommand& cmd, const int16_t* args, uint8_t argc, uint32_t startUs);
+    static bool parseInt(const char* token, int16_t& value);
 };
 
 #endif // BLUETOOTH_CMD_H
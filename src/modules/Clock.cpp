@@ -0,0 +1,21 @@
+#include "Clock.h"
+
+uint64_t Clock::_ms = 0;
+uint64_t Clock::_us = 0;
+uint32_t Clock::_seconds = 0;
+uint64_t Clock::_secondStartMs = 0;
+
+void Clock::update() {
+    uint32_t ms = millis();
+    uint32_t us = micros();
+    // A low half smaller than last time means the counter wrapped since then
+    if (ms < (uint32_t)_ms) _ms += 0x100000000ULL;
+    _ms = (_ms & 0xFFFFFFFF00000000ULL) | ms;
+    if (us < (uint32_t)_us) _us += 0x100000000ULL;
+    _us = (_us & 0xFFFFFFFF00000000ULL) | us;
+
+    while (_ms - _secondStartMs >= 1000) {
+        _secondStartMs += 1000;
+        _seconds++;
+    }
+}
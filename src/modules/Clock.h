@@ -0,0 +1,71 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Monotonic time base for the whole firmware.
+// The core's timer 0 interrupt keeps the 32-bit millis() and micros()
+// counters, which wrap after 49.7 days and 71.6 minutes. Clock extends both
+// to 64 bits by counting their wraps. update() runs at the top of setup()
+// and of every loop() pass, and takes a snapshot that everything in the pass
+// reads without touching the timer again. Main loop only: interrupt handlers
+// keep using micros().
+//
+// Time in the firmware comes in two kinds:
+// - Instants and long intervals (deadlines, task due times, parking times)
+//   use Clock, Deadline and Interval, and never wrap.
+// - Short intervals on hot paths and in interrupts (echo widths, debounce,
+//   probe and dispatch times) use uint32_t micros() stamps, compared only by
+//   subtraction (now - then). That stays right across the wrap for intervals
+//   under 71 minutes and costs nothing extra.
+class Clock {
+public:
+    // Take the snapshot. Must run at least once per micros() period (71 min).
+    static void update();
+
+    static uint64_t ms() { return _ms; }
+    static uint64_t us() { return _us; }
+    // Whole seconds since boot (kept incrementally: no 64-bit division)
+    static uint32_t seconds() { return _seconds; }
+
+private:
+    static uint64_t _ms;
+    static uint64_t _us;
+    static uint32_t _seconds;
+    static uint64_t _secondStartMs;
+};
+
+// One-shot timeout on the Clock. An unarmed deadline never expires.
+struct Deadline {
+    uint64_t dueMs = 0;
+    bool armed = false;
+
+    void set(uint32_t ms) { dueMs = Clock::ms() + ms; armed = true; }
+    void clear() { armed = false; }
+    bool isArmed() const { return armed; }
+    // True once the deadline has passed
+    bool expired() const { return armed && Clock::ms() >= dueMs; }
+    uint32_t remainingMs() const {
+        if (!armed || Clock::ms() >= dueMs) return 0;
+        return (uint32_t)(dueMs - Clock::ms());
+    }
+};
+
+// Fixed-rate period on the Clock: due() is true once per period, without
+// drift. After a stall the missed periods are skipped, not fired in a burst.
+struct Interval {
+    uint64_t nextMs = 0;
+    uint32_t periodMs = 0; // 0 = stopped
+
+    void start(uint32_t ms) { periodMs = ms; nextMs = Clock::ms() + ms; }
+    void stop() { periodMs = 0; }
+    bool due() {
+        if (periodMs == 0 || Clock::ms() < nextMs) return false;
+        nextMs += periodMs;
+        if (nextMs <= Clock::ms()) nextMs = Clock::ms() + periodMs;
+        return true;
+    }
+};
+
+#endif // CLOCK_H
@@ -1,39 +1,125 @@
 #include "Display.h"
+#include "FastPin.h"
+#include "Profiler.h"
 
-// Constructor for LiquidCrystal_I2C
-Display::Display() : _lcd(LCD_ADDR, LCD_COLS, LCD_ROWS) {}
+#if SLOT_IO_MULTIPLEXED
+// 74HC595 chain: shifted out MSB first, so the last bit clocked in lands on Q0
+typedef FastPin<PIN_LED_DATA> LedData;
+typedef FastPin<PIN_LED_CLOCK> LedClock;
+typedef FastPin<PIN_LED_LATCH> LedLatch;
+#else
+// Slot LED pins resolved to port + bit at compile time. A LED on a TWI pin
+// is never driven (see PINS_LED_RED in config.h): the I2C bus owns that pin.
+static constexpr PinTable<NUM_SLOTS> LED_GREEN = makePinTable(PINS_LED_GREEN);
+static constexpr PinTable<NUM_SLOTS> LED_RED = makePinTable(PINS_LED_RED);
+static constexpr uint8_t ledPortMask(uint8_t port) {
+    return (pinPortMask(PINS_LED_GREEN, port) | pinPortMask(PINS_LED_RED, port)) & ~twiPortMask(port);
+}
+static constexpr uint8_t LED_PORT_MASK[FAST_PORT_COUNT] = {
+    ledPortMask(FAST_PORT_B),
+    ledPortMask(FAST_PORT_C),
+    ledPortMask(FAST_PORT_D),
+};
+
+static void writeLed(const PinRef& led, uint8_t level) {
+    if (!fastPinIsTwi(led.pin)) fastWrite(led, level);
+}
+#endif
+
+// PCF8574 backpack wiring: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4..P7 = D4..D7
+static const uint8_t LCD_RS = 0x01;
+static const uint8_t LCD_EN = 0x04;
+static const uint8_t LCD_BACKLIGHT = 0x08;
+
+// HD44780 commands
+static const uint8_t LCD_CMD_CLEAR = 0x01;
+static const uint8_t LCD_CMD_ENTRY_MODE = 0x06;   // Increment, no shift
+static const uint8_t LCD_CMD_DISPLAY_ON = 0x0C;   // Display on, cursor off, blink off
+static const uint8_t LCD_CMD_FUNCTION_SET = 0x28; // 4-bit, 2 lines, 5x8 font
+static const uint8_t LCD_CMD_SET_DDRAM = 0x80;
+static const uint8_t LCD_ROW_OFFSETS[] = {0x00, 0x40, 0x14, 0x54};
+
+// Encodes one LCD byte as two nibble strobes (4 expander writes)
+static uint8_t encodeLcdByte(uint8_t* out, uint8_t value, uint8_t mode) {
+    uint8_t high = (value & 0xF0) | mode | LCD_BACKLIGHT;
+    uint8_t low = ((value << 4) & 0xF0) | mode | LCD_BACKLIGHT;
+    out[0] = high | LCD_EN;
+    out[1] = high;
+    out[2] = low | LCD_EN;
+    out[3] = low;
+    return 4;
+}
+
+// Setup-time helper: sends bytes and waits for the bus to finish
+static void sendBlocking(const uint8_t* data, uint8_t length) {
+    I2cBus::write(LCD_ADDR, data, length);
+    I2cBus::waitIdle();
+}
+
+// Setup-time helper: one LCD command (or only its high nibble during the 8->4 bit switch)
+static void sendInitCommand(uint8_t value, bool highNibbleOnly) {
+    uint8_t buf[4];
+    uint8_t length = encodeLcdByte(buf, value, 0);
+    sendBlocking(buf, highNibbleOnly ? 2 : length);
+}
 
 void Display::setup() {
-    // Initialize LCD
-    _lcd.init();
-    _lcd.backlight();
-    _lcd.clear();
-    _lcd.print("System Init...");
+    // Initialize LCD (HD44780 4-bit init sequence). Runs once at boot, so the
+    // datasheet delays are plain delay()/delayMicroseconds() calls.
+    // Requires I2cBus::setup() to have been called.
+    delay(50); // Power-on time
+    sendInitCommand(0x30, true);
+    delayMicroseconds(4500);
+    sendInitCommand(0x30, true);
+    delayMicroseconds(4500);
+    sendInitCommand(0x30, true);
+    delayMicroseconds(150);
+    sendInitCommand(0x20, true); // Switch to 4-bit mode
+    sendInitCommand(LCD_CMD_FUNCTION_SET, false);
+    sendInitCommand(LCD_CMD_DISPLAY_ON, false);
+    sendInitCommand(LCD_CMD_CLEAR, false);
+    delayMicroseconds(2000);
+    sendInitCommand(LCD_CMD_ENTRY_MODE, false);
+
+    // The LCD is blank now: frame and shadow both start as spaces
+    memset(_shadow, ' ', sizeof(_shadow));
+    memset(_frame, ' ', sizeof(_frame));
+    print("System Init...", 0);
+    flush();
+    I2cBus::waitIdle();
 
     // Initialize LED pins
+#if SLOT_IO_MULTIPLEXED
+    LedData::output();
+    LedClock::output();
+    LedLatch::output();
+    LedLatch::low();
+#else
     for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
-        pinMode(PINS_LED_GREEN[i], OUTPUT);
-        pinMode(PINS_LED_RED[i], OUTPUT);
-        setSlotLED(i, GREEN); // Default to GREEN (available)
+        if (!fastPinIsTwi(PINS_LED_GREEN[i])) pinMode(PINS_LED_GREEN[i], OUTPUT);
+        if (!fastPinIsTwi(PINS_LED_RED[i])) pinMode(PINS_LED_RED[i], OUTPUT);
     }
+#endif
+    setSlotLEDs(ALL_SLOTS_MASK, 0); // Default to GREEN (available)
     // Serial.println("Display setup complete.");
 }
 
-void Display::clearLine(uint8_t line) {
-    _lcd.setCursor(0, line);
-    for (uint8_t i = 0; i < LCD_COLS; ++i) {
-        _lcd.print(" ");
-    }
+void Display::clearFrameLine(uint8_t line) {
+    memset(_frame[line], ' ', LCD_COLS);
 }
 
+// Writes the message into the frame; nothing is sent to the LCD here
 void Display::print(const char* message, uint8_t line, bool clearLine) {
+    PROFILE_SCOPE(PROBE_DISPLAY);
     if (line >= LCD_ROWS) return; // Basic bounds check
 
     if (clearLine) {
-        clearLine(line);
+        clearFrameLine(line);
+    }
+    for (uint8_t col = 0; col < LCD_COLS && message[col]; ++col) {
+        _frame[line][col] = message[col];
     }
-    _lcd.setCursor(0, line);
-    _lcd.print(message);
+    _dirty = true;
 }
 
 // Overload for String objects
@@ -42,58 +128,162 @@ void Display::print(String message, uint8_t line, bool clearLine) {
 }
 
 void Display::clear() {
-    _lcd.clear();
+    // Blank the frame instead of sending the (slow) LCD clear command
+    memset(_frame, ' ', sizeof(_frame));
+    _dirty = true;
+}
+
+void Display::update() {
+    if (_dirty && Clock::ms() - _lastFlushMs >= DISPLAY_REFRESH_MS) {
+        flush();
+    }
+}
+
+// Starts pushing the changed cells; each row goes out as one queued I2C
+// transaction and the next row is encoded when the previous one completes.
+void Display::flush() {
+    if (_txBusy) return; // A flush is already running; it picks up new changes
+    _dirty = false;      // Changes made from now on need another flush
+    _lastFlushMs = Clock::ms();
+    _flushRow = 0;
+    continueFlush();
+}
+
+void Display::continueFlush() {
+    while (_flushRow < LCD_ROWS) {
+        uint8_t row = _flushRow++;
+        _txLength = encodeRow(row);
+        if (_txLength == 0) continue; // Row unchanged
+        if (I2cBus::write(LCD_ADDR, _tx, _txLength, onTxDone, this)) {
+            _txBusy = true;
+            _txRow = row;
+        } else {
+            invalidateRow(row); // Queue full: resend this row on the next flush
+            _dirty = true;
+        }
+        return;
+    }
+}
+
+// I2C completion (loop context): continue with the next row
+void Display::onTxDone(void* context, I2cStatus status) {
+    Display* display = static_cast<Display*>(context);
+    display->_txBusy = false;
+    if (status != I2C_OK) {
+        display->invalidateRow(display->_txRow);
+        display->_dirty = true;
+    }
+    display->continueFlush();
+}
+
+// Forget what the LCD shows on a row so every cell is resent
+void Display::invalidateRow(uint8_t row) {
+    memset(_shadow[row], 0, LCD_COLS);
+}
+
+// Encodes only the changed cells of one row into _tx. Runs separated by a
+// single unchanged cell are merged: rewriting one character costs the same as
+// a cursor move. Returns the number of expander bytes.
+uint8_t Display::encodeRow(uint8_t row) {
+    uint8_t length = 0;
+    uint8_t col = 0;
+    while (col < LCD_COLS) {
+        if (_frame[row][col] == _shadow[row][col]) {
+            col++;
+            continue;
+        }
+        // Find the end of this run of changed cells
+        uint8_t end = col + 1;
+        while (end < LCD_COLS) {
+            if (_frame[row][end] != _shadow[row][end]) {
+                end++;
+            } else if (end + 1 < LCD_COLS && _frame[row][end + 1] != _shadow[row][end + 1]) {
+                end += 2; // Bridge a one-cell gap
+            } else {
+                break;
+            }
+        }
+        length += encodeLcdByte(&_tx[length], LCD_CMD_SET_DDRAM | (LCD_ROW_OFFSETS[row] + col), 0);
+        _cursorMoves++;
+        for (uint8_t c = col; c < end; ++c) {
+            length += encodeLcdByte(&_tx[length], _frame[row][c], LCD_RS);
+            _shadow[row][c] = _frame[row][c];
+        }
+        _charsWritten += end - col;
+        col = end;
+    }
+    return length;
 }
 
 void Display::setSlotLED(uint8_t slot, LedState state) {
     if (slot >= NUM_SLOTS) return; // Basic bounds check
 
-    // Turn off both LEDs first
-    digitalWrite(PINS_LED_GREEN[slot], LOW);
-    digitalWrite(PINS_LED_RED[slot], LOW);
-
-    // Turn on the selected LED
+#if SLOT_IO_MULTIPLEXED
+    SlotMask bit = slotBit(slot);
+    _ledGreen &= ~bit;
+    _ledRed &= ~bit;
+    if (state == GREEN || state == FLASHING_GREEN) _ledGreen |= bit;
+    if (state == RED || state == FLASHING_RED) _ledRed |= bit;
+    shiftOutLEDs();
+#else
+    // Turn on the selected LED, the other one off
     switch (state) {
         case GREEN:
-            digitalWrite(PINS_LED_GREEN[slot], HIGH);
+        case FLASHING_GREEN: // Steady; blinking comes from an Annunciator pattern
+            writeLed(LED_RED[slot], LOW);
+            writeLed(LED_GREEN[slot], HIGH);
             break;
         case RED:
-            digitalWrite(PINS_LED_RED[slot], HIGH);
+        case FLASHING_RED:
+            writeLed(LED_GREEN[slot], LOW);
+            writeLed(LED_RED[slot], HIGH);
             break;
         case OFF:
-            // Already off
-            break;
-        case FLASHING_GREEN: // Basic implementation (just turns on green)
-             // TODO: Implement flashing logic (requires periodic calls)
-            digitalWrite(PINS_LED_GREEN[slot], HIGH);
-            break;
-        case FLASHING_RED: // Basic implementation (just turns on red)
-            // TODO: Implement flashing logic (requires periodic calls)
-             digitalWrite(PINS_LED_RED[slot], HIGH);
+            writeLed(LED_GREEN[slot], LOW);
+            writeLed(LED_RED[slot], LOW);
             break;
     }
-    // Optional: Store state if implementing flashing
-    // _currentLedState[slot] = state;
+#endif
 }
 
-/* Optional: Update method for non-blocking flashing
-void Display::update() {
-    unsigned long currentMillis = millis();
+#if SLOT_IO_MULTIPLEXED
+// All slot LEDs at once: one pass over the shift register chain, then latch
+void Display::setSlotLEDs(SlotMask greenMask, SlotMask redMask) {
+    greenMask &= ALL_SLOTS_MASK;
+    _ledGreen = greenMask;
+    _ledRed = redMask & ~greenMask;
+    shiftOutLEDs();
+}
+
+// 2 bits per slot, green then red, highest slot first so slot 0 ends up on the
+// first register. About 2 us per bit with direct port I/O.
+void Display::shiftOutLEDs() {
+    for (int8_t i = NUM_SLOTS - 1; i >= 0; --i) {
+        SlotMask bit = slotBit(i);
+        LedData::write((_ledGreen & bit) != 0);
+        LedClock::high();
+        LedClock::low();
+        LedData::write((_ledRed & bit) != 0);
+        LedClock::high();
+        LedClock::low();
+    }
+    LedLatch::high(); // Outputs change together on the latch edge
+    LedLatch::low();
+}
+#else
+// All slot LEDs at once: one port write per port instead of two pin writes per slot
+void Display::setSlotLEDs(SlotMask greenMask, SlotMask redMask) {
+    uint8_t value[FAST_PORT_COUNT] = {0};
     for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
-        if (_currentLedState[i] == FLASHING_GREEN || _currentLedState[i] == FLASHING_RED) {
-            if (currentMillis - _lastFlashTime[i] >= 500) { // Flash interval (e.g., 500ms)
-                _lastFlashTime[i] = currentMillis;
-                _ledFlashState[i] = !_ledFlashState[i]; // Toggle state
-
-                if (_currentLedState[i] == FLASHING_GREEN) {
-                    digitalWrite(PINS_LED_GREEN[i], _ledFlashState[i] ? HIGH : LOW);
-                    digitalWrite(PINS_LED_RED[i], LOW);
-                } else { // FLASHING_RED
-                    digitalWrite(PINS_LED_RED[i], _ledFlashState[i] ? HIGH : LOW);
-                    digitalWrite(PINS_LED_GREEN[i], LOW);
-                }
-            }
+        SlotMask bit = slotBit(i);
+        if (greenMask & bit) {
+            value[LED_GREEN[i].port] |= LED_GREEN[i].mask;
+        } else if (redMask & bit) {
+            value[LED_RED[i].port] |= LED_RED[i].mask;
         }
     }
+    for (uint8_t port = 0; port < FAST_PORT_COUNT; ++port) {
+        fastPortWrite(port, LED_PORT_MASK[port], value[port]);
+    }
 }
-*/
+#endif
@@ -3,35 +3,67 @@
 
 #include "../config.h"
 #include <Arduino.h>
-#include <LiquidCrystal_I2C.h> // Library for I2C LCD
-#include <Wire.h>             // Required for I2C
+#include "I2cBus.h"           // LCD traffic goes through the shared I2C queue
+#include "SlotMask.h"
+#include "Clock.h"
 
 // Enum for LED colors/states
 enum LedState {
     OFF,
     GREEN,
     RED,
-    FLASHING_GREEN, // Add more states if needed (e.g., flashing)
-    FLASHING_RED
+    FLASHING_GREEN, // Shown steady here; the blinking is an Annunciator
+    FLASHING_RED    // pattern switching the LED through setSlotLEDs()
 };
 
+// LCD output goes through a shadow framebuffer: print()/clear() only edit the
+// in-RAM frame, and update() pushes the cells that differ from what the LCD
+// already shows (cursor-set + character runs), at most every DISPLAY_REFRESH_MS.
+// The HD44780 (PCF8574 backpack) is driven directly through I2cBus, so LCD
+// writes are queued transactions instead of blocking Wire calls.
 class Display {
 public:
     void setup();
     void print(const char* message, uint8_t line = 0, bool clearLine = true);
     void print(String message, uint8_t line = 0, bool clearLine = true);
     void setSlotLED(uint8_t slot, LedState state);
+    // Set every slot LED in one go (bit i = slot i; green wins if both are set)
+    void setSlotLEDs(SlotMask greenMask, SlotMask redMask);
     void clear();
-    // void update(); // Optional: for handling flashing LEDs without blocking
+    // Periodic task: flush changed cells if the refresh interval has passed
+    void update();
+    // Start pushing all pending changes to the LCD now (non-blocking)
+    void flush();
+    // Number of characters and cursor moves sent to the LCD so far
+    unsigned long charsWritten() const { return _charsWritten; }
+    unsigned long cursorMoves() const { return _cursorMoves; }
 
 private:
-    LiquidCrystal_I2C _lcd;
-    // Optional: Add state for flashing LEDs
-    // unsigned long _lastFlashTime[NUM_SLOTS] = {0};
-    // bool _ledFlashState[NUM_SLOTS] = {false};
-    // LedState _currentLedState[NUM_SLOTS] = {OFF};
+    char _frame[LCD_ROWS][LCD_COLS];  // What should be on screen
+    char _shadow[LCD_ROWS][LCD_COLS]; // What the LCD currently shows
+    bool _dirty = false;
+    // One row in flight: cursor command + up to LCD_COLS characters, 4 expander bytes each
+    uint8_t _tx[4 * (LCD_COLS + 1)];
+    uint8_t _txLength = 0;
+    uint8_t _txRow = 0;
+    uint8_t _flushRow = LCD_ROWS; // Next row to check in the running flush
+    bool _txBusy = false;
+    uint64_t _lastFlushMs = 0; // Clock::ms()
+    unsigned long _charsWritten = 0;
+    unsigned long _cursorMoves = 0;
 
-    void clearLine(uint8_t line);
+#if SLOT_IO_MULTIPLEXED
+    // LED state mirrored from the 74HC595 chain (bit i = slot i)
+    SlotMask _ledGreen = 0;
+    SlotMask _ledRed = 0;
+    void shiftOutLEDs();
+#endif
+
+    void clearFrameLine(uint8_t line);
+    void continueFlush();
+    uint8_t encodeRow(uint8_t row);
+    void invalidateRow(uint8_t row);
+    static void onTxDone(void* context, I2cStatus status);
 };
 
 #endif // DISPLAY_H
@@ -0,0 +1,183 @@
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Direct port I/O for the UNO (ATmega328P). digitalWrite()/digitalRead() look
+// the pin's port and bit up at run time (several us per call); here they are
+// resolved at compile time from the constants in config.h.
+//
+// UNO port layout: D0-D7 = PORTD, D8-D13 = PORTB, A0-A5 (14-19) = PORTC.
+// Off-target builds fall back to digitalWrite()/digitalRead() so a simulator
+// still sees every pin change.
+
+enum FastPort : uint8_t {
+    FAST_PORT_B = 0,
+    FAST_PORT_C,
+    FAST_PORT_D,
+    FAST_PORT_COUNT
+};
+
+constexpr uint8_t fastPinPort(uint8_t pin) {
+    return pin < 8 ? FAST_PORT_D : (pin < 14 ? FAST_PORT_B : FAST_PORT_C);
+}
+constexpr uint8_t fastPinBit(uint8_t pin) {
+    return pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14);
+}
+constexpr uint8_t fastPinMask(uint8_t pin) {
+    return 1 << fastPinBit(pin);
+}
+// I/O address of PINx for a port (DDRx = +1, PORTx = +2)
+constexpr uint8_t fastPortInputReg(uint8_t port) {
+    return 0x03 + 3 * port;
+}
+
+// A pin resolved to port + bit mask, for code that picks the pin at run time
+// (per-slot loops). Build tables of them with makePinTable().
+struct PinRef {
+    uint8_t pin;
+    uint8_t port;
+    uint8_t mask;
+};
+
+constexpr PinRef pinRef(uint8_t pin) {
+    return PinRef{pin, fastPinPort(pin), fastPinMask(pin)};
+}
+
+// Compile-time table of PinRefs from a constexpr pin array in config.h
+template <size_t N>
+struct PinTable {
+    PinRef refs[N];
+    constexpr const PinRef& operator[](size_t i) const { return refs[i]; }
+};
+
+template <size_t... I> struct PinIndexSeq {};
+template <size_t N, size_t... I> struct MakePinIndexSeq : MakePinIndexSeq<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakePinIndexSeq<0, I...> { typedef PinIndexSeq<I...> type; };
+
+template <size_t N, size_t... I>
+constexpr PinTable<N> makePinTable(const uint8_t (&pins)[N], PinIndexSeq<I...>) {
+    return PinTable<N>{{pinRef(pins[I])...}};
+}
+template <size_t N>
+constexpr PinTable<N> makePinTable(const uint8_t (&pins)[N]) {
+    return makePinTable(pins, typename MakePinIndexSeq<N>::type());
+}
+
+// Bits of port used by the pins in a constexpr pin array
+template <size_t N>
+constexpr uint8_t pinPortMask(const uint8_t (&pins)[N], uint8_t port, size_t i = 0) {
+    return i >= N ? 0 : ((fastPinPort(pins[i]) == port ? fastPinMask(pins[i]) : 0) |
+                         pinPortMask(pins, port, i + 1));
+}
+
+// The UNO's TWI pins (SDA = A4, SCL = A5) belong to the I2C hardware once
+// I2cBus::setup() has run; writing their PORTC bits would drop the bus pull-ups
+constexpr bool fastPinIsTwi(uint8_t pin) {
+    return pin == A4 || pin == A5;
+}
+constexpr uint8_t twiPortMask(uint8_t port) {
+    return port == FAST_PORT_C ? fastPinMask(A4) | fastPinMask(A5) : 0;
+}
+
+// --- Run-time pin (resolved PinRef) ---
+
+inline void fastWrite(const PinRef& p, uint8_t level) {
+#if defined(__AVR__)
+    volatile uint8_t& port = _SFR_IO8(fastPortInputReg(p.port) + 2);
+    uint8_t sreg = SREG; // Read-modify-write: the Servo interrupt also writes PORTB
+    cli();
+    if (level) {
+        port |= p.mask;
+    } else {
+        port &= ~p.mask;
+    }
+    SREG = sreg;
+#else
+    digitalWrite(p.pin, level);
+#endif
+}
+
+inline uint8_t fastRead(const PinRef& p) {
+#if defined(__AVR__)
+    return (_SFR_IO8(fastPortInputReg(p.port)) & p.mask) ? HIGH : LOW;
+#else
+    return digitalRead(p.pin);
+#endif
+}
+
+// Drives p high for exactly US microseconds, interrupts off (HC-SR04 trigger).
+// The pulse width is counted in CPU cycles instead of delayMicroseconds().
+template <uint8_t US>
+inline void fastPulse(const PinRef& p) {
+#if defined(__AVR__)
+    volatile uint8_t& port = _SFR_IO8(fastPortInputReg(p.port) + 2);
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t low = port & ~p.mask;
+    uint8_t high = low | p.mask;
+    port = high;
+    __builtin_avr_delay_cycles((F_CPU / 1000000UL) * US - 1); // -1: the store that ends the pulse
+    port = low;
+    SREG = sreg;
+#else
+    digitalWrite(p.pin, HIGH);
+    delayMicroseconds(US);
+    digitalWrite(p.pin, LOW);
+#endif
+}
+
+// Sets the bits in mask of one port to the matching bits of value with a
+// single port write (e.g. every slot LED on that port at once)
+inline void fastPortWrite(uint8_t port, uint8_t mask, uint8_t value) {
+    if (!mask) return;
+#if defined(__AVR__)
+    volatile uint8_t& reg = _SFR_IO8(fastPortInputReg(port) + 2);
+    uint8_t sreg = SREG;
+    cli();
+    reg = (reg & ~mask) | (value & mask);
+    SREG = sreg;
+#else
+    uint8_t firstPin = port == FAST_PORT_D ? 0 : (port == FAST_PORT_B ? 8 : 14);
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (mask & (1 << bit)) digitalWrite(firstPin + bit, (value >> bit) & 1);
+    }
+#endif
+}
+
+// --- Compile-time pin ---
+// Constant port address and bit: high()/low() compile to a single sbi/cbi,
+// which is atomic, so no interrupt locking is needed.
+template <uint8_t PIN>
+struct FastPin {
+    static_assert(PIN < 20, "FastPin: not an UNO pin");
+
+    static void output() { pinMode(PIN, OUTPUT); }
+    static void input() { pinMode(PIN, INPUT); }
+    static void inputPullup() { pinMode(PIN, INPUT_PULLUP); }
+
+#if defined(__AVR__)
+    static void high() { _SFR_IO8(fastPortInputReg(fastPinPort(PIN)) + 2) |= fastPinMask(PIN); }
+    static void low() { _SFR_IO8(fastPortInputReg(fastPinPort(PIN)) + 2) &= ~fastPinMask(PIN); }
+    // Writing a 1 to PINx toggles the output bit
+    static void toggle() { _SFR_IO8(fastPortInputReg(fastPinPort(PIN))) = fastPinMask(PIN); }
+    static uint8_t read() {
+        return (_SFR_IO8(fastPortInputReg(fastPinPort(PIN))) & fastPinMask(PIN)) ? HIGH : LOW;
+    }
+#else
+    static void high() { digitalWrite(PIN, HIGH); }
+    static void low() { digitalWrite(PIN, LOW); }
+    static void toggle() { digitalWrite(PIN, digitalRead(PIN) ? LOW : HIGH); }
+    static uint8_t read() { return digitalRead(PIN); }
+#endif
+    static void write(uint8_t level) {
+        if (level) {
+            high();
+        } else {
+            low();
+        }
+    }
+};
+
+#endif // FAST_PIN_H
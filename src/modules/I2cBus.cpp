@@ -0,0 +1,203 @@
+#include "I2cBus.h"
+
+I2cBus::Transaction I2cBus::_queue[I2C_QUEUE_DEPTH];
+volatile uint8_t I2cBus::_head = 0;
+volatile uint8_t I2cBus::_active = 0;
+volatile uint8_t I2cBus::_tail = 0;
+volatile uint8_t I2cBus::_count = 0;
+volatile bool I2cBus::_busy = false;
+volatile uint8_t I2cBus::_index = 0;
+unsigned long I2cBus::_completed = 0;
+unsigned long I2cBus::_errors = 0;
+uint8_t I2cBus::_maxQueued = 0;
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+static volatile bool s_reading = false; // Current phase of the active transaction
+
+// TWCR values
+static const uint8_t TWCR_CONTINUE = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+static const uint8_t TWCR_ACK = TWCR_CONTINUE | _BV(TWEA);
+static const uint8_t TWCR_START = TWCR_CONTINUE | _BV(TWSTA);
+static const uint8_t TWCR_STOP = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+
+ISR(TWI_vect) { I2cBus::handleInterrupt(); }
+#else
+I2cHostHandler I2cBus::_hostHandler = nullptr;
+#endif
+
+void I2cBus::setup() {
+#if defined(__AVR__)
+    // Internal pull-ups (external 4.7k resistors are still recommended)
+    digitalWrite(SDA, HIGH);
+    digitalWrite(SCL, HIGH);
+    TWSR = 0; // Prescaler 1
+    TWBR = ((F_CPU / I2C_CLOCK_HZ) - 16) / 2;
+    TWCR = _BV(TWEN);
+#endif
+    // Serial.println("I2cBus setup complete.");
+}
+
+bool I2cBus::submit(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                    uint8_t* rx, uint8_t rxLength, I2cCallback callback, void* context) {
+    if (_count >= I2C_QUEUE_DEPTH) return false; // Queue full: caller retries later
+
+    Transaction& t = _queue[_tail];
+    t.address = address;
+    t.tx = tx;
+    t.txLength = tx ? txLength : 0;
+    t.rx = rx;
+    t.rxLength = rx ? rxLength : 0;
+    t.callback = callback;
+    t.context = context;
+    t.status = I2C_PENDING;
+
+    noInterrupts();
+    _tail = (_tail + 1) % I2C_QUEUE_DEPTH;
+    _count++;
+    if (_count > _maxQueued) _maxQueued = _count;
+    bool start = !_busy;
+    interrupts();
+
+    if (start) startNext(false);
+    return true;
+}
+
+void I2cBus::poll() {
+    // Deliver completions in submission order
+    while (_count > 0 && _queue[_head].status != I2C_PENDING) {
+        Transaction& t = _queue[_head];
+        I2cStatus status = t.status;
+        I2cCallback callback = t.callback;
+        void* context = t.context;
+
+        noInterrupts();
+        _head = (_head + 1) % I2C_QUEUE_DEPTH;
+        _count--;
+        interrupts();
+
+        if (status == I2C_OK) {
+            _completed++;
+        } else {
+            _errors++;
+        }
+        if (callback) callback(context, status); // May submit new transactions
+    }
+}
+
+bool I2cBus::isIdle() {
+    return _count == 0;
+}
+
+void I2cBus::waitIdle() {
+    while (!isIdle()) {
+        poll();
+    }
+}
+
+// Mark the active transaction done and move on to the next queued one
+void I2cBus::finish(I2cStatus status) {
+    _queue[_active].status = status;
+    _active = (_active + 1) % I2C_QUEUE_DEPTH;
+}
+
+#if defined(__AVR__)
+
+// Starts the transaction at _active if there is one. afterStop: the previous
+// transaction still needs its STOP condition (STOP + START in one TWCR write).
+void I2cBus::startNext(bool afterStop) {
+    if (_active == _tail) {
+        _busy = false;
+        if (afterStop) TWCR = TWCR_STOP;
+        return;
+    }
+    _busy = true;
+    _index = 0;
+    TWCR = afterStop ? (TWCR_START | _BV(TWSTO)) : TWCR_START;
+}
+
+void I2cBus::handleInterrupt() {
+    Transaction& t = _queue[_active];
+
+    switch (TW_STATUS) {
+        case TW_START:
+            s_reading = (t.txLength == 0);
+            TWDR = (t.address << 1) | (s_reading ? TW_READ : TW_WRITE);
+            TWCR = TWCR_CONTINUE;
+            break;
+        case TW_REP_START:
+            s_reading = true;
+            TWDR = (t.address << 1) | TW_READ;
+            TWCR = TWCR_CONTINUE;
+            break;
+
+        // --- Write phase ---
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (_index < t.txLength) {
+                TWDR = t.tx[_index++];
+                TWCR = TWCR_CONTINUE;
+            } else if (t.rxLength > 0) {
+                _index = 0;
+                TWCR = TWCR_START; // Repeated START for the read phase
+            } else {
+                finish(I2C_OK);
+                startNext(true);
+            }
+            break;
+
+        // --- Read phase ---
+        case TW_MR_SLA_ACK:
+            TWCR = (t.rxLength > 1) ? TWCR_ACK : TWCR_CONTINUE; // NACK the last byte
+            break;
+        case TW_MR_DATA_ACK:
+            t.rx[_index++] = TWDR;
+            TWCR = (_index < t.rxLength - 1) ? TWCR_ACK : TWCR_CONTINUE;
+            break;
+        case TW_MR_DATA_NACK:
+            t.rx[_index++] = TWDR;
+            finish(I2C_OK);
+            startNext(true);
+            break;
+
+        // --- Errors ---
+        case TW_MT_SLA_NACK:
+        case TW_MR_SLA_NACK:
+            finish(I2C_NACK_ADDRESS);
+            startNext(true);
+            break;
+        case TW_MT_DATA_NACK:
+            finish(I2C_NACK_DATA);
+            startNext(true);
+            break;
+        case TW_MT_ARB_LOST: // Also TW_MR_ARB_LOST: bus released, START again when free
+            finish(I2C_BUS_ERROR);
+            startNext(false);
+            if (!_busy) TWCR = _BV(TWINT) | _BV(TWEN);
+            break;
+        default: // TW_BUS_ERROR or unexpected state: reset the interface
+            finish(I2C_BUS_ERROR);
+            TWCR = TWCR_STOP;
+            startNext(false);
+            break;
+    }
+}
+
+#else // Host build: transactions complete immediately through the host handler
+
+void I2cBus::startNext(bool) {
+    while (_active != _tail) {
+        Transaction& t = _queue[_active];
+        I2cStatus status = _hostHandler
+            ? _hostHandler(t.address, t.tx, t.txLength, t.rx, t.rxLength)
+            : I2C_NACK_ADDRESS;
+        finish(status);
+    }
+    _busy = false;
+}
+
+void I2cBus::handleInterrupt() {}
+
+#endif
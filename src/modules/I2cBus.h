@@ -0,0 +1,95 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Completion status of a transaction
+enum I2cStatus : uint8_t {
+    I2C_OK = 0,
+    I2C_NACK_ADDRESS,  // No device answered
+    I2C_NACK_DATA,     // Device refused a data byte
+    I2C_BUS_ERROR,     // Arbitration lost / illegal bus state
+    I2C_PENDING = 0xFF // Still queued or on the wire
+};
+
+// Called from I2cBus::poll() (loop context, never from the interrupt)
+typedef void (*I2cCallback)(void* context, I2cStatus status);
+
+#if !defined(__AVR__)
+// Off-target builds: whoever simulates the bus answers transactions here.
+// Returns the status; rx must be filled with rxLength bytes on success.
+typedef I2cStatus (*I2cHostHandler)(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                                    uint8_t* rx, uint8_t rxLength);
+#endif
+
+// Interrupt-driven TWI master with a bounded queue of pending transactions.
+// A transaction is an optional write phase followed by an optional read phase
+// (joined by a repeated START, e.g. "write register index, read value").
+// Buffers belong to the caller and must stay valid until the callback runs.
+// The next queued transaction is started from the interrupt, so the bus keeps
+// running while loop() does other work.
+class I2cBus {
+public:
+    static void setup();
+
+    // Queue a transaction; false if the queue is full
+    static bool submit(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                       uint8_t* rx, uint8_t rxLength,
+                       I2cCallback callback = nullptr, void* context = nullptr);
+    static bool write(uint8_t address, const uint8_t* data, uint8_t length,
+                      I2cCallback callback = nullptr, void* context = nullptr) {
+        return submit(address, data, length, nullptr, 0, callback, context);
+    }
+
+    // Call from loop(): runs completion callbacks in queue order
+    static void poll();
+
+    static bool isIdle();
+    // Blocks until the queue is empty (setup-time use only)
+    static void waitIdle();
+
+    // Counters
+    static unsigned long completed() { return _completed; }
+    static unsigned long errors() { return _errors; }
+    static uint8_t maxQueued() { return _maxQueued; }
+
+#if !defined(__AVR__)
+    static void setHostHandler(I2cHostHandler handler) { _hostHandler = handler; }
+#endif
+
+    // Interrupt service (TWI_vect)
+    static void handleInterrupt();
+
+private:
+    struct Transaction {
+        const uint8_t* tx;
+        uint8_t* rx;
+        I2cCallback callback;
+        void* context;
+        uint8_t address;
+        uint8_t txLength;
+        uint8_t rxLength;
+        volatile I2cStatus status;
+    };
+
+    static Transaction _queue[I2C_QUEUE_DEPTH];
+    static volatile uint8_t _head;   // Oldest transaction (next callback)
+    static volatile uint8_t _active; // Transaction on the wire
+    static volatile uint8_t _tail;   // Next free entry
+    static volatile uint8_t _count;  // Entries in the queue (incl. finished ones awaiting poll)
+    static volatile bool _busy;      // Hardware is running a transaction
+    static volatile uint8_t _index;  // Byte index within the current phase
+    static unsigned long _completed;
+    static unsigned long _errors;
+    static uint8_t _maxQueued;
+
+    static void startNext(bool afterStop);
+    static void finish(I2cStatus status);
+
+#if !defined(__AVR__)
+    static I2cHostHandler _hostHandler;
+#endif
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,131 @@
+#include "IrSensors.h"
+#include "PinChangeIrq.h"
+#include "FastPin.h"
+#include "TraceRecorder.h"
+
+IrSensors::RawEdge IrSensors::_ring[IR_EDGE_RING_SIZE];
+volatile uint8_t IrSensors::_ringHead = 0;
+volatile uint8_t IrSensors::_ringTail = 0;
+volatile unsigned long IrSensors::_overflows = 0;
+volatile uint8_t IrSensors::_maxDepth = 0;
+volatile bool IrSensors::_overflowed = false;
+
+static constexpr uint8_t IR_PINS[IR_CHANNEL_COUNT] = {PIN_IR_ENTRY, PIN_IR_EXIT};
+static constexpr PinTable<IR_CHANNEL_COUNT> IR_PIN_REFS = makePinTable(IR_PINS);
+static const unsigned long IR_DEBOUNCE_US = IR_DEBOUNCE_DELAY_MS * 1000UL;
+
+void IrSensors::setup() {
+    for (uint8_t i = 0; i < IR_CHANNEL_COUNT; ++i) {
+        pinMode(IR_PINS[i], INPUT_PULLUP); // Use internal pull-up if needed
+        _channels[i].stableLevel = digitalRead(IR_PINS[i]);
+        PinChangeIrq::attach(IR_PINS[i], onEdge);
+    }
+    // Serial.println("IrSensors setup complete.");
+}
+
+// Interrupt context: record the edge and get out
+void IrSensors::onEdge(uint8_t pin, uint8_t level, uint32_t timestampUs) {
+    uint8_t head = _ringHead;
+    uint8_t depth = head - _ringTail;
+    if (depth >= IR_EDGE_RING_SIZE) {
+        _overflows++;
+        _overflowed = true;
+        return;
+    }
+    RawEdge& e = _ring[head & (IR_EDGE_RING_SIZE - 1)];
+    e.timestampUs = timestampUs;
+    e.channel = (pin == PIN_IR_ENTRY) ? IR_ENTRY : IR_EXIT;
+    e.level = level;
+    _ringHead = head + 1; // Publish only after the entry is complete
+    if (depth + 1 > _maxDepth) _maxDepth = depth + 1;
+}
+
+void IrSensors::update() {
+    // Entries between tail and head are never touched by the interrupt
+    uint8_t tail = _ringTail;
+    while (tail != _ringHead) {
+        const RawEdge& e = _ring[tail & (IR_EDGE_RING_SIZE - 1)];
+        processEdge(e.channel, e.level, e.timestampUs);
+        _ringTail = ++tail; // Hand the entry back to the interrupt
+    }
+
+    if (_overflowed) {
+        // Edges were lost: carry on from the levels the pins have now
+        _overflowed = false;
+        uint32_t now = micros();
+        for (uint8_t i = 0; i < IR_CHANNEL_COUNT; ++i) {
+            const Channel& c = _channels[i];
+            uint8_t expected = c.hasPending ? c.pendingLevel : c.stableLevel;
+            uint8_t reading = fastRead(IR_PIN_REFS[i]);
+            if (reading != expected) processEdge(i, reading, now);
+        }
+    }
+
+    // A level that has been stable long enough is accepted without waiting for another edge
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < IR_CHANNEL_COUNT; ++i) {
+        if (_channels[i].hasPending && now - _channels[i].pendingUs >= IR_DEBOUNCE_US) {
+            acceptPending(i);
+        }
+    }
+}
+
+void IrSensors::processEdge(uint8_t channel, uint8_t level, uint32_t timestampUs) {
+    Channel& c = _channels[channel];
+    // The previous level lasted until this edge: accept it if that was long enough
+    if (c.hasPending && timestampUs - c.pendingUs >= IR_DEBOUNCE_US) {
+        acceptPending(channel);
+    }
+
+    if (level == c.stableLevel) {
+        if (c.hasPending) {
+            c.hasPending = false; // Back before the debounce time: a glitch
+            _glitches++;
+        }
+    } else if (!c.hasPending) {
+        c.pendingLevel = level;
+        c.pendingUs = timestampUs;
+        c.hasPending = true;
+    }
+}
+
+void IrSensors::acceptPending(uint8_t channel) {
+    Channel& c = _channels[channel];
+    c.stableLevel = c.pendingLevel;
+    c.hasPending = false;
+
+    if (c.eventCount == IR_EVENT_QUEUE_DEPTH) {
+        // Nobody consumed this channel for a while: keep the newest transitions
+        c.eventHead = (c.eventHead + 1) % IR_EVENT_QUEUE_DEPTH;
+        c.eventCount--;
+        _eventDrops++;
+    }
+    IrEvent& event = c.events[(c.eventHead + c.eventCount) % IR_EVENT_QUEUE_DEPTH];
+    event.edge = (c.stableLevel == HIGH) ? IR_TRIGGERED : IR_PASSED;
+    event.timestampUs = c.pendingUs;
+    c.eventCount++;
+    TRACE_IR(channel, event.edge, event.timestampUs);
+    // Serial.print("IR "); Serial.print(channel); Serial.print(": "); Serial.println(event.edge);
+}
+
+bool IrSensors::peek(IrChannel channel, IrEvent& event) const {
+    const Channel& c = _channels[channel];
+    if (c.eventCount == 0) return false;
+    event = c.events[c.eventHead];
+    return true;
+}
+
+void IrSensors::pop(IrChannel channel) {
+    Channel& c = _channels[channel];
+    if (c.eventCount == 0) return;
+    c.eventHead = (c.eventHead + 1) % IR_EVENT_QUEUE_DEPTH;
+    c.eventCount--;
+}
+
+// Written by the interrupt: copy it with interrupts off so the bytes belong together
+unsigned long IrSensors::overflows() {
+    noInterrupts();
+    unsigned long overflows = _overflows;
+    interrupts();
+    return overflows;
+}
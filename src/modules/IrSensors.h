@@ -0,0 +1,86 @@
+#ifndef IR_SENSORS_H
+#define IR_SENSORS_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Break-beam sensors at the gate
+enum IrChannel : uint8_t {
+    IR_ENTRY = 0,
+    IR_EXIT,
+    IR_CHANNEL_COUNT
+};
+
+// Debounced beam transitions
+enum IrEdge : uint8_t {
+    IR_TRIGGERED, // LOW -> HIGH (beam unblocked / vehicle arrived at sensor)
+    IR_PASSED     // HIGH -> LOW (beam blocked / vehicle passed sensor)
+};
+
+struct IrEvent {
+    IrEdge edge;
+    uint32_t timestampUs; // micros() of the edge that started the stable level
+};
+
+// Interrupt-driven IR beam capture. The pin-change interrupt pushes every raw
+// edge (channel, level, micros()) into a single-producer/single-consumer ring;
+// update() drains it from loop(), debounces on the edge timestamps (a level
+// counts once it has been stable for IR_DEBOUNCE_DELAY_MS) and queues the
+// transitions per channel in the order they happened. Nothing is lost while
+// loop() is busy, as long as the ring does not overflow (see overflows()).
+class IrSensors {
+public:
+    void setup();
+    // Call from loop(): drain the edge ring, debounce, queue events
+    void update();
+
+    // Oldest undelivered event of a channel; false if there is none
+    bool peek(IrChannel channel, IrEvent& event) const;
+    void pop(IrChannel channel);
+
+    // Debounced beam level (HIGH/LOW)
+    uint8_t level(IrChannel channel) const { return _channels[channel].stableLevel; }
+
+    // Counters
+    static unsigned long overflows();                       // Raw edges lost (ring full)
+    static uint8_t maxDepth() { return _maxDepth; }         // Ring high-water mark
+    unsigned long glitches() const { return _glitches; }    // Pulses shorter than the debounce time
+    unsigned long eventDrops() const { return _eventDrops; } // Events lost (channel queue full)
+
+private:
+    struct RawEdge {
+        uint32_t timestampUs;
+        uint8_t channel;
+        uint8_t level;
+    };
+
+    struct Channel {
+        IrEvent events[IR_EVENT_QUEUE_DEPTH];
+        uint8_t eventHead = 0;
+        uint8_t eventCount = 0;
+        uint8_t stableLevel = HIGH;
+        uint8_t pendingLevel = HIGH;
+        bool hasPending = false;
+        uint32_t pendingUs = 0;
+    };
+
+    // ISR -> loop ring: the interrupt only writes _ringHead, loop() only _ringTail
+    static RawEdge _ring[IR_EDGE_RING_SIZE];
+    static volatile uint8_t _ringHead;
+    static volatile uint8_t _ringTail;
+    static volatile unsigned long _overflows;
+    static volatile uint8_t _maxDepth;
+    static volatile bool _overflowed; // Resync with the pins on the next update()
+
+    Channel _channels[IR_CHANNEL_COUNT];
+    unsigned long _glitches = 0;
+    unsigned long _eventDrops = 0;
+
+    static void onEdge(uint8_t pin, uint8_t level, uint32_t timestampUs);
+    void processEdge(uint8_t channel, uint8_t level, uint32_t timestampUs);
+    void acceptPending(uint8_t channel);
+};
+
+static_assert((IR_EDGE_RING_SIZE & (IR_EDGE_RING_SIZE - 1)) == 0, "IR_EDGE_RING_SIZE must be a power of two");
+
+#endif // IR_SENSORS_H
@@ -0,0 +1,37 @@
+#include "OccupancyFilter.h"
+
+void OccupancyFilter::reset() {
+    _valid = 0;
+    _near = 0;
+    _below = 0;
+    _far = 0;
+    _flags = FLAG_OCCUPIED;
+}
+
+void OccupancyFilter::push(uint16_t echoUs) {
+    // Shift the window (the oldest sample falls out) and classify the new one
+    bool valid = echoUs != 0;
+    _valid = (_valid << 1) | valid;
+    _near = (_near << 1) | (valid && echoUs < ENTER_OCCUPIED_US);
+    _below = (_below << 1) | (valid && echoUs < FIRST_DECISION_US);
+    _far = (_far << 1) | (valid && echoUs > LEAVE_OCCUPIED_US);
+    if (sampleCount() < SLOT_FILTER_SIZE) _flags += 1 << COUNT_SHIFT;
+
+    // Not enough valid samples: keep the previous decision
+    uint8_t valids = validCount();
+    if (valids < SLOT_FILTER_MIN_VALID) return;
+
+    // The median is the (valids / 2)-th smallest valid sample, so it is below a
+    // threshold if at least valids / 2 + 1 samples are, and above one if at
+    // least valids - valids / 2 samples are
+    uint8_t belowNeeded = valids / 2 + 1;
+    uint8_t aboveNeeded = valids - valids / 2;
+    if (!hasDecision()) {
+        bool occupied = __builtin_popcount(_below & WINDOW) >= belowNeeded;
+        _flags = (_flags & ~FLAG_OCCUPIED) | FLAG_DECIDED | (occupied ? FLAG_OCCUPIED : 0);
+    } else if (isOccupied() && __builtin_popcount(_far & WINDOW) >= aboveNeeded) {
+        _flags &= ~FLAG_OCCUPIED;
+    } else if (!isOccupied() && __builtin_popcount(_near & WINDOW) >= belowNeeded) {
+        _flags |= FLAG_OCCUPIED;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef OCCUPANCY_FILTER_H
+#define OCCUPANCY_FILTER_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Streaming per-slot occupancy estimator.
+// The decision is the running median of the last SLOT_FILTER_SIZE echo widths
+// with enter/leave hysteresis around the threshold. The median is only ever
+// compared with fixed thresholds, and "median < X" is the same as "more than
+// half of the valid samples are < X", so instead of the samples the filter
+// keeps one bit per sample and threshold (bit 0 = newest sample).
+// That is 5 bytes per slot, and a new sample costs a few shifts.
+class OccupancyFilter {
+public:
+    // Adds one measurement (echo pulse width in us, 0 = no echo / timeout)
+    void push(uint16_t echoUs);
+    void reset();
+
+    bool isOccupied() const { return _flags & FLAG_OCCUPIED; }
+    // True once enough valid samples were seen to make a decision
+    bool hasDecision() const { return _flags & FLAG_DECIDED; }
+    // Confidence: number of valid samples in the window (0..SLOT_FILTER_SIZE)
+    uint8_t validCount() const { return __builtin_popcount(_valid & WINDOW); }
+    uint8_t sampleCount() const { return _flags >> COUNT_SHIFT; }
+
+    // Decision thresholds (echo us), derived from config.h at compile time
+    static constexpr uint16_t ENTER_OCCUPIED_US =
+        (uint16_t)((SLOT_OCCUPIED_THRESHOLD_CM - SLOT_HYSTERESIS_CM) * SLOT_ECHO_US_PER_CM);
+    static constexpr uint16_t LEAVE_OCCUPIED_US =
+        (uint16_t)((SLOT_OCCUPIED_THRESHOLD_CM + SLOT_HYSTERESIS_CM) * SLOT_ECHO_US_PER_CM);
+    // First decision (no previous state to hold): plain threshold
+    static constexpr uint16_t FIRST_DECISION_US = (ENTER_OCCUPIED_US + LEAVE_OCCUPIED_US) / 2;
+
+private:
+    static const uint8_t WINDOW = (uint8_t)((1u << SLOT_FILTER_SIZE) - 1);
+    static const uint8_t FLAG_OCCUPIED = 0x01;
+    static const uint8_t FLAG_DECIDED = 0x02;
+    static const uint8_t COUNT_SHIFT = 4; // Samples seen (saturates at SLOT_FILTER_SIZE)
+
+    // One bit per sample in the window
+    uint8_t _valid = 0; // Echo received
+    uint8_t _near = 0;  // Below ENTER_OCCUPIED_US
+    uint8_t _below = 0; // Below FIRST_DECISION_US
+    uint8_t _far = 0;   // Above LEAVE_OCCUPIED_US
+    uint8_t _flags = FLAG_OCCUPIED; // Unknown slots are treated as occupied
+};
+
+static_assert(SLOT_FILTER_SIZE >= 1 && SLOT_FILTER_SIZE <= 8, "SLOT_FILTER_SIZE must be 1..8");
+
+#endif // OCCUPANCY_FILTER_H
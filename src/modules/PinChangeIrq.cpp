@@ -0,0 +1,91 @@
+#include "PinChangeIrq.h"
+
+PinChangeIrq::Entry PinChangeIrq::_entries[PIN_CHANGE_MAX_PINS] = {};
+uint8_t PinChangeIrq::_lastState[3] = {0};
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static volatile uint8_t* const GROUP_INPUT_REG[3] = {&PINB, &PINC, &PIND};
+
+ISR(PCINT0_vect) { PinChangeIrq::dispatch(0, PINB, micros()); }
+ISR(PCINT1_vect) { PinChangeIrq::dispatch(1, PINC, micros()); }
+ISR(PCINT2_vect) { PinChangeIrq::dispatch(2, PIND, micros()); }
+#endif
+
+bool PinChangeIrq::attach(uint8_t pin, PinChangeHandler handler) {
+    if (!handler) return false;
+#if defined(__AVR__)
+    if (!digitalPinToPCICR(pin)) return false; // No pin-change interrupt on this pin
+    uint8_t group = digitalPinToPCICRbit(pin);
+    uint8_t mask = _BV(digitalPinToPCMSKbit(pin));
+#else
+    // Host builds: keep the UNO port layout so groups/masks mean the same thing
+    uint8_t group = pin < 8 ? 2 : (pin < 14 ? 0 : 1);
+    uint8_t mask = 1 << (pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14));
+#endif
+
+    for (uint8_t i = 0; i < PIN_CHANGE_MAX_PINS; ++i) {
+        if (!_entries[i].handler || _entries[i].pin == pin) {
+            noInterrupts();
+            _entries[i].pin = pin;
+            _entries[i].group = group;
+            _entries[i].mask = mask;
+            _entries[i].handler = handler;
+#if defined(__AVR__)
+            _lastState[group] = *GROUP_INPUT_REG[group];
+            *digitalPinToPCMSK(pin) |= mask;
+            *digitalPinToPCICR(pin) |= _BV(group);
+#else
+            // Start from the pin's current level so the first change is seen
+            if (digitalRead(pin)) {
+                _lastState[group] |= mask;
+            } else {
+                _lastState[group] &= ~mask;
+            }
+#endif
+            interrupts();
+            return true;
+        }
+    }
+    return false; // Table full - increase PIN_CHANGE_MAX_PINS in config.h
+}
+
+void PinChangeIrq::detach(uint8_t pin) {
+    for (uint8_t i = 0; i < PIN_CHANGE_MAX_PINS; ++i) {
+        if (_entries[i].handler && _entries[i].pin == pin) {
+            noInterrupts();
+#if defined(__AVR__)
+            *digitalPinToPCMSK(pin) &= ~_entries[i].mask;
+#endif
+            _entries[i].handler = nullptr;
+            interrupts();
+        }
+    }
+}
+
+void PinChangeIrq::dispatch(uint8_t group, uint8_t portState, uint32_t timestampUs) {
+    uint8_t changed = portState ^ _lastState[group];
+    _lastState[group] = portState;
+    if (!changed) return;
+
+    for (uint8_t i = 0; i < PIN_CHANGE_MAX_PINS; ++i) {
+        const Entry& e = _entries[i];
+        if (e.handler && e.group == group && (changed & e.mask)) {
+            e.handler(e.pin, (portState & e.mask) ? HIGH : LOW, timestampUs);
+        }
+    }
+}
+
+#if !defined(__AVR__)
+void PinChangeIrq::pinChanged(uint8_t pin, uint8_t level, uint32_t timestampUs) {
+    for (uint8_t i = 0; i < PIN_CHANGE_MAX_PINS; ++i) {
+        const Entry& e = _entries[i];
+        if (e.handler && e.pin == pin) {
+            uint8_t state = level ? (_lastState[e.group] | e.mask) : (_lastState[e.group] & ~e.mask);
+            dispatch(e.group, state, timestampUs);
+            return;
+        }
+    }
+}
+#endif
@@ -0,0 +1,40 @@
+#ifndef PIN_CHANGE_IRQ_H
+#define PIN_CHANGE_IRQ_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Called from interrupt context for every level change on an attached pin.
+// timestampUs is micros() taken at the start of the interrupt.
+typedef void (*PinChangeHandler)(uint8_t pin, uint8_t level, uint32_t timestampUs);
+
+// Owns the AVR pin-change interrupt vectors (PCINT0..2) and routes edges to
+// per-pin handlers, so several modules can share the same port vector.
+class PinChangeIrq {
+public:
+    // Enable the pin-change interrupt for pin and route its edges to handler.
+    // Returns false if the pin has no PCINT or the table is full.
+    static bool attach(uint8_t pin, PinChangeHandler handler);
+    static void detach(uint8_t pin);
+
+    // Shared dispatcher for one PCINT group (called by the ISRs)
+    static void dispatch(uint8_t group, uint8_t portState, uint32_t timestampUs);
+
+#if !defined(__AVR__)
+    // Off-target builds have no PCINT hardware: whoever drives the pins
+    // reports level changes here instead.
+    static void pinChanged(uint8_t pin, uint8_t level, uint32_t timestampUs);
+#endif
+
+private:
+    struct Entry {
+        PinChangeHandler handler;
+        uint8_t pin;
+        uint8_t group; // PCINT group (0 = PCINT0_vect, ...)
+        uint8_t mask;  // Bit within the group's port
+    };
+    static Entry _entries[PIN_CHANGE_MAX_PINS];
+    static uint8_t _lastState[3]; // Last seen port state per group
+};
+
+#endif // PIN_CHANGE_IRQ_H
@@ -1,61 +1,119 @@
 #include "Platform.h"
+#include "Profiler.h"
+#include "TraceRecorder.h"
+
+// Profile limits in centi-degrees
+static const long MAX_SPEED_CDEG_S = (long)PLATFORM_MAX_SPEED_DEG_S * 100;
+static const long ACCEL_CDEG_S2 = (long)PLATFORM_ACCEL_DEG_S2 * 100;
 
 void Platform::setup() {
     _servo.attach(PIN_PLATFORM_SERVO);
     // Optionally, move to a default starting position, e.g., slot 0 or a neutral angle
-    // rotateToSlot(0); 
-    // Or set a specific angle, e.g., 90 degrees
-    int initialAngle = PLATFORM_SLOT_ANGLES[1]; // Start facing middle slot
-    _servo.write(initialAngle);
-    _currentAngle = initialAngle;
-    _targetAngle = initialAngle;
-    delay(500); // Allow servo to reach initial position
+    // Start facing middle slot. The physical position is unknown at power-up,
+    // so jump there directly and allow time to settle.
+    int initialAngle = platformSlotAngle(NUM_SLOTS / 2);
+    _posCdeg = (long)initialAngle * 100;
+    _targetCdeg = _posCdeg;
+    _velCdegS = 0;
+    _moving = false;
+    writeServo();
+    _settleDeadline.set(PLATFORM_INIT_TIME_MS);
     // Serial.println("Platform setup complete.");
 }
 
 bool Platform::rotateToSlot(uint8_t slot) {
+    PROFILE_SCOPE(PROBE_ROTATE);
     if (slot >= NUM_SLOTS) {
         // Serial.print("Invalid slot index for platform rotation: "); Serial.println(slot);
         return false; // Invalid slot index
     }
-
-    _targetAngle = PLATFORM_SLOT_ANGLES[slot];
-    // Serial.print("Rotating platform to slot "); Serial.print(slot);
-    // Serial.print(" (Angle: "); Serial.print(_targetAngle); Serial.println(")");
-
-    // Simple blocking rotation using write() and delay
-    // For smoother or non-blocking rotation, you'd need to increment angle in loop
-    _servo.write(_targetAngle);
-    _currentAngle = _targetAngle; // Assume it reaches instantly for blocking
-
-    // Add a delay to allow the servo to physically move
-    // This delay might need tuning based on servo speed and load
-    // A more sophisticated approach would check servo.read() until target is met
-    delay(1000); // Adjust delay as needed (e.g., 1 second)
-
+    // Serial.print("Rotating platform to slot "); Serial.println(slot);
+    rotateToAngle(platformSlotAngle(slot));
     return true;
 }
 
-/*
-// Optional: Rotate to a specific angle
 void Platform::rotateToAngle(int angle) {
-    // Add constraints if necessary (e.g., 0-180 degrees)
     angle = constrain(angle, 0, 180);
-    _targetAngle = angle;
-    _servo.write(_targetAngle);
-    _currentAngle = _targetAngle; // Assume instant move
-    delay(1000); // Adjust delay
+    long target = (long)angle * 100;
+    if (target == _targetCdeg && (_moving || target == _posCdeg)) {
+        return; // Already there or already heading there
+    }
+    _targetCdeg = target;
+    TRACE_PLATFORM(angle);
+    if (!_moving && target == _posCdeg) {
+        return; // No move needed: completes immediately
+    }
+    if (!_moving) {
+        _lastTickMs = Clock::ms();
+        _moving = true;
+    }
+    _settleDeadline.clear();
     // Serial.print("Rotating platform to angle: "); Serial.println(angle);
 }
-*/
-
-/*
-// Optional: Non-blocking rotation check
-// Requires updating _currentAngle gradually in main loop or Platform::update()
-// And not using delay() in rotateToSlot/rotateToAngle
-bool Platform::isRotationComplete() {
-    // Read the current servo position (may not be perfectly accurate)
-    // _currentAngle = _servo.read(); 
-    return abs(_currentAngle - _targetAngle) < 2; // Allow small tolerance
+
+bool Platform::isRotationComplete() const {
+    return !_moving && (!_settleDeadline.isArmed() || _settleDeadline.expired());
+}
+
+void Platform::update() {
+    if (!_moving) return;
+
+    uint64_t now = Clock::ms();
+    long dt = (long)(now - _lastTickMs); // ms
+    _lastTickMs = now;
+    if (dt <= 0) return;
+
+    long remaining = _targetCdeg - _posCdeg;
+    long dir = remaining >= 0 ? 1 : -1;
+    long distance = remaining * dir;
+    long speed = _velCdegS * dir; // Speed towards the target (negative = moving away)
+
+    // Decelerate when the stopping distance reaches the remaining distance
+    // (or when moving the wrong way after a re-target), otherwise accelerate
+    long stopping = speed > 0 ? (speed * speed) / (2 * ACCEL_CDEG_S2) : 0;
+    long dv = ACCEL_CDEG_S2 * dt / 1000;
+    if (speed > 0 && stopping >= distance) {
+        speed -= dv;
+        if (speed < dv) speed = dv; // Keep creeping until the target is reached
+    } else {
+        speed += dv;
+        if (speed > MAX_SPEED_CDEG_S) speed = MAX_SPEED_CDEG_S;
+    }
+
+    long step = speed * dt / 1000;
+    if (step >= distance && speed > 0) {
+        // Arrived: snap to the target and let the servo settle
+        _posCdeg = _targetCdeg;
+        _velCdegS = 0;
+        _moving = false;
+        _settleDeadline.set(PLATFORM_SETTLE_MS);
+    } else {
+        _posCdeg += step * dir;
+        _velCdegS = speed * dir;
+    }
+    writeServo();
+}
+
+void Platform::writeServo() {
+    // Microsecond resolution (~0.1 deg) instead of whole degrees
+    long us = PLATFORM_SERVO_MIN_US +
+        _posCdeg * (PLATFORM_SERVO_MAX_US - PLATFORM_SERVO_MIN_US) / 18000;
+    _servo.writeMicroseconds(us);
+}
+
+unsigned long Platform::estimateMoveMs(int fromAngle, int toAngle) {
+    long distance = (long)abs(toAngle - fromAngle) * 100;
+    if (distance == 0) return 0;
+
+    // Distance needed to reach full speed and stop again
+    long rampDistance = MAX_SPEED_CDEG_S * MAX_SPEED_CDEG_S / ACCEL_CDEG_S2;
+    unsigned long profileMs;
+    if (distance >= rampDistance) {
+        // Trapezoid: cruise + one full ramp time (accel and decel halves)
+        profileMs = distance * 1000 / MAX_SPEED_CDEG_S + MAX_SPEED_CDEG_S * 1000 / ACCEL_CDEG_S2;
+    } else {
+        // Triangle: t = 2 * sqrt(d / a)
+        profileMs = (unsigned long)(2000.0 * sqrt((double)distance / ACCEL_CDEG_S2));
+    }
+    return profileMs + PLATFORM_SETTLE_MS;
 }
-*/
@@ -4,23 +4,43 @@
 #include "../config.h"
 #include <Arduino.h>
 #include <Servo.h> // Include the Servo library
+#include "Scheduler.h"
 
+// Platform motion controller. A move is planned as a velocity-limited
+// trapezoidal profile (PLATFORM_ACCEL_DEG_S2 / PLATFORM_MAX_SPEED_DEG_S) and
+// the servo is stepped along it by update(), called every PLATFORM_TICK_MS.
+// Positions are tracked in centi-degrees; nothing here blocks.
 class Platform {
 public:
     void setup();
-    // Rotates the platform servo to the angle defined for the target slot
-    // Returns true if rotation command was sent, false if slot index is invalid.
+    // Starts rotating the platform servo to the angle defined for the target slot.
+    // Returns immediately: true if rotation command was sent, false if slot index is invalid.
+    // Poll isRotationComplete() to know when the platform has arrived.
     bool rotateToSlot(uint8_t slot);
-    // Optional: Rotate to a specific angle (degrees)
-    // void rotateToAngle(int angle);
+    // Starts rotating to a specific angle (degrees, constrained to 0-180)
+    void rotateToAngle(int angle);
 
-    // Optional: Check if rotation is complete (useful for non-blocking)
-    // bool isRotationComplete(); 
+    // True once the profile has finished and the servo had PLATFORM_SETTLE_MS to
+    // catch up. A move to the current position completes immediately.
+    bool isRotationComplete() const;
+
+    // Periodic task: advance the profile by the time elapsed since the last call
+    void update();
+
+    int targetAngle() const { return _targetCdeg / 100; }
+    // Time a move from fromAngle to toAngle takes (profile + settle), 0 if no move
+    static unsigned long estimateMoveMs(int fromAngle, int toAngle);
 
 private:
     Servo _servo;      // Servo object for platform rotation
-    int _currentAngle = -1; // Keep track of the current angle (optional)
-    int _targetAngle = -1; // Target angle for rotation (optional)
+    long _posCdeg = 0;    // Commanded position along the profile (centi-degrees)
+    long _targetCdeg = 0; // Target position (centi-degrees)
+    long _velCdegS = 0;   // Signed velocity (centi-degrees per second)
+    bool _moving = false;
+    uint64_t _lastTickMs = 0; // Clock::ms()
+    Deadline _settleDeadline; // Armed once the profile ends, servo catching up
+
+    void writeServo();
 };
 
 #endif // PLATFORM_H
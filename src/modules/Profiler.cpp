@@ -0,0 +1,91 @@
+#include "Profiler.h"
+#include "Clock.h"
+
+#if PROFILING_ENABLED
+
+static const char* const PROBE_NAMES[PROBE_COUNT] = {"loop", "allocate", "rotate", "display", "commands"};
+static const uint8_t LINES_PER_PROBE = 3 + PROFILE_STATES; // Summary, 2 histogram halves, states
+
+Profiler::Probe Profiler::_probes[PROBE_COUNT];
+uint8_t Profiler::_state = 0;
+
+// Bit length of us: 0 -> 0, 1 -> 1, 2..3 -> 2, ... capped at the last bucket
+uint8_t Profiler::bucketOf(uint32_t us) {
+    uint8_t bucket = 0;
+    while (us && bucket < BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void Profiler::record(ProfileProbe probe, uint32_t us) {
+    Probe& p = _probes[probe];
+    p.samples++;
+    if (p.sumUs + us < p.sumUs) {
+        // Keep the mean, forget old weight
+        p.sumUs /= 2;
+        p.sumCount /= 2;
+    }
+    p.sumUs += us;
+    p.sumCount++;
+    if (us > p.maxUs) p.maxUs = us;
+
+    uint16_t& bucket = p.buckets[bucketOf(us)];
+    if (bucket == 0xFFFF) {
+        for (uint8_t b = 0; b < BUCKETS; ++b) {
+            p.buckets[b] /= 2; // Same shape, room to count on
+        }
+    }
+    bucket++;
+
+    if (p.stateCount[_state] < 0xFFFF) p.stateCount[_state]++;
+    if (us > p.stateMaxUs[_state]) p.stateMaxUs[_state] = us;
+}
+
+// P<probe> <name> n= mean= max=   summary (us)
+// H<probe>.<first> c c c c c c c c   histogram counts, buckets first..first+7
+// S<probe>.<state> n= max=          per SystemState
+bool Profiler::reportLine(uint8_t index, char* line, uint8_t size) {
+    if (index == 0) {
+        snprintf(line, size, "STATS probes=%u states=%u up=%lus", PROBE_COUNT, PROFILE_STATES, (unsigned long)Clock::seconds());
+        return true;
+    }
+    index--;
+    uint8_t probe = index / LINES_PER_PROBE;
+    uint8_t part = index % LINES_PER_PROBE;
+    if (probe >= PROBE_COUNT) {
+        if (probe == PROBE_COUNT && part == 0) {
+            snprintf(line, size, "END");
+            return true;
+        }
+        return false;
+    }
+
+    const Probe& p = _probes[probe];
+    if (part == 0) {
+        snprintf(line, size, "P%u %s n=%lu mean=%lu max=%lu", probe, PROBE_NAMES[probe],
+                 (unsigned long)p.samples, p.sumCount ? (unsigned long)(p.sumUs / p.sumCount) : 0UL,
+                 (unsigned long)p.maxUs);
+    } else if (part <= 2) {
+        uint8_t first = (part - 1) * (BUCKETS / 2);
+        const uint16_t* b = &p.buckets[first];
+        snprintf(line, size, "H%u.%u %u %u %u %u %u %u %u %u", probe, first,
+                 b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
+    } else {
+        uint8_t state = part - 3;
+        snprintf(line, size, "S%u.%u n=%u max=%lu", probe, state, p.stateCount[state],
+                 (unsigned long)p.stateMaxUs[state]);
+    }
+    return true;
+}
+
+#else
+
+bool Profiler::reportLine(uint8_t index, char* line, uint8_t size) {
+    if (index > 1) return false;
+    snprintf(line, size, index == 0 ? "STATS off (build with PROFILING_ENABLED=1)" : "END");
+    return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Named profiling probes (append only: STATS output numbers them)
+enum ProfileProbe : uint8_t {
+    PROBE_LOOP,     // One loop() pass
+    PROBE_ALLOCATE, // SlotAllocator::allocate() (free slot search)
+    PROBE_ROTATE,   // Platform::rotateToSlot()
+    PROBE_DISPLAY,  // Display::print()
+    PROBE_COMMANDS, // BluetoothCmd::checkCommands(), handlers included
+    PROBE_COUNT
+};
+
+// micros()-based probes for finding worst-case stalls on the board. Each probe
+// keeps a count, mean and max, a log2 histogram (bucket b >= 1 holds
+// durations of 2^(b-1)..2^b - 1 us, the last one everything from 16 ms up) and
+// count/max per SystemState. Wrap a block with PROFILE_SCOPE(probe); the
+// state comes from PROFILE_STATE(state) in the sketch's state change.
+//
+// With PROFILING_ENABLED 0 (default) both macros compile to nothing and the
+// profiler part of the STATS report only says so.
+class Profiler {
+public:
+    // STATS report lines (SerialReport generator)
+    static bool reportLine(uint8_t index, char* line, uint8_t size);
+
+#if PROFILING_ENABLED
+    static void record(ProfileProbe probe, uint32_t us);
+    static void setState(uint8_t state) { _state = state < PROFILE_STATES ? state : 0; }
+
+    static const uint8_t BUCKETS = 16;
+
+private:
+    struct Probe {
+        uint32_t samples;  // Total count
+        uint32_t sumUs;    // sumUs / sumCount = mean (both halved before sumUs overflows)
+        uint32_t sumCount;
+        uint32_t maxUs;
+        uint16_t buckets[BUCKETS]; // Halved together when one saturates
+        uint16_t stateCount[PROFILE_STATES]; // Saturating
+        uint32_t stateMaxUs[PROFILE_STATES];
+    };
+    static Probe _probes[PROBE_COUNT];
+    static uint8_t _state;
+    static uint8_t bucketOf(uint32_t us);
+#endif
+};
+
+#if PROFILING_ENABLED
+// Times the rest of the enclosing block
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileProbe probe) : _probe(probe), _startUs(micros()) {}
+    ~ProfileScope() { Profiler::record(_probe, micros() - _startUs); }
+
+private:
+    ProfileProbe _probe;
+    uint32_t _startUs;
+};
+
+#define PROFILE_SCOPE(probe) ProfileScope profileScope_(probe)
+#define PROFILE_STATE(state) Profiler::setState(state)
+#else
+#define PROFILE_SCOPE(probe) do {} while (0)
+#define PROFILE_STATE(state) do {} while (0)
+#endif
+
+#endif // PROFILER_H
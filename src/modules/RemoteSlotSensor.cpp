@@ -0,0 +1,169 @@
+#include "RemoteSlotSensor.h"
+#include "FastPin.h"
+#include "TraceRecorder.h"
+
+typedef FastPin<PIN_SENSOR_IRQ> ChangeLine; // Low = the board has news
+
+void RemoteSlotSensor::setup() {
+    ChangeLine::inputPullup(); // Open drain on the sensor board side
+    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+        _distanceMm[i] = SENSOR_NO_ECHO;
+    }
+    _headerDue = true;
+    // Serial.println("RemoteSlotSensor setup complete.");
+}
+
+bool RemoteSlotSensor::isSlotFree(uint8_t slot, unsigned long) {
+    if (slot >= NUM_SLOTS) return false;
+    return (freeMask() & slotBit(slot)) != 0;
+}
+
+unsigned long RemoteSlotSensor::slotAgeMs(uint8_t slot) const {
+    if (slot >= NUM_SLOTS || !_contact) return (unsigned long)-1; // Never heard from the board
+    return (unsigned long)(Clock::ms() - _contactMs);
+}
+
+float RemoteSlotSensor::latestDistance(uint8_t slot) const {
+    if (slot >= NUM_SLOTS || _distanceMm[slot] == SENSOR_NO_ECHO) return -1.0;
+    return _distanceMm[slot] / 10.0;
+}
+
+uint8_t RemoteSlotSensor::confidence(uint8_t slot) const {
+    if (slot >= NUM_SLOTS || !isOnline() || (_faultMask & slotBit(slot))) return 0;
+    return SLOT_FILTER_SIZE;
+}
+
+bool RemoteSlotSensor::startScan(SlotMask slotMask) {
+    if (_scanPending) return false;
+    slotMask &= ALL_SLOTS_MASK;
+    if (slotMask == 0) return true;
+    _scanMask = slotMask;
+    _scanPending = true;
+    _scanRequested = false;
+    _scanStartMs = Clock::ms();
+    update(); // Send the request right away if the link is free
+    return true;
+}
+
+void RemoteSlotSensor::update() {
+    uint64_t now = Clock::ms();
+    if (_online && now - _contactMs > SENSOR_BOARD_TIMEOUT_MS) {
+        _online = false; // Board silent: every slot reads occupied until it answers again
+        _headerDue = true;
+    }
+    if (_scanPending && now - _scanStartMs > SENSOR_BOARD_TIMEOUT_MS) {
+        _scanPending = false; // Give up waiting; the mirror stays as it is
+        _scanRequested = false;
+        _linkErrors++;
+    }
+
+    if (_link != LINK_IDLE || _linkBackoff) return;
+    if (_scanPending && !_scanRequested) {
+        _tx[0] = SENSOR_REG_SCAN;
+        for (uint8_t i = 0; i < SENSOR_USED_MASK_BYTES; ++i) {
+            _tx[1 + i] = (uint8_t)((uint64_t)_scanMask >> (8 * i));
+        }
+        submit(LINK_SCAN, 1 + SENSOR_USED_MASK_BYTES, 0);
+    } else if (ChangeLine::read() == LOW) {
+        _tx[0] = SENSOR_REG_STATUS;
+        submit(LINK_HEADER, 1, SENSOR_HEADER_LENGTH);
+    }
+}
+
+// Background task: keeps the distances current and doubles as the heartbeat
+// that notices a silent board (the change line alone would not)
+void RemoteSlotSensor::refreshNext() {
+    _linkBackoff = false;
+    if (_link != LINK_IDLE) return;
+    if (_headerDue || !_online) {
+        _tx[0] = SENSOR_REG_STATUS;
+        submit(LINK_HEADER, 1, SENSOR_HEADER_LENGTH);
+        return;
+    }
+    uint8_t count = NUM_SLOTS - _distanceChunk;
+    if (count > SENSOR_DISTANCE_CHUNK) count = SENSOR_DISTANCE_CHUNK;
+    _tx[0] = SENSOR_REG_DISTANCE + 2 * _distanceChunk;
+    submit(LINK_DISTANCE, 1, 2 * count);
+}
+
+bool RemoteSlotSensor::submit(LinkState state, uint8_t txLength, uint8_t rxLength) {
+    if (!I2cBus::submit(SENSOR_BOARD_ADDR, _tx, txLength, rxLength ? _rx : nullptr, rxLength,
+                        onTransferDone, this)) {
+        return false; // Queue full: try again on the next call
+    }
+    _link = state;
+    return true;
+}
+
+void RemoteSlotSensor::onTransferDone(void* context, I2cStatus status) {
+    static_cast<RemoteSlotSensor*>(context)->finishTransfer(status);
+}
+
+// Runs from I2cBus::poll() (loop context)
+void RemoteSlotSensor::finishTransfer(I2cStatus status) {
+    LinkState state = _link;
+    _link = LINK_IDLE;
+    if (status != I2C_OK) {
+        _linkErrors++;
+        _linkBackoff = true;
+        if (state == LINK_HEADER) _headerDue = true;
+        if (state == LINK_SCAN) _scanPending = false;
+        // Serial.print("Sensor board link error: "); Serial.println(status);
+        return;
+    }
+    _contactMs = Clock::ms();
+    _contact = true;
+
+    switch (state) {
+        case LINK_HEADER:
+            _headerDue = false;
+            _headerReads++;
+            parseHeader();
+            break;
+        case LINK_DISTANCE: {
+            uint8_t count = NUM_SLOTS - _distanceChunk;
+            if (count > SENSOR_DISTANCE_CHUNK) count = SENSOR_DISTANCE_CHUNK;
+            for (uint8_t i = 0; i < count; ++i) {
+                uint16_t mm = _rx[2 * i] | ((uint16_t)_rx[2 * i + 1] << 8);
+                _distanceMm[_distanceChunk + i] = mm;
+                // Traced as the echo time the board measured, like a local reading
+                TRACE_ECHO(_distanceChunk + i, mm == SENSOR_NO_ECHO ? 0 : (uint32_t)(mm * SLOT_ECHO_US_PER_CM / 10));
+            }
+            _distanceChunk += count;
+            if (_distanceChunk >= NUM_SLOTS) _distanceChunk = 0;
+            break;
+        }
+        case LINK_SCAN:
+            _scanRequested = true; // SCAN_DONE arrives with a header read
+            break;
+        default:
+            break;
+    }
+}
+
+void RemoteSlotSensor::parseHeader() {
+    _status = _rx[SENSOR_REG_STATUS];
+    _seq = _rx[SENSOR_REG_SEQ];
+    if (_rx[SENSOR_REG_SLOTS] != NUM_SLOTS) {
+        _online = false; // Built for another slot count: do not trust its masks
+        return;
+    }
+    _freeMask = readMask(&_rx[SENSOR_REG_FREE_MASK]);
+    _faultMask = readMask(&_rx[SENSOR_REG_FAULT_MASK]);
+    _online = true;
+
+    if (_status & SENSOR_STATUS_RESET) _boardResets++;
+    if ((_status & SENSOR_STATUS_SCAN_DONE) && _scanRequested) {
+        _scanPending = false;
+        _scanRequested = false;
+    }
+    // Serial.print("Sensor board seq "); Serial.print(_seq); Serial.print(" free "); Serial.println((unsigned long)_freeMask, BIN);
+}
+
+SlotMask RemoteSlotSensor::readMask(const uint8_t* bytes) {
+    SlotMask mask = 0;
+    for (uint8_t i = 0; i < SENSOR_USED_MASK_BYTES; ++i) {
+        mask |= (SlotMask)((uint64_t)bytes[i] << (8 * i));
+    }
+    return mask & ALL_SLOTS_MASK;
+}
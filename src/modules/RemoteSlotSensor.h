@@ -0,0 +1,94 @@
+#ifndef REMOTE_SLOT_SENSOR_H
+#define REMOTE_SLOT_SENSOR_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "I2cBus.h"
+#include "SensorLink.h"
+#include "SlotMask.h"
+#include "Clock.h"
+
+// SlotSensor backend for the two-board setup (SLOT_SENSOR_REMOTE): the sensor
+// board ranges every slot continuously and this class only mirrors its
+// registers. The header (status, free and fault masks) is read when the
+// board pulls PIN_SENSOR_IRQ low; distances are read one chunk per
+// refreshNext() call. Nothing here blocks: all reads are queued I2cBus
+// transactions, one at a time.
+//
+// Same interface as SlotSensor, so the sketch picks either one at compile time.
+// While the board is offline (no answer, wrong slot count) every slot reads
+// occupied, so nothing gets allocated to a slot nobody can see.
+class RemoteSlotSensor {
+public:
+    void setup();
+    // The board does the ranging: this is the last distance it reported
+    float getSlotDistanceCm(uint8_t slot) { return latestDistance(slot); }
+
+    // --- Occupancy snapshot ---
+    // Always answered from the mirror (the board pushes changes, so there is
+    // nothing to re-measure); maxAgeMs is accepted for interface compatibility
+    bool isSlotFree(uint8_t slot, unsigned long maxAgeMs = SLOT_SNAPSHOT_MAX_AGE_MS);
+    int findFirstFreeSlot() const { return lowestSlot(freeMask()); }
+    SlotMask freeMask() const { return isOnline() ? _freeMask : 0; }
+    // Time since the board last answered (-1 if it never did)
+    unsigned long slotAgeMs(uint8_t slot) const;
+    void refreshNext(); // Background task: read the next chunk of distances
+
+    // --- Scans ---
+    // Asks the board to range slotMask next; complete once it reports
+    // SCAN_DONE (or after SENSOR_BOARD_TIMEOUT_MS). False if one is running.
+    bool startScan(SlotMask slotMask = ALL_SLOTS_MASK);
+    bool isScanComplete() const { return !_scanPending; }
+    float latestDistance(uint8_t slot) const;
+    // SLOT_FILTER_SIZE for a healthy slot, 0 for a faulty one (the board keeps the filters)
+    uint8_t confidence(uint8_t slot) const;
+    // Call from loop(): reads the header when the board signals a change
+    void update();
+
+    bool isOnline() const { return _online; }
+    uint8_t boardStatus() const { return _status; }
+    SlotMask faultMask() const { return _faultMask; }
+
+    // Counters
+    unsigned long headerReads() const { return _headerReads; }
+    unsigned long linkErrors() const { return _linkErrors; }
+    unsigned long boardResets() const { return _boardResets; }
+
+    static constexpr SlotMask ALL_SLOTS_MASK = ::ALL_SLOTS_MASK;
+
+private:
+    enum LinkState : uint8_t { LINK_IDLE, LINK_HEADER, LINK_DISTANCE, LINK_SCAN };
+
+    // Buffers of the transaction in flight (owned until its callback runs)
+    uint8_t _tx[1 + SENSOR_MASK_BYTES];
+    uint8_t _rx[SENSOR_HEADER_LENGTH]; // Also holds a distance chunk
+    LinkState _link = LINK_IDLE;
+    bool _linkBackoff = false; // Last transfer failed: retry from refreshNext() only
+
+    SlotMask _freeMask = 0;
+    SlotMask _faultMask = 0;
+    uint16_t _distanceMm[NUM_SLOTS];
+    uint8_t _status = 0;
+    uint8_t _seq = 0;
+    uint8_t _distanceChunk = 0; // First slot of the next distance read
+    bool _online = false;
+    bool _headerDue = true;     // Read the header on the next refreshNext() even without a change signal
+    bool _scanPending = false;
+    bool _scanRequested = false; // SCAN written, waiting for SCAN_DONE
+    SlotMask _scanMask = 0;
+    uint64_t _scanStartMs = 0;
+    uint64_t _contactMs = 0; // Clock::ms() of the last successful transaction
+    bool _contact = false;
+
+    unsigned long _headerReads = 0;
+    unsigned long _linkErrors = 0;
+    unsigned long _boardResets = 0;
+
+    bool submit(LinkState state, uint8_t txLength, uint8_t rxLength);
+    void finishTransfer(I2cStatus status);
+    void parseHeader();
+    static SlotMask readMask(const uint8_t* bytes);
+    static void onTransferDone(void* context, I2cStatus status);
+};
+
+#endif // REMOTE_SLOT_SENSOR_H
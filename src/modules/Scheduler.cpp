@@ -0,0 +1,84 @@
+#include "Scheduler.h"
+
+int8_t Scheduler::addTask(unsigned long delayMs, unsigned long periodMs, TaskCallback cb) {
+    if (!cb) return INVALID_TASK;
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if (!_tasks[i].callback) {
+            _tasks[i].callback = cb;
+            _tasks[i].dueMs = Clock::ms() + delayMs;
+            _tasks[i].periodMs = periodMs;
+            _tasks[i].reserved = false;
+            return i;
+        }
+    }
+    // Serial.println("Scheduler: task table full!");
+    return INVALID_TASK; // Table full - increase SCHEDULER_MAX_TASKS in config.h
+}
+
+int8_t Scheduler::every(unsigned long periodMs, TaskCallback cb) {
+    return addTask(periodMs, periodMs, cb);
+}
+
+int8_t Scheduler::after(unsigned long delayMs, TaskCallback cb) {
+    return addTask(delayMs, 0, cb);
+}
+
+int8_t Scheduler::reserve(TaskCallback cb) {
+    int8_t taskId = addTask(0, 0, cb);
+    if (taskId != INVALID_TASK) {
+        _tasks[taskId].reserved = true;
+        _tasks[taskId].dueMs = NEVER;
+    }
+    return taskId;
+}
+
+bool Scheduler::rearm(int8_t taskId, unsigned long delayMs) {
+    if (!isScheduled(taskId) || !_tasks[taskId].reserved) return false;
+    _tasks[taskId].dueMs = Clock::ms() + delayMs;
+    return true;
+}
+
+void Scheduler::disarm(int8_t taskId) {
+    if (isScheduled(taskId) && _tasks[taskId].reserved) _tasks[taskId].dueMs = NEVER;
+}
+
+bool Scheduler::cancel(int8_t taskId) {
+    if (!isScheduled(taskId)) return false;
+    _tasks[taskId].callback = nullptr;
+    _tasks[taskId].reserved = false;
+    return true;
+}
+
+bool Scheduler::isScheduled(int8_t taskId) const {
+    return taskId >= 0 && taskId < SCHEDULER_MAX_TASKS && _tasks[taskId].callback != nullptr;
+}
+
+void Scheduler::run() {
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        Task& task = _tasks[i];
+        if (!task.callback) continue;
+
+        uint64_t now = Clock::ms();
+        if (now < task.dueMs) continue; // Not due yet
+
+        unsigned long lateness = (unsigned long)(now - task.dueMs);
+        if (lateness > _maxLatenessMs) {
+            _maxLatenessMs = lateness;
+        }
+
+        TaskCallback cb = task.callback;
+        if (task.reserved) {
+            task.dueMs = NEVER; // Idle until re-armed (the callback may do that)
+        } else if (task.periodMs == 0) {
+            // One-shot: free the slot before running so the callback can re-arm itself
+            task.callback = nullptr;
+        } else {
+            task.dueMs += task.periodMs;
+            // If we fell more than a period behind, skip the missed runs instead of bursting
+            if (task.dueMs <= now) {
+                task.dueMs = now + task.periodMs;
+            }
+        }
+        cb();
+    }
+}
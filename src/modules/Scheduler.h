@@ -0,0 +1,57 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "Clock.h" // Deadline, Interval
+
+// Callback type for scheduled tasks (same style as the BluetoothCmd callbacks)
+typedef void (*TaskCallback)();
+
+// Cooperative scheduler with a fixed-size task table (no heap).
+// Tasks are plain functions that must return quickly; anything that takes
+// time (servo travel, beeps, message hold times) is started by one task and
+// finished by another instead of calling delay().
+class Scheduler {
+public:
+    static const int8_t INVALID_TASK = -1;
+
+    // Run cb every periodMs milliseconds (first run after one period)
+    int8_t every(unsigned long periodMs, TaskCallback cb);
+    // Run cb once, delayMs milliseconds from now
+    int8_t after(unsigned long delayMs, TaskCallback cb);
+    // Hold a table entry for cb, run only when armed with rearm(): a task that
+    // must never find the table full (re-armed one-shots like the annunciator)
+    int8_t reserve(TaskCallback cb);
+    // Run reserved task taskId once, delayMs from now (replaces a pending
+    // run). It keeps its entry afterwards. False if taskId is not reserved.
+    bool rearm(int8_t taskId, unsigned long delayMs);
+    // Reserved task taskId does not run until it is re-armed
+    void disarm(int8_t taskId);
+    // Remove a pending task. Returns false if the id was not scheduled.
+    bool cancel(int8_t taskId);
+    bool isScheduled(int8_t taskId) const;
+
+    // Call from loop(): runs every task whose due time has passed
+    void run();
+
+    // Worst observed lateness (ms) between a task's due time and its execution
+    unsigned long maxLatenessMs() const { return _maxLatenessMs; }
+
+private:
+    struct Task {
+        TaskCallback callback = nullptr;
+        uint64_t dueMs = 0;         // Clock::ms() of the next run
+        unsigned long periodMs = 0; // 0 = one-shot
+        bool reserved = false;      // One-shot that keeps its entry (dueMs = NEVER while idle)
+    };
+
+    static const uint64_t NEVER = ~(uint64_t)0;
+
+    Task _tasks[SCHEDULER_MAX_TASKS];
+    unsigned long _maxLatenessMs = 0;
+
+    int8_t addTask(unsigned long delayMs, unsigned long periodMs, TaskCallback cb);
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,155 @@
+#include "SensorLink.h"
+
+SensorRegisterFile::SensorRegisterFile() {
+    memset(_regs, 0, sizeof(_regs));
+    _regs[SENSOR_REG_STATUS] = SENSOR_STATUS_RESET;
+    _regs[SENSOR_REG_SLOTS] = NUM_SLOTS;
+    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+        _regs[SENSOR_REG_DISTANCE + 2 * i] = SENSOR_NO_ECHO & 0xFF;
+        _regs[SENSOR_REG_DISTANCE + 2 * i + 1] = SENSOR_NO_ECHO >> 8;
+    }
+}
+
+// Ranging loop context: the slave interrupt may read the registers at any
+// time, so each update is done with interrupts off (a few bytes)
+void SensorRegisterFile::setSlot(uint8_t slot, bool free, bool fault, uint16_t distanceMm) {
+    if (slot >= NUM_SLOTS) return;
+    uint8_t byteIndex = slot / 8;
+    uint8_t bit = 1 << (slot % 8);
+    uint8_t& freeByte = _regs[SENSOR_REG_FREE_MASK + byteIndex];
+    uint8_t& faultByte = _regs[SENSOR_REG_FAULT_MASK + byteIndex];
+
+    noInterrupts();
+    bool changed = ((freeByte & bit) != 0) != free || ((faultByte & bit) != 0) != fault;
+    if (free) {
+        freeByte |= bit;
+    } else {
+        freeByte &= ~bit;
+    }
+    if (fault) {
+        faultByte |= bit;
+    } else {
+        faultByte &= ~bit;
+    }
+    _regs[SENSOR_REG_DISTANCE + 2 * slot] = distanceMm & 0xFF;
+    _regs[SENSOR_REG_DISTANCE + 2 * slot + 1] = distanceMm >> 8;
+
+    if (changed) {
+        bool anyFault = false;
+        for (uint8_t i = 0; i < SENSOR_USED_MASK_BYTES; ++i) {
+            if (_regs[SENSOR_REG_FAULT_MASK + i]) anyFault = true;
+        }
+        setStatus(SENSOR_STATUS_FAULT, anyFault);
+        headerChanged();
+    }
+    interrupts();
+}
+
+void SensorRegisterFile::setRanging(bool ranging) {
+    noInterrupts();
+    setStatus(SENSOR_STATUS_RANGING, ranging);
+    interrupts();
+}
+
+void SensorRegisterFile::setScanDone() {
+    noInterrupts();
+    setStatus(SENSOR_STATUS_SCAN_DONE, true);
+    interrupts();
+}
+
+SlotMask SensorRegisterFile::takeScanRequest() {
+    noInterrupts();
+    SlotMask request = _scanRequest;
+    _scanRequest = 0;
+    interrupts();
+    return request;
+}
+
+// Caller holds interrupts off
+void SensorRegisterFile::setStatus(uint8_t flags, bool on) {
+    uint8_t status = _regs[SENSOR_REG_STATUS];
+    uint8_t updated = on ? (status | flags) : (status & ~flags);
+    if (updated == status) return;
+    _regs[SENSOR_REG_STATUS] = updated;
+    _changePending = true;
+}
+
+void SensorRegisterFile::headerChanged() {
+    _regs[SENSOR_REG_SEQ]++;
+    _changePending = true;
+}
+
+// Slave receive: pointer byte, then data for the SCAN register
+void SensorRegisterFile::onWrite(const uint8_t* data, uint8_t length) {
+    if (length == 0) return;
+    _pointer = data[0];
+    if (_pointer == SENSOR_REG_SCAN && length > 1) {
+        SlotMask request = 0;
+        for (uint8_t i = 1; i < length && i <= SENSOR_MASK_BYTES; ++i) {
+            request |= (SlotMask)((uint64_t)data[i] << (8 * (i - 1)));
+        }
+        _scanRequest |= request & ALL_SLOTS_MASK;
+        // Serial.print("Scan request: "); Serial.println((unsigned long)request, HEX);
+    }
+}
+
+// Slave transmit: registers from the pointer on (0xFF past the end).
+// Reading STATUS acknowledges the one-shot flags and releases the change line.
+uint8_t SensorRegisterFile::onRead(uint8_t* out, uint8_t maxLength) {
+    uint8_t start = _pointer;
+    for (uint8_t i = 0; i < maxLength; ++i) {
+        uint16_t reg = start + i;
+        out[i] = reg < REGISTER_COUNT ? _regs[reg] : 0xFF;
+    }
+    if (start == SENSOR_REG_STATUS && maxLength > 0) {
+        _regs[SENSOR_REG_STATUS] &= ~(SENSOR_STATUS_SCAN_DONE | SENSOR_STATUS_RESET);
+        _changePending = false;
+    }
+    _pointer = start + maxLength;
+    return maxLength;
+}
+
+// =================== HOST STAND-IN ===================
+#if !defined(__AVR__)
+
+SensorBoardStandIn* SensorBoardStandIn::_instance = nullptr;
+
+void SensorBoardStandIn::attach() {
+    _instance = this;
+    I2cBus::setHostHandler(transfer);
+    _registers.setRanging(true);
+    updateLine();
+}
+
+void SensorBoardStandIn::setSlot(uint8_t slot, bool free, uint16_t distanceMm, bool fault) {
+    _registers.setSlot(slot, free, fault, distanceMm);
+    updateLine();
+}
+
+void SensorBoardStandIn::finishScan() {
+    if (_scanRequest == 0) return;
+    _scanRequest = 0;
+    _registers.setScanDone();
+    updateLine();
+}
+
+I2cStatus SensorBoardStandIn::transfer(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                                       uint8_t* rx, uint8_t rxLength) {
+    if (address != SENSOR_BOARD_ADDR || _instance == nullptr) return I2C_NACK_ADDRESS;
+    SensorBoardStandIn& board = *_instance;
+    if (txLength > 0) {
+        board._registers.onWrite(tx, txLength);
+        board._scanRequest |= board._registers.takeScanRequest();
+    }
+    if (rxLength > 0) {
+        board._registers.onRead(rx, rxLength);
+    }
+    board.updateLine();
+    return I2C_OK;
+}
+
+void SensorBoardStandIn::updateLine() {
+    digitalWrite(PIN_SENSOR_IRQ, _registers.changePending() ? LOW : HIGH);
+}
+
+#endif
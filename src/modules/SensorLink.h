@@ -0,0 +1,110 @@
+#ifndef SENSOR_LINK_H
+#define SENSOR_LINK_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "SlotMask.h"
+
+// I2C protocol between the main board (master) and the sensor board (slave at
+// SENSOR_BOARD_ADDR). Every transaction starts by writing the register
+// pointer (followed by data for writable registers); reads continue from the
+// pointer. The sensor board pulls PIN_SENSOR_IRQ low whenever the header
+// changed and releases it once the header has been read, so the main board
+// only reads when something happened.
+//
+//   0x00 STATUS      health flags (SENSOR_STATUS_*)
+//   0x01 SEQ         +1 on every occupancy or fault change
+//   0x02 SLOTS       slot count of the sensor board (must match NUM_SLOTS)
+//   0x03 FREE_MASK   8 bytes, bit i = slot i free (little endian)
+//   0x0B FAULT_MASK  8 bytes, bit i = slot i sensor not answering
+//   0x20 DISTANCE    uint16 per slot, mm (little endian, SENSOR_NO_ECHO = none)
+//   0xF0 SCAN        write only: mask bytes of the slots to range next;
+//                    STATUS_SCAN_DONE is raised once they were measured
+enum SensorRegister : uint8_t {
+    SENSOR_REG_STATUS = 0x00,
+    SENSOR_REG_SEQ = 0x01,
+    SENSOR_REG_SLOTS = 0x02,
+    SENSOR_REG_FREE_MASK = 0x03,
+    SENSOR_REG_FAULT_MASK = 0x0B,
+    SENSOR_REG_DISTANCE = 0x20,
+    SENSOR_REG_SCAN = 0xF0
+};
+
+enum SensorStatusFlag : uint8_t {
+    SENSOR_STATUS_RANGING = 0x01,   // Ranging loop is running
+    SENSOR_STATUS_SCAN_DONE = 0x02, // Requested scan finished (cleared when read)
+    SENSOR_STATUS_FAULT = 0x04,     // At least one slot in FAULT_MASK
+    SENSOR_STATUS_RESET = 0x80      // Board restarted (cleared when read)
+};
+
+const uint8_t SENSOR_MASK_BYTES = 8;
+const uint8_t SENSOR_USED_MASK_BYTES = (NUM_SLOTS + 7) / 8;
+const uint8_t SENSOR_HEADER_LENGTH = SENSOR_REG_FAULT_MASK + SENSOR_MASK_BYTES; // STATUS..FAULT_MASK
+const uint8_t SENSOR_DISTANCE_CHUNK = 8; // Slots per distance read (16 bytes, fits the 32-byte Wire buffer)
+const uint16_t SENSOR_NO_ECHO = 0xFFFF;
+
+static_assert(SENSOR_REG_DISTANCE + 2 * NUM_SLOTS <= SENSOR_REG_SCAN, "Distance registers overlap SCAN");
+
+// Register file of the sensor board. The ranging loop publishes into it, the
+// I2C slave callbacks (interrupt context on the board) read and write it.
+class SensorRegisterFile {
+public:
+    SensorRegisterFile();
+
+    // --- Board side ---
+    // Publish one slot; raises the change line if the header changed
+    void setSlot(uint8_t slot, bool free, bool fault, uint16_t distanceMm);
+    void setRanging(bool ranging);
+    void setScanDone();
+    // Slots the main board asked for (SCAN register), cleared by this call
+    SlotMask takeScanRequest();
+    // True while the change line should be pulled low
+    bool changePending() const { return _changePending; }
+
+    // --- Bus side (I2C slave callbacks) ---
+    void onWrite(const uint8_t* data, uint8_t length);
+    // Copies registers from the pointer into out; returns the number of bytes
+    uint8_t onRead(uint8_t* out, uint8_t maxLength);
+
+private:
+    static const uint8_t REGISTER_COUNT = SENSOR_REG_DISTANCE + 2 * NUM_SLOTS;
+    uint8_t _regs[REGISTER_COUNT];
+    uint8_t _pointer = 0;
+    volatile bool _changePending = true; // Let the main board read the boot state
+    volatile SlotMask _scanRequest = 0;
+
+    void setStatus(uint8_t flags, bool on);
+    void headerChanged();
+};
+
+#if !defined(__AVR__)
+#include "I2cBus.h"
+
+// Host stand-in for the sensor board, so the remote slot sensor backend runs
+// without hardware: answers I2cBus transactions to SENSOR_BOARD_ADDR from a
+// register file the test/simulator fills in, and drives PIN_SENSOR_IRQ with
+// digitalWrite() like the board's open-drain output would.
+class SensorBoardStandIn {
+public:
+    // Become the I2cBus host handler (other addresses are NACKed)
+    void attach();
+    void setSlot(uint8_t slot, bool free, uint16_t distanceMm, bool fault = false);
+    // Pending SCAN request from the main board (0 = none)
+    SlotMask scanRequest() const { return _scanRequest; }
+    // Complete the pending scan request (after the test has set the slots)
+    void finishScan();
+    SensorRegisterFile& registers() { return _registers; }
+
+    static I2cStatus transfer(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                              uint8_t* rx, uint8_t rxLength);
+
+private:
+    SensorRegisterFile _registers;
+    SlotMask _scanRequest = 0;
+    static SensorBoardStandIn* _instance;
+
+    void updateLine();
+};
+#endif
+
+#endif // SENSOR_LINK_H
@@ -0,0 +1,57 @@
+#include "SerialReport.h"
+
+bool SerialReport::start(ReportLineGenerator generator) {
+    if (!begin()) return false;
+    _lines = generator;
+    return true;
+}
+
+bool SerialReport::start(ReportFrameGenerator generator) {
+    if (!begin()) return false;
+    _frames = generator;
+    return true;
+}
+
+bool SerialReport::begin() {
+    if (isBusy()) {
+        _refused++;
+        return false;
+    }
+    _index = 0;
+    _length = 0;
+    _sent = 0;
+    return true;
+}
+
+bool SerialReport::next() {
+    if (_frames) {
+        _length = _frames(_index, _buffer, LINE_SIZE);
+        return _length > 0;
+    }
+    char* line = (char*)_buffer;
+    if (!_lines(_index, line, LINE_SIZE - 1)) return false;
+    _length = strlen(line);
+    line[_length++] = '\n';
+    return true;
+}
+
+void SerialReport::update() {
+    while (isBusy()) {
+        if (_sent == _length) {
+            // Previous line is out: generate the next one
+            if (!next()) {
+                _lines = nullptr;
+                _frames = nullptr;
+                return;
+            }
+            _index++;
+            _sent = 0;
+        }
+        int room = Serial.availableForWrite();
+        if (room <= 0) return; // TX buffer full: continue on the next pass
+        uint8_t chunk = _length - _sent;
+        if (room < chunk) chunk = room;
+        Serial.write(&_buffer[_sent], chunk);
+        _sent += chunk;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef SERIAL_REPORT_H
+#define SERIAL_REPORT_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Produces line index of a report into line (at most size - 1 characters,
+// no newline). Returns false once there are no more lines.
+typedef bool (*ReportLineGenerator)(uint8_t index, char* line, uint8_t size);
+// Binary reports: writes frame index into frame (at most size bytes) and
+// returns its length, 0 once there are no more frames
+typedef uint8_t (*ReportFrameGenerator)(uint8_t index, uint8_t* frame, uint8_t size);
+
+// Multi-line text replies on the Bluetooth serial link that never block.
+// Lines are generated one at a time and copied into the UART TX buffer only
+// as far as Serial.availableForWrite() allows, so a long report trickles out
+// at 9600 baud between loop() passes instead of stalling them.
+class SerialReport {
+public:
+    // Start sending a report; false if the previous one is still going out
+    bool start(ReportLineGenerator generator);
+    bool start(ReportFrameGenerator generator);
+    // Call from loop(): pushes as much of the report as fits
+    void update();
+    bool isBusy() const { return _lines != nullptr || _frames != nullptr; }
+    uint16_t refused() const { return _refused; } // start() calls while busy
+
+    static const uint8_t LINE_SIZE = 64;
+
+private:
+    ReportLineGenerator _lines = nullptr;
+    ReportFrameGenerator _frames = nullptr;
+    uint8_t _index = 0;  // Next line/frame to generate
+    uint8_t _buffer[LINE_SIZE];
+    uint8_t _length = 0; // Current line incl. newline, or frame
+    uint8_t _sent = 0;   // Bytes of it already in the TX buffer
+    uint16_t _refused = 0;
+
+    bool begin();
+    bool next(); // Generate the next line/frame into _buffer
+};
+
+#endif // SERIAL_REPORT_H
@@ -0,0 +1,77 @@
+#include "Session.h"
+
+int8_t SessionTable::open(int8_t slot) {
+    uint16_t id = _nextId++;
+    if (_nextId == 0) _nextId = 1; // 0 marks an unused entry
+    int8_t index = add(slot, id, SESSION_ADMITTED);
+    // Serial.print("Session "); Serial.print(id); Serial.print(" -> slot "); Serial.println(slot);
+    return index;
+}
+
+int8_t SessionTable::resume(int8_t slot, uint16_t id, uint32_t parkedS) {
+    int8_t index = add(slot, id, SESSION_DEPARTING);
+    if (index >= 0) _sessions[index].parkedS = parkedS;
+    return index;
+}
+
+int8_t SessionTable::add(int8_t slot, uint16_t id, SessionPhase phase) {
+    for (uint8_t i = 0; i < SESSION_MAX; ++i) {
+        Session& s = _sessions[i];
+        if (s.phase != SESSION_FREE) continue;
+
+        s.slot = slot;
+        s.id = id;
+        s.parkedS = 0;
+        setPhase(i, phase);
+
+        _active++;
+        return i;
+    }
+    // Serial.println("SessionTable: table full!");
+    return -1; // Table full - increase SESSION_MAX in config.h
+}
+
+void SessionTable::close(int8_t index) {
+    if (!isValid(index)) return;
+    _sessions[index].phase = SESSION_FREE;
+    _sessions[index].slot = -1;
+    _active--;
+}
+
+void SessionTable::setPhase(int8_t index, SessionPhase phase) {
+    if (index < 0 || index >= SESSION_MAX || phase == SESSION_FREE) return;
+    Session& s = _sessions[index];
+    s.phase = phase;
+    s.phaseSeq = _phaseSeq++;
+}
+
+int8_t SessionTable::oldest(SessionPhase phase) const {
+    int8_t found = -1;
+    for (uint8_t i = 0; i < SESSION_MAX; ++i) {
+        if (_sessions[i].phase != phase) continue;
+        // Signed difference keeps the order correct across sequence wrap-around
+        if (found < 0 || (int16_t)(_sessions[i].phaseSeq - _sessions[found].phaseSeq) < 0) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+uint8_t SessionTable::count(SessionPhase phase) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < SESSION_MAX; ++i) {
+        if (_sessions[i].phase == phase) n++;
+    }
+    return n;
+}
+
+SlotMask SessionTable::reservedMask() const {
+    SlotMask mask = 0;
+    for (uint8_t i = 0; i < SESSION_MAX; ++i) {
+        const Session& s = _sessions[i];
+        if (s.phase >= SESSION_ADMITTED && s.phase <= SESSION_GUIDING && s.slot >= 0) {
+            mask |= slotBit(s.slot);
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,76 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "SlotMask.h"
+
+// Lifecycle of one vehicle, from the entry barrier to the exit barrier
+enum SessionPhase : uint8_t {
+    SESSION_FREE = 0,  // Table entry unused
+    SESSION_ADMITTED,  // Slot reserved, entry barrier open, waiting for the car to pass
+    SESSION_QUEUED,    // Inside, waiting for the platform
+    SESSION_ALIGNING,  // Platform turning towards the session's slot
+    SESSION_GUIDING,   // Driver being guided into the slot
+    SESSION_PARKED,    // In the slot: handed over to ParkingTimer and the entry is freed
+    SESSION_DEPARTING, // Slot went free again, car on its way to the exit (resume())
+    SESSION_EXITING,   // Exit barrier open for this car
+    SESSION_PHASE_COUNT
+};
+
+struct Session {
+    SessionPhase phase = SESSION_FREE;
+    int8_t slot = -1;
+    uint16_t id = 0;                // Running vehicle number (never 0 for a used entry)
+    uint16_t phaseSeq = 0;          // Order in which sessions entered their current phase
+    uint32_t parkedS = 0;           // Parking duration, captured when the car departs
+};
+
+// Fixed-capacity table of vehicles moving through the garage (no heap).
+// Several sessions progress at once: one can be admitted at the entry while
+// another is guided or leaving. Sessions in the same phase are served in the
+// order they reached it (oldest()). A parked car only needs its slot's
+// ParkingTimer, so its entry is closed on parking and re-opened with
+// resume() when the car leaves the slot; the table size does not depend on
+// the number of slots.
+class SessionTable {
+public:
+    // Start a session for a car admitted to slot, -1 if the table is full
+    int8_t open(int8_t slot);
+    // Re-open the session of a parked car that left its slot (SESSION_DEPARTING)
+    int8_t resume(int8_t slot, uint16_t id, uint32_t parkedS);
+    void close(int8_t index);
+    void setPhase(int8_t index, SessionPhase phase);
+
+    Session& operator[](int8_t index) { return _sessions[index]; }
+    const Session& operator[](int8_t index) const { return _sessions[index]; }
+    bool isValid(int8_t index) const {
+        return index >= 0 && index < SESSION_MAX && _sessions[index].phase != SESSION_FREE;
+    }
+
+    // Session that reached phase first, -1 if none
+    int8_t oldest(SessionPhase phase) const;
+    uint8_t count(SessionPhase phase) const;
+    uint8_t active() const { return _active; }
+    bool isFull() const { return _active >= SESSION_MAX; }
+
+    // Slots held by a session from admission until the car is parked.
+    // They may still read as free on the sensors, so the allocator must skip them.
+    SlotMask reservedMask() const;
+
+    // Vehicle numbers continue after lastId (sessions restored from the journal)
+    void continueIds(uint16_t lastId) {
+        _nextId = lastId + 1;
+        if (_nextId == 0) _nextId = 1;
+    }
+
+private:
+    Session _sessions[SESSION_MAX];
+    uint16_t _nextId = 1;
+    uint16_t _phaseSeq = 0;
+    uint8_t _active = 0;
+
+    int8_t add(int8_t slot, uint16_t id, SessionPhase phase);
+};
+
+#endif // SESSION_H
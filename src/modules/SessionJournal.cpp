@@ -0,0 +1,221 @@
+#include "SessionJournal.h"
+#include "BluetoothCmd.h"
+#include <EEPROM.h>
+
+static_assert(SessionJournal::CAPACITY >= JOURNAL_QUEUE_DEPTH + 3,
+              "JOURNAL_EEPROM_BYTES must leave room to carry a running session forward");
+static_assert(SessionJournal::CAPACITY <= 64, "_carryMask has one bit per record");
+static_assert(JOURNAL_EEPROM_START + JOURNAL_EEPROM_BYTES <= 1024, "Journal does not fit the ATmega328P EEPROM");
+
+SlotMask SessionJournal::setup(ParkingTimer& timer) {
+    _timer = &timer;
+    // Pass 1: newest record (head of the ring) and the last known journal time
+    int16_t newest = -1;
+    uint16_t newestSeq = 0;
+    JournalRecord record;
+    for (uint8_t i = 0; i < CAPACITY; ++i) {
+        if (!readRecord(i, record)) continue;
+        _records++;
+        if (newest < 0 || (int16_t)(record.seq - newestSeq) > 0) {
+            newest = i;
+            newestSeq = record.seq;
+        }
+        uint32_t endS = record.startS + record.durationS;
+        if (endS > _baseS) _baseS = endS;
+    }
+    _baseS -= Clock::seconds(); // nowS() counts on from the newest record
+    _lastWriteS = nowS();
+    if (newest < 0) return 0; // Blank EEPROM (or nothing readable): start at position 0
+
+    _head = (newest + 1) % CAPACITY;
+    _writeIndex = _head;
+    _seq = newestSeq + 1;
+
+    // Pass 2: replay oldest to newest. Sessions with a START (or a copy of it)
+    // and no END were parked when the power went; their time runs on from the
+    // journal clock.
+    for (uint8_t n = 0; n < CAPACITY; ++n) {
+        uint8_t i = (_head + n) % CAPACITY;
+        if (!readRecord(i, record) || (uint16_t)(newestSeq - record.seq) >= CAPACITY) continue;
+        if (record.slot >= NUM_SLOTS) continue; // Clock checkpoints, or a journal from a bigger garage
+        if (record.type == JOURNAL_START || record.type == JOURNAL_CHECKPOINT) {
+            timer.reset(record.slot);
+            timer.restore(record.slot, record.session, nowS() - record.startS);
+            _openMask |= slotBit(record.slot);
+            if ((int16_t)(record.session - _lastSession) > 0) _lastSession = record.session;
+        } else if (record.type == JOURNAL_END) {
+            timer.reset(record.slot);
+            _openMask &= ~slotBit(record.slot);
+        }
+    }
+    _restoredMask = _openMask;
+
+    // Pass 3, newest to oldest: the record each restored session is carried by
+    SlotMask seen = 0;
+    for (uint8_t n = 1; n <= CAPACITY; ++n) {
+        uint8_t i = (_head + CAPACITY - n) % CAPACITY;
+        if (!readRecord(i, record) || (uint16_t)(newestSeq - record.seq) >= CAPACITY) continue;
+        if (!isRunning(record) || (seen & slotBit(record.slot))) continue;
+        seen |= slotBit(record.slot);
+        _carryMask |= 1ULL << i;
+    }
+    return _restoredMask;
+}
+
+void SessionJournal::update() {
+    uint32_t now = nowS();
+    // Waits for room in the queue: skipping it is no lost record
+    if (_openMask && _queueCount < JOURNAL_QUEUE_DEPTH && now - _lastWriteS >= JOURNAL_CHECKPOINT_S) {
+        append(JOURNAL_CHECKPOINT, 0xFF, 0, now, 0, 0);
+    }
+    carryForward();
+
+    // One byte per call, only when the previous cell write has finished
+    if (_queueCount == 0 || !eeprom_is_ready()) return;
+    const uint8_t* bytes = (const uint8_t*)&_queue[_queueFirst];
+    EEPROM.update(address(_writeIndex) + _byteIndex, bytes[_byteIndex]);
+    if (++_byteIndex == sizeof(JournalRecord)) {
+        _byteIndex = 0;
+        _writeIndex = (_writeIndex + 1) % CAPACITY;
+        _queueFirst = (_queueFirst + 1) % JOURNAL_QUEUE_DEPTH;
+        _queueCount--;
+    }
+}
+
+void SessionJournal::recordStart(uint8_t slot, uint16_t session) {
+    if (slot >= NUM_SLOTS) return;
+    _openMask |= slotBit(slot);
+    _lastSession = session;
+    append(JOURNAL_START, slot, session, nowS(), 0, 0);
+}
+
+void SessionJournal::recordEnd(uint8_t slot, uint16_t session, uint32_t parkedS, uint8_t flags) {
+    if (slot >= NUM_SLOTS) return;
+    SlotMask bit = slotBit(slot);
+    if (_restoredMask & bit) flags |= JOURNAL_FLAG_RESTORED;
+    _openMask &= ~bit;
+    _restoredMask &= ~bit;
+    uint32_t now = nowS();
+    append(JOURNAL_END, slot, session, now >= parkedS ? now - parkedS : 0, parkedS, flags);
+}
+
+// Copies the newest record of a running session forward before the ring
+// overwrites it. Records within JOURNAL_QUEUE_DEPTH of the head are copied
+// while the queue has room, so the records queued before the next call (at
+// most a full queue) never land on one that still needs copying. Reading the
+// record may wait for a cell write in progress (< 3.3 ms), once per copy.
+void SessionJournal::carryForward() {
+    JournalRecord record;
+    while (_carryMask && _queueCount < JOURNAL_QUEUE_DEPTH) {
+        uint8_t d = 0;
+        while (d <= JOURNAL_QUEUE_DEPTH && !(_carryMask & (1ULL << ((_head + d) % CAPACITY)))) d++;
+        if (d > JOURNAL_QUEUE_DEPTH) return;
+        uint8_t i = (_head + d) % CAPACITY;
+        _carryMask &= ~(1ULL << i);
+        if (!readRecord(i, record) || !isRunning(record)) continue; // Ended since
+        // More running sessions than the ring can carry: keep the ones it has
+        // (marks of sessions that ended since only make this count high)
+        uint8_t carried = 0;
+        for (uint64_t m = _carryMask; m; m &= m - 1) carried++;
+        if (slotCount(_openMask) > CARRY_LIMIT && carried >= CARRY_LIMIT) {
+            _dropped++;
+            continue;
+        }
+        uint32_t now = nowS();
+        append(JOURNAL_CHECKPOINT, record.slot, record.session, record.startS,
+               now >= record.startS ? now - record.startS : 0, record.flags);
+    }
+}
+
+// Record of a session that is still running (its vehicle number on the timer)
+bool SessionJournal::isRunning(const JournalRecord& record) const {
+    if (record.type == JOURNAL_END || record.slot >= NUM_SLOTS) return false;
+    return (_openMask & slotBit(record.slot)) && _timer && _timer->sessionId[record.slot] == record.session;
+}
+
+void SessionJournal::append(uint8_t type, uint8_t slot, uint16_t session, uint32_t startS,
+                            uint32_t durationS, uint8_t flags) {
+    if (_queueCount >= JOURNAL_QUEUE_DEPTH) {
+        _dropped++;
+        return;
+    }
+    _carryMask &= ~(1ULL << _head); // Overwritten
+    if (type != JOURNAL_END && slot < NUM_SLOTS) _carryMask |= 1ULL << _head;
+    JournalRecord& record = _queue[(_queueFirst + _queueCount) % JOURNAL_QUEUE_DEPTH];
+    record.startS = startS;
+    record.durationS = durationS;
+    record.seq = _seq++;
+    record.session = session;
+    record.type = type;
+    record.slot = slot;
+    record.flags = flags;
+    record.crc = BluetoothCmd::crc8((const uint8_t*)&record, sizeof(JournalRecord) - 1);
+    _queueCount++;
+    _head = (_head + 1) % CAPACITY;
+    _lastWriteS = nowS();
+    if (_records < CAPACITY) _records++;
+}
+
+bool SessionJournal::readRecord(uint8_t index, JournalRecord& record) {
+    uint8_t* bytes = (uint8_t*)&record;
+    uint16_t base = address(index);
+    for (uint8_t i = 0; i < sizeof(JournalRecord); ++i) {
+        bytes[i] = EEPROM.read(base + i);
+    }
+    // Erased cells read 0xFF, which is never a valid type
+    if (record.type < JOURNAL_START || record.type > JOURNAL_CHECKPOINT) return false;
+    return BluetoothCmd::crc8(bytes, sizeof(JournalRecord) - 1) == record.crc;
+}
+
+// --- Export ---
+
+uint8_t SessionJournal::buildFrame(uint8_t* frame, uint8_t type, uint8_t payloadLength) {
+    frame[0] = BluetoothCmd::FRAME_SYNC;
+    frame[1] = 1 + payloadLength; // TYPE + payload, like an inbound OPCODE + args
+    frame[2] = type;
+    frame[3 + payloadLength] = BluetoothCmd::crc8(&frame[1], 2 + payloadLength);
+    return 4 + payloadLength;
+}
+
+// Reads EEPROM directly; a read waits for a cell write in progress (< 3.3 ms),
+// at most once per frame since update() is not called in between.
+uint8_t SessionJournal::exportFrame(uint8_t index, uint8_t* frame, uint8_t size) {
+    if (size < 4 + EXPORT_BATCH * sizeof(JournalRecord)) return 0;
+    uint8_t* payload = &frame[3];
+
+    if (index == 0) {
+        _exportStart = _writeIndex;
+        _exportPos = 0;
+        _exportFrames = 0;
+        _exportRecords = 0;
+        payload[0] = EXPORT_VERSION;
+        payload[1] = sizeof(JournalRecord);
+        payload[2] = CAPACITY;
+        payload[3] = _records;
+        uint32_t now = nowS();
+        memcpy(&payload[4], &now, sizeof(now)); // Little-endian on AVR and host
+        return buildFrame(frame, JOURNAL_FRAME_HEADER, 8);
+    }
+    if (_exportPos > CAPACITY) return 0; // End frame already sent
+
+    // Oldest first: the position after the newest record in EEPROM (queued
+    // records have not overwritten theirs yet)
+    uint8_t count = 0;
+    JournalRecord record;
+    while (_exportPos < CAPACITY && count < EXPORT_BATCH) {
+        if (readRecord((_exportStart + _exportPos++) % CAPACITY, record)) {
+            memcpy(&payload[count * sizeof(JournalRecord)], &record, sizeof(JournalRecord));
+            count++;
+        }
+    }
+    if (count > 0) {
+        _exportFrames++;
+        _exportRecords += count;
+        return buildFrame(frame, JOURNAL_FRAME_RECORDS, count * sizeof(JournalRecord));
+    }
+
+    _exportPos = CAPACITY + 1;
+    payload[0] = _exportFrames;
+    payload[1] = _exportRecords;
+    return buildFrame(frame, JOURNAL_FRAME_END, 2);
+}
@@ -0,0 +1,116 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "SlotMask.h"
+#include "Timer.h"
+
+enum JournalRecordType : uint8_t {
+    JOURNAL_START = 1,  // Car parked: timer started (durationS = 0)
+    JOURNAL_END,        // Car left its slot: startS + durationS
+    JOURNAL_CHECKPOINT  // Journal clock while cars are parked (slot = 0xFF), or a
+                        // running session copied forward: slot, session, startS and
+                        // durationS up to the copy (a START that outlives the ring)
+};
+
+// Record flags
+const uint8_t JOURNAL_FLAG_RESTORED = 0x01; // Session was running across a reset
+const uint8_t JOURNAL_FLAG_OFFLINE = 0x02;  // Slot empty at boot: left while powered off (duration up to the last known time)
+
+// One EEPROM record, little-endian, laid out without padding on AVR and host.
+// Times are journal clock seconds: uptime that carries on from the newest
+// record after a reset (time without power is not counted).
+struct JournalRecord {
+    uint32_t startS;    // Parking start
+    uint32_t durationS; // JOURNAL_END only
+    uint16_t seq;       // Append order (wraps; the ring is far smaller than 32768)
+    uint16_t session;   // Vehicle number (Session::id)
+    uint8_t type;       // JournalRecordType
+    uint8_t slot;
+    uint8_t flags;
+    uint8_t crc;        // CRC-8 of the bytes above, written last
+};
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord must stay 16 bytes (EEPROM and export layout)");
+
+// Parking history in an append-only EEPROM ring.
+// Records are queued in RAM and written one byte per update() call, only
+// when the EEPROM is ready, so a 3.3 ms cell write never stalls loop(). The
+// CRC byte goes last: a record cut short by a reset fails its check and is
+// skipped. There is no header to wear out: setup() finds the head as the
+// valid record with the newest sequence number and replays the ring in
+// order, so sessions that were running when the power went are restored into
+// ParkingTimer. Before the ring comes round to the newest record of a session
+// that is still running, that record is copied forward as a CHECKPOINT, so a
+// car parked for longer than one pass of the ring is restored as well (up to
+// CARRY_LIMIT running sessions).
+class SessionJournal {
+public:
+    // Reads the ring and restores running sessions into timer; returns their slots
+    SlotMask setup(ParkingTimer& timer);
+    // Call from loop(): journal clock, checkpoints, one EEPROM byte when ready
+    void update();
+
+    void recordStart(uint8_t slot, uint16_t session);
+    void recordEnd(uint8_t slot, uint16_t session, uint32_t parkedS, uint8_t flags = 0);
+
+    uint32_t nowS() const { return _baseS + Clock::seconds(); }
+    uint16_t lastSession() const { return _lastSession; } // Newest vehicle number in the journal
+    uint8_t records() const { return _records; }          // Valid records in EEPROM at boot + written since
+    uint16_t dropped() const { return _dropped; }         // Records lost to a full write queue or a full ring
+    bool isIdle() const { return _queueCount == 0; }
+
+    // Bulk export for SerialReport: frame index of one pass over the ring
+    // (0xA5 LEN TYPE payload CRC8, the BluetoothCmd frame layout):
+    //   JOURNAL_FRAME_HEADER: version, record size, capacity, records, nowS (u32)
+    //   JOURNAL_FRAME_RECORDS: up to EXPORT_BATCH raw JournalRecords, ring order
+    //   JOURNAL_FRAME_END: record frames sent, records sent
+    // Records still in the write queue go out with the next export.
+    uint8_t exportFrame(uint8_t index, uint8_t* frame, uint8_t size);
+
+    static const uint8_t CAPACITY = JOURNAL_EEPROM_BYTES / sizeof(JournalRecord);
+    // Running sessions the ring keeps: copies need a few free records ahead
+    static const uint8_t CARRY_LIMIT = CAPACITY - JOURNAL_QUEUE_DEPTH - 2;
+    static const uint8_t EXPORT_BATCH = 3;
+    static const uint8_t EXPORT_VERSION = 1;
+    static const uint8_t JOURNAL_FRAME_HEADER = 0xE0;
+    static const uint8_t JOURNAL_FRAME_RECORDS = 0xE1;
+    static const uint8_t JOURNAL_FRAME_END = 0xE2;
+
+private:
+    JournalRecord _queue[JOURNAL_QUEUE_DEPTH];
+    uint8_t _queueFirst = 0;
+    uint8_t _queueCount = 0;
+    uint8_t _byteIndex = 0;     // Next byte of the first queued record
+    uint8_t _writeIndex = 0;    // Ring position of the first queued record
+    uint8_t _head = 0;          // Ring position of the next record to queue
+    uint16_t _seq = 0;          // Sequence number of the next record
+    uint8_t _records = 0;
+    uint16_t _dropped = 0;
+    uint16_t _lastSession = 0;
+
+    uint32_t _baseS = 0;        // Journal clock at boot (newest time in the ring)
+    uint32_t _lastWriteS = 0;   // Journal time of the newest queued record
+    SlotMask _openMask = 0;     // Slots with a START and no END yet
+    SlotMask _restoredMask = 0; // Open since before the last reset (END gets JOURNAL_FLAG_RESTORED)
+    uint64_t _carryMask = 0;    // Ring positions holding the newest record of a running session
+    const ParkingTimer* _timer = nullptr; // Vehicle numbers of the running sessions
+
+    // Export cursor
+    uint8_t _exportStart = 0; // Oldest record in EEPROM when the export started
+    uint8_t _exportPos = 0;
+    uint8_t _exportFrames = 0;
+    uint8_t _exportRecords = 0;
+
+    void append(uint8_t type, uint8_t slot, uint16_t session, uint32_t startS,
+                uint32_t durationS, uint8_t flags);
+    void carryForward();
+    bool isRunning(const JournalRecord& record) const;
+    static bool readRecord(uint8_t index, JournalRecord& record);
+    static uint16_t address(uint8_t index) {
+        return JOURNAL_EEPROM_START + (uint16_t)index * sizeof(JournalRecord);
+    }
+    static uint8_t buildFrame(uint8_t* frame, uint8_t type, uint8_t payloadLength);
+};
+
+#endif // SESSION_JOURNAL_H
@@ -0,0 +1,92 @@
+#include "SlotAllocator.h"
+#include "Platform.h" // estimateMoveMs()
+#include "Profiler.h"
+
+void SlotAllocator::setPolicy(AllocationPolicy policy) {
+    if (policy < POLICY_COUNT) {
+        _policy = policy;
+    }
+}
+
+int8_t SlotAllocator::allocate(SlotMask freeMask, int platformAngle) {
+    PROFILE_SCOPE(PROBE_ALLOCATE);
+    uint32_t startUs = micros();
+    int8_t slot = choose(freeMask, platformAngle);
+    _predicted = -1; // The next car gets a new prediction once the platform is idle
+    if (slot < 0) return -1;
+
+    _lastUsed[slot] = ++_sequence;
+    if (_sequence == 0xFF) {
+        // Keep the LRU order but make room for new sequence numbers
+        for (uint8_t i = 0; i < NUM_SLOTS; ++i) _lastUsed[i] >>= 1;
+        _sequence >>= 1;
+    }
+
+    // Compare with what first-free would have cost from the same angle
+    int8_t baseline = firstFree(freeMask);
+    _lastAlignMs = Platform::estimateMoveMs(platformAngle, platformSlotAngle(slot));
+    _lastSavedMs = (long)Platform::estimateMoveMs(platformAngle, platformSlotAngle(baseline)) -
+                   (long)_lastAlignMs;
+    _totalSavedMs += _lastSavedMs;
+    _allocations++;
+
+    unsigned int allocateUs = micros() - startUs;
+    if (allocateUs > _maxAllocateUs) _maxAllocateUs = allocateUs;
+    return slot;
+}
+
+// The least recently used free slot does not depend on where the platform
+// stands, so it is known before the next car arrives: that is the car's slot,
+// and the platform turns there while idle (wear levelling without the
+// alignment time). Cars that come in while the platform is busy get the
+// nearest slot instead.
+int8_t SlotAllocator::prepositionSlot(SlotMask freeMask) {
+    if (_policy != POLICY_PREDICTIVE) return -1;
+    _predicted = leastRecentlyUsed(freeMask);
+    return _predicted;
+}
+
+int8_t SlotAllocator::choose(SlotMask freeMask, int platformAngle) const {
+    switch (_policy) {
+        case POLICY_PREDICTIVE:
+            if (_predicted >= 0 && (freeMask & slotBit(_predicted))) return _predicted;
+            return nearest(freeMask, platformAngle);
+        case POLICY_NEAREST:
+            return nearest(freeMask, platformAngle);
+        case POLICY_LRU:
+            return leastRecentlyUsed(freeMask);
+        case POLICY_FIRST_FREE:
+        default:
+            return firstFree(freeMask);
+    }
+}
+
+int8_t SlotAllocator::firstFree(SlotMask freeMask) {
+    return lowestSlot(freeMask);
+}
+
+int8_t SlotAllocator::nearest(SlotMask freeMask, int platformAngle) {
+    int8_t best = -1;
+    int bestDistance = 0;
+    // Visit the free slots only: clear the lowest set bit each round
+    for (SlotMask m = freeMask & ALL_SLOTS_MASK; m; m &= m - 1) {
+        int8_t i = lowestSlot(m);
+        int distance = abs(platformSlotAngle(i) - platformAngle);
+        if (best < 0 || distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+int8_t SlotAllocator::leastRecentlyUsed(SlotMask freeMask) const {
+    int8_t best = -1;
+    for (SlotMask m = freeMask & ALL_SLOTS_MASK; m; m &= m - 1) {
+        int8_t i = lowestSlot(m);
+        if (best < 0 || _lastUsed[i] < _lastUsed[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,56 @@
+#ifndef SLOT_ALLOCATOR_H
+#define SLOT_ALLOCATOR_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "SlotMask.h"
+
+enum AllocationPolicy : uint8_t {
+    POLICY_FIRST_FREE = 0, // Lowest free index (original behaviour)
+    POLICY_NEAREST,        // Free slot closest to the current platform angle
+    POLICY_LRU,            // Free slot assigned least recently (wear levelling)
+    POLICY_PREDICTIVE,     // Least recently used, with the platform turned to it while idle (nearest when busy)
+    POLICY_COUNT
+};
+
+// Chooses the target slot in WEIGHT_CHECK. Costs come from
+// Platform::estimateMoveMs(), so every decision also reports how much
+// alignment time it is expected to save against first-free.
+class SlotAllocator {
+public:
+    void setPolicy(AllocationPolicy policy);
+    AllocationPolicy policy() const { return _policy; }
+
+    // Pick a slot from freeMask for a platform at platformAngle, -1 if none.
+    // Records the assignment (LRU order, savings statistics).
+    int8_t allocate(SlotMask freeMask, int platformAngle);
+    // Slot the platform should face while idle, -1 to stay put
+    // (only POLICY_PREDICTIVE pre-positions). Also the next car's slot.
+    int8_t prepositionSlot(SlotMask freeMask);
+
+    // Expected alignment time of the last allocation and its saving vs first-free
+    unsigned long lastAlignMs() const { return _lastAlignMs; }
+    long lastSavedMs() const { return _lastSavedMs; }
+    long totalSavedMs() const { return _totalSavedMs; }
+    unsigned long allocations() const { return _allocations; }
+    // Longest time spent in allocate() (us), to check the cost as NUM_SLOTS grows
+    unsigned int maxAllocateUs() const { return _maxAllocateUs; }
+
+private:
+    AllocationPolicy _policy = (AllocationPolicy)SLOT_ALLOCATION_POLICY;
+    uint8_t _lastUsed[NUM_SLOTS] = {0}; // Allocation sequence number per slot (0 = never)
+    uint8_t _sequence = 0;
+    int8_t _predicted = -1; // POLICY_PREDICTIVE: slot the platform was sent to for the next car
+    unsigned long _lastAlignMs = 0;
+    long _lastSavedMs = 0;
+    long _totalSavedMs = 0;
+    unsigned long _allocations = 0;
+    unsigned int _maxAllocateUs = 0;
+
+    int8_t choose(SlotMask freeMask, int platformAngle) const;
+    static int8_t firstFree(SlotMask freeMask);
+    static int8_t nearest(SlotMask freeMask, int platformAngle);
+    int8_t leastRecentlyUsed(SlotMask freeMask) const;
+};
+
+#endif // SLOT_ALLOCATOR_H
@@ -0,0 +1,43 @@
+#ifndef SLOT_MASK_H
+#define SLOT_MASK_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// One bit per slot (bit i = slot i), as narrow as NUM_SLOTS allows:
+// uint8_t up to 8 slots, then 16, 32 and 64 bits.
+template <uint8_t N> struct SlotMaskFor {
+    typedef typename SlotMaskFor<(N <= 8 ? 8 : N <= 16 ? 16 : N <= 32 ? 32 : 64)>::type type;
+};
+template <> struct SlotMaskFor<8> { typedef uint8_t type; };
+template <> struct SlotMaskFor<16> { typedef uint16_t type; };
+template <> struct SlotMaskFor<32> { typedef uint32_t type; };
+template <> struct SlotMaskFor<64> { typedef uint64_t type; };
+
+typedef SlotMaskFor<NUM_SLOTS>::type SlotMask;
+static_assert(NUM_SLOTS >= 1 && NUM_SLOTS <= 64, "NUM_SLOTS must be 1..64");
+
+// Careful: int is 16 bits on AVR, so never build slot bits with a plain 1 << slot
+constexpr SlotMask slotBit(uint8_t slot) {
+    return (SlotMask)1 << slot;
+}
+
+constexpr SlotMask ALL_SLOTS_MASK =
+    NUM_SLOTS == 8 * sizeof(SlotMask) ? (SlotMask)~(SlotMask)0 : (SlotMask)(slotBit(NUM_SLOTS) - 1);
+
+// Lowest slot in mask, -1 if the mask is empty (one bit scan, no slot loop)
+inline int8_t lowestSlot(SlotMask mask) {
+    if (!mask) return -1;
+    if (sizeof(SlotMask) <= sizeof(unsigned int)) return __builtin_ctz(mask);
+    if (sizeof(SlotMask) <= sizeof(unsigned long)) return __builtin_ctzl(mask);
+    return __builtin_ctzll(mask);
+}
+
+// Number of slots in mask
+inline uint8_t slotCount(SlotMask mask) {
+    if (sizeof(SlotMask) <= sizeof(unsigned int)) return __builtin_popcount(mask);
+    if (sizeof(SlotMask) <= sizeof(unsigned long)) return __builtin_popcountl(mask);
+    return __builtin_popcountll(mask);
+}
+
+#endif // SLOT_MASK_H
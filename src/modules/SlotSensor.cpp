@@ -1,35 +1,100 @@
 #include "SlotSensor.h"
+#include "PinChangeIrq.h"
+#include "FastPin.h"
+#include "TraceRecorder.h"
+
+// Trigger/echo pins resolved to port + bit at compile time
+static constexpr PinTable<SLOT_ECHO_CHANNELS> TRIG_PINS = makePinTable(PINS_TRIG);
+static constexpr PinTable<SLOT_ECHO_CHANNELS> ECHO_PINS = makePinTable(PINS_ECHO);
+
+#if SLOT_IO_MULTIPLEXED
+static_assert(SLOT_MUX_ADDR_BITS <= sizeof(PINS_SENSOR_ADDR), "Not enough PINS_SENSOR_ADDR for NUM_SLOTS");
+static constexpr PinTable<sizeof(PINS_SENSOR_ADDR)> ADDR_PINS = makePinTable(PINS_SENSOR_ADDR);
+#endif
+
+volatile uint8_t SlotSensor::_echoPhase[SLOT_ECHO_CHANNELS] = {0};
+volatile uint32_t SlotSensor::_echoRiseUs[SLOT_ECHO_CHANNELS] = {0};
+volatile uint32_t SlotSensor::_echoFallUs[SLOT_ECHO_CHANNELS] = {0};
 
 void SlotSensor::setup() {
-    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
-        pinMode(PINS_TRIG[i], OUTPUT);
-        pinMode(PINS_ECHO[i], INPUT);
+    for (uint8_t ch = 0; ch < SLOT_ECHO_CHANNELS; ++ch) {
+        pinMode(PINS_TRIG[ch], OUTPUT);
+        digitalWrite(PINS_TRIG[ch], LOW);
+        pinMode(PINS_ECHO[ch], INPUT);
+        PinChangeIrq::attach(PINS_ECHO[ch], onEchoEdge);
+        _channelSlot[ch] = -1;
     }
+#if SLOT_IO_MULTIPLEXED
+    for (uint8_t b = 0; b < SLOT_MUX_ADDR_BITS; ++b) {
+        pinMode(PINS_SENSOR_ADDR[b], OUTPUT);
+    }
+    selectSensor(0);
+#endif
     // Serial.println("SlotSensor setup complete.");
 }
 
+// Routes the shared trigger/echo lines to the slot's sensor (multiplexed wiring only)
+void SlotSensor::selectSensor(uint8_t slot) {
+#if SLOT_IO_MULTIPLEXED
+    for (uint8_t b = 0; b < SLOT_MUX_ADDR_BITS; ++b) {
+        fastWrite(ADDR_PINS[b], (slot >> b) & 1);
+    }
+    delayMicroseconds(SLOT_MUX_SETTLE_US);
+#else
+    (void)slot; // Every slot has its own pins
+#endif
+}
+
 // Reads distance from a single HC-SR04 sensor
-float SlotSensor::readDistanceCm(uint8_t trigPin, uint8_t echoPin) {
+float SlotSensor::readDistanceCm(uint8_t slot) {
+    return echoUsToCm(readEchoUs(slot));
+}
+
+// Blocking measurement of the echo pulse width (0 on timeout)
+unsigned long SlotSensor::readEchoUs(uint8_t slot) {
+    uint8_t ch = channelOf(slot);
+    selectSensor(slot);
     // Clear the trigPin
-    digitalWrite(trigPin, LOW);
+    fastWrite(TRIG_PINS[ch], LOW);
     delayMicroseconds(2);
 
     // Send a 10us pulse to trigger
-    digitalWrite(trigPin, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(trigPin, LOW);
+    fastPulse<10>(TRIG_PINS[ch]);
 
     // Read the echoPin, returns the sound wave travel time in microseconds
     // Timeout added for robustness (e.g., 30000 us corresponds to ~5 meters)
-    long duration = pulseIn(echoPin, HIGH, 30000); 
+    return pulseIn(PINS_ECHO[ch], HIGH, SLOT_ECHO_TIMEOUT_US);
+}
 
-    // Calculate the distance
+// Blocking, range-gated measurement: returns the echo width, or ECHO_GATE_US
+// as soon as the echo has lasted that long (0 if the sensor never answered)
+unsigned long SlotSensor::readEchoGatedUs(uint8_t slot) {
+    uint8_t ch = channelOf(slot);
+    const PinRef& echo = ECHO_PINS[ch];
+    selectSensor(slot);
+    fastWrite(TRIG_PINS[ch], LOW);
+    delayMicroseconds(2);
+    fastPulse<10>(TRIG_PINS[ch]);
+
+    uint32_t start = micros();
+    while (fastRead(echo) == LOW) {
+        if (micros() - start > SLOT_ECHO_RISE_MAX_US) return 0; // No echo started
+    }
+    uint32_t rise = micros();
+    while (fastRead(echo) == HIGH) {
+        if (micros() - rise >= ECHO_GATE_US) return ECHO_GATE_US; // Beyond the gate
+    }
+    return micros() - rise;
+}
+
+// Converts an echo pulse width to a distance, -1 for timeout or out of range
+float SlotSensor::echoUsToCm(unsigned long echoUs) {
     // Speed of sound = 343 m/s = 0.0343 cm/us
     // Distance = (Travel Time / 2) * Speed of Sound
-    float distance = (duration * 0.0343) / 2.0;
+    float distance = (echoUs * 0.0343) / 2.0;
 
     // Handle timeout or out-of-range readings
-    if (duration == 0 || distance > 400) { // Max range of HC-SR04 is ~400cm
+    if (echoUs == 0 || distance > 400) { // Max range of HC-SR04 is ~400cm
         return -1.0; // Indicate error or out of range
     }
 
@@ -41,62 +106,183 @@ float SlotSensor::getSlotDistanceCm(uint8_t slot) {
     if (slot >= NUM_SLOTS) return -1.0; // Invalid slot
 
     // --- Basic Reading (No Filter) ---
-    return readDistanceCm(PINS_TRIG[slot], PINS_ECHO[slot]);
+    return readDistanceCm(slot);
+}
+
+// =================== OCCUPANCY SNAPSHOT ===================
+
+// Checks if a specific slot is free, from the snapshot when it is recent enough.
+// A stale (or never measured) slot is re-measured with a blocking read.
+bool SlotSensor::isSlotFree(uint8_t slot, unsigned long maxAgeMs) {
+    if (slot >= NUM_SLOTS) return false;
+    SlotMask bit = slotBit(slot);
+    bool pending = (_scanPendingMask & bit) != 0; // A fresh reading is already on its way
+    // A blocking read would disturb a scan measurement in flight on the same channel
+    bool channelBusy = _channelSlot[channelOf(slot)] >= 0;
+    if (!pending && !channelBusy && slotAgeMs(slot) > maxAgeMs) {
+        if (SLOT_RANGE_GATED) {
+            recordSample(slot, readEchoGatedUs(slot));
+        } else {
+            recordSample(slot, readEchoUs(slot));
+        }
+    }
+    return (_freeMask & bit) != 0;
+}
+
+unsigned long SlotSensor::slotAgeMs(uint8_t slot) const {
+    if (slot >= NUM_SLOTS || !(_sampledMask & slotBit(slot))) {
+        return (unsigned long)-1; // Never measured
+    }
+    uint16_t ticks = (uint16_t)((uint32_t)Clock::ms() >> SAMPLE_TICK_SHIFT) - _sampleTick[slot];
+    return (unsigned long)ticks << SAMPLE_TICK_SHIFT;
+}
 
-    // --- Placeholder for Median Filter ---
-    // return getMedianDistanceCm(slot);
+// Finds the first available slot (index 0 to NUM_SLOTS-1) by scanning the free mask
+int SlotSensor::findFirstFreeSlot() const {
+    return lowestSlot(_freeMask); // -1 if no slots are free
 }
 
-// Checks if a specific slot is free based on the threshold
-bool SlotSensor::isSlotFree(uint8_t slot) {
-    float distance = getSlotDistanceCm(slot);
-    // Consider slot free if reading is valid (>0) and above the threshold
-    return (distance > 0 && distance > SLOT_OCCUPIED_THRESHOLD_CM);
+// Stores a new measurement in the snapshot
+void SlotSensor::recordSample(uint8_t slot, unsigned long echoUs) {
+    SlotMask bit = slotBit(slot);
+    _latestEchoUs[slot] = echoUs > SLOT_ECHO_TIMEOUT_US ? 0 : echoUs;
+    _sampleTick[slot] = (uint32_t)Clock::ms() >> SAMPLE_TICK_SHIFT;
+    _sampledMask |= bit;
+    TRACE_ECHO(slot, _latestEchoUs[slot]);
+
+    // The free bit follows the de-noised decision, not the raw reading
+    _filters[slot].push(_latestEchoUs[slot]);
+    if (_filters[slot].isOccupied()) {
+        _freeMask &= ~bit;
+    } else {
+        _freeMask |= bit;
+    }
 }
 
-// Finds the first available slot (index 0 to NUM_SLOTS-1)
-int SlotSensor::findFirstFreeSlot() {
-    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
-        if (isSlotFree(i)) {
-            return i; // Return the index of the first free slot
+// Background refresh: measure the next slot in round-robin order.
+// Skipped while another scan is running (that scan refreshes the snapshot too).
+void SlotSensor::refreshNext() {
+    if (!isScanComplete()) return;
+    startScan(slotBit(_refreshIndex));
+    _refreshIndex = (_refreshIndex + 1) % NUM_SLOTS;
+}
+
+// =================== NON-BLOCKING RANGING ===================
+
+// Pin-change interrupt: timestamp echo edges of armed channels
+void SlotSensor::onEchoEdge(uint8_t pin, uint8_t level, uint32_t timestampUs) {
+    for (uint8_t ch = 0; ch < SLOT_ECHO_CHANNELS; ++ch) {
+        if (PINS_ECHO[ch] != pin) continue;
+        if (level == HIGH && _echoPhase[ch] == ECHO_ARMED) {
+            _echoRiseUs[ch] = timestampUs;
+            _echoPhase[ch] = ECHO_HIGH;
+        } else if (level == LOW && _echoPhase[ch] == ECHO_HIGH) {
+            _echoFallUs[ch] = timestampUs;
+            _echoPhase[ch] = ECHO_DONE;
         }
+        return;
     }
-    return -1; // Return -1 if no slots are free
 }
 
-/*
-// --- Optional: Median Filter Implementation ---
-// Helper function for sorting (used by median)
-int compareFloats(const void* a, const void* b) {
-    float fa = *(const float*)a;
-    float fb = *(const float*)b;
-    return (fa > fb) - (fa < fb);
+bool SlotSensor::startScan(SlotMask slotMask) {
+    if (!isScanComplete()) return false;
+    slotMask &= ALL_SLOTS_MASK;
+    _scanStartUs = micros();
+    _triggerPendingMask = slotMask;
+    _scanPendingMask = slotMask;
+    update(); // Fire the first trigger right away
+    return true;
 }
 
-// Reads multiple times and returns the median distance
-float SlotSensor::getMedianDistanceCm(uint8_t slot) {
-    if (slot >= NUM_SLOTS) return -1.0;
+void SlotSensor::fireTrigger(uint8_t channel) {
+    _echoPhase[channel] = ECHO_ARMED; // Arm before the pulse so the rising edge is not missed
+    fastPulse<10>(TRIG_PINS[channel]); // 10us trigger pulse, cycle-counted
+    _triggerUs[channel] = micros();
+}
+
+void SlotSensor::update() {
+    if (_scanPendingMask == 0) return;
+    uint32_t now = micros();
 
-    uint8_t trigPin = PINS_TRIG[slot];
-    uint8_t echoPin = PINS_ECHO[slot];
-    int validReadings = 0;
+    // Publish finished measurements and expire silent sensors
+    for (uint8_t ch = 0; ch < SLOT_ECHO_CHANNELS; ++ch) {
+        int8_t slot = _channelSlot[ch];
+        if (slot < 0) continue;
 
-    for (int i = 0; i < MEDIAN_FILTER_SIZE; ++i) {
-        float dist = readDistanceCm(trigPin, echoPin);
-        if (dist > 0) { // Only consider valid readings
-            _distanceReadings[validReadings++] = dist;
+        uint8_t phase = _echoPhase[ch];
+        if (phase == ECHO_DONE) {
+            noInterrupts();
+            uint32_t width = _echoFallUs[ch] - _echoRiseUs[ch];
+            interrupts();
+            recordSample(slot, width);
+        } else if (phase == ECHO_HIGH) {
+            noInterrupts();
+            uint32_t rise = _echoRiseUs[ch];
+            interrupts();
+            uint32_t elapsed = now - rise;
+            if (SLOT_RANGE_GATED && elapsed >= ECHO_GATE_US) {
+                recordSample(slot, ECHO_GATE_US); // Gate passed: nothing within range
+            } else if (elapsed > SLOT_ECHO_TIMEOUT_US) {
+                recordSample(slot, 0); // Echo never ended
+            } else {
+                continue; // Still measuring
+            }
+        } else if (now - _triggerUs[ch] > SLOT_ECHO_RISE_MAX_US) {
+            recordSample(slot, 0); // Sensor did not answer
+        } else {
+            continue; // Still measuring
         }
-        delay(30); // Short delay between readings
+        _echoPhase[ch] = ECHO_IDLE;
+        _channelSlot[ch] = -1;
+        _channelIdleUs[ch] = now;
+        _scanPendingMask &= ~slotBit(slot);
     }
 
-    if (validReadings == 0) {
-        return -1.0; // No valid readings obtained
+    // Fire triggers on a staggered schedule (slot order within the scan).
+    // A channel measures one slot at a time; with a shared channel the
+    // sensors are measured back to back, SLOT_SENSOR_STAGGER_US apart.
+    uint8_t order = 0;
+    for (SlotMask pending = _scanPendingMask; pending; pending &= pending - 1) {
+        uint8_t i = lowestSlot(pending);
+        SlotMask bit = slotBit(i);
+        uint32_t dueUs = (uint32_t)order * SLOT_SENSOR_STAGGER_US;
+        order++;
+        if (!(_triggerPendingMask & bit)) continue;
+
+        uint8_t ch = channelOf(i);
+        if (_channelSlot[ch] >= 0) {
+            if (SLOT_ECHO_CHANNELS == 1) break; // Everything else waits for the same channel
+            continue;
+        }
+        if (now - _scanStartUs < dueUs) continue;
+        if (SLOT_ECHO_CHANNELS == 1 && now - _triggerUs[ch] < SLOT_SENSOR_STAGGER_US) break;
+
+        // A sensor still holding its echo line high (e.g. after a gated measurement
+        // of a far target) ignores triggers, so wait for it to go idle first
+        selectSensor(i);
+        uint32_t readyUs = _scanStartUs + dueUs;
+        if ((int32_t)(_channelIdleUs[ch] - readyUs) > 0) readyUs = _channelIdleUs[ch];
+        if (fastRead(ECHO_PINS[ch]) == LOW) {
+            _triggerPendingMask &= ~bit;
+            _channelSlot[ch] = i;
+            fireTrigger(ch);
+            now = micros();
+        } else if (now - readyUs > SLOT_ECHO_TIMEOUT_US) {
+            _triggerPendingMask &= ~bit; // Echo line stuck high: give up on this slot
+            _scanPendingMask &= ~bit;
+            _channelIdleUs[ch] = now;
+            recordSample(i, 0);
+        }
+        if (SLOT_ECHO_CHANNELS == 1) break;
     }
+}
 
-    // Sort the valid readings
-    qsort(_distanceReadings, validReadings, sizeof(float), compareFloats);
+float SlotSensor::latestDistance(uint8_t slot) const {
+    if (slot >= NUM_SLOTS) return -1.0;
+    return echoUsToCm(_latestEchoUs[slot]);
+}
 
-    // Return the median value
-    return _distanceReadings[validReadings / 2];
+uint8_t SlotSensor::confidence(uint8_t slot) const {
+    if (slot >= NUM_SLOTS) return 0;
+    return _filters[slot].validCount();
 }
-*/
@@ -3,22 +3,80 @@
 
 #include "../config.h"
 #include <Arduino.h>
+#include "OccupancyFilter.h"
+#include "SlotMask.h"
+#include "Clock.h"
 
 class SlotSensor {
 public:
     void setup();
-    bool isSlotFree(uint8_t slot); // Returns true if distance > threshold
-    float getSlotDistanceCm(uint8_t slot); // Returns distance in CM
-    int findFirstFreeSlot(); // Returns index of first free slot, or -1 if none
+    float getSlotDistanceCm(uint8_t slot); // Returns distance in CM (blocking read, diagnostics)
+
+    // --- Occupancy snapshot ---
+    // Kept current by refreshNext() (one slot per call) and by every scan.
+    // Returns true if distance > threshold. Reads the snapshot in O(1) unless it is
+    // older than maxAgeMs, in which case the slot is re-measured (blocking).
+    bool isSlotFree(uint8_t slot, unsigned long maxAgeMs = SLOT_SNAPSHOT_MAX_AGE_MS);
+    int findFirstFreeSlot() const; // Bit scan over the free mask, -1 if none
+    SlotMask freeMask() const { return _freeMask; }
+    unsigned long slotAgeMs(uint8_t slot) const; // Age of the slot's last reading
+    void refreshNext(); // Background task: start measuring the next slot (round-robin)
+
+    // --- Non-blocking ranging ---
+    // Starts ranging the slots in slotMask (bit i = slot i). Triggers are fired
+    // SLOT_SENSOR_STAGGER_US apart and echo edges are timestamped by the
+    // pin-change interrupt. Each echo channel measures one slot at a time
+    // (with SLOT_IO_MULTIPLEXED all slots share one channel and are measured
+    // in turn). Returns false if a scan is already running.
+    bool startScan(SlotMask slotMask = ALL_SLOTS_MASK);
+    bool isScanComplete() const { return _scanPendingMask == 0; }
+    // Result of the last completed measurement of a slot (CM, -1 if no echo)
+    float latestDistance(uint8_t slot) const;
+    // Valid readings behind the slot's decision (0..SLOT_FILTER_SIZE)
+    uint8_t confidence(uint8_t slot) const;
+    // Call from loop(): fires due triggers, handles timeouts, publishes results
+    void update();
+
+    static constexpr SlotMask ALL_SLOTS_MASK = ::ALL_SLOTS_MASK;
+
+    // Echo-time gate for SLOT_RANGE_GATED mode, integer us at compile time
+    static constexpr uint16_t ECHO_GATE_US = OccupancyFilter::LEAVE_OCCUPIED_US +
+        (uint16_t)(SLOT_GATE_MARGIN_CM * SLOT_ECHO_US_PER_CM);
 
 private:
     // Function to read distance from a single sensor
-    float readDistanceCm(uint8_t trigPin, uint8_t echoPin);
-    
-    // Optional: Array for median filter
-    // static const int MEDIAN_FILTER_SIZE = 5;
-    // float _distanceReadings[MEDIAN_FILTER_SIZE];
-    // float getMedianDistanceCm(uint8_t slot);
+    float readDistanceCm(uint8_t slot);
+    unsigned long readEchoUs(uint8_t slot);
+    unsigned long readEchoGatedUs(uint8_t slot);
+    void recordSample(uint8_t slot, unsigned long echoUs);
+    void selectSensor(uint8_t slot);
+    void fireTrigger(uint8_t channel);
+    static float echoUsToCm(unsigned long echoUs);
+    static uint8_t channelOf(uint8_t slot) { return SLOT_ECHO_CHANNELS == 1 ? 0 : slot; }
+
+    // Echo capture per trigger/echo channel, written by the pin-change interrupt
+    enum EchoPhase : uint8_t { ECHO_IDLE, ECHO_ARMED, ECHO_HIGH, ECHO_DONE };
+    static volatile uint8_t _echoPhase[SLOT_ECHO_CHANNELS];
+    static volatile uint32_t _echoRiseUs[SLOT_ECHO_CHANNELS];
+    static volatile uint32_t _echoFallUs[SLOT_ECHO_CHANNELS];
+    static void onEchoEdge(uint8_t pin, uint8_t level, uint32_t timestampUs);
+
+    // Scan bookkeeping (main loop only)
+    uint32_t _scanStartUs = 0;
+    uint32_t _triggerUs[SLOT_ECHO_CHANNELS] = {0};  // Last trigger per channel
+    int8_t _channelSlot[SLOT_ECHO_CHANNELS];              // Slot being measured, -1 = idle
+    uint32_t _channelIdleUs[SLOT_ECHO_CHANNELS] = {0}; // When the channel became idle
+    SlotMask _scanPendingMask = 0;   // Slots not yet published in this scan
+    SlotMask _triggerPendingMask = 0; // Slots whose trigger has not fired yet
+
+    // Occupancy snapshot: 9 bytes per slot
+    static const uint8_t SAMPLE_TICK_SHIFT = 4; // Sample times in 16 ms ticks (wraps after ~17 min)
+    uint16_t _latestEchoUs[NUM_SLOTS] = {0}; // 0 = no echo / timeout
+    uint16_t _sampleTick[NUM_SLOTS] = {0};   // Clock::ms() >> SAMPLE_TICK_SHIFT of each slot's last reading
+    SlotMask _freeMask = 0;    // Bit set = slot free
+    SlotMask _sampledMask = 0; // Bit set = slot measured at least once
+    uint8_t _refreshIndex = 0; // Next slot for refreshNext()
+    OccupancyFilter _filters[NUM_SLOTS]; // De-noised occupied/free decision per slot
 };
 
 #endif // SLOT_SENSOR_H
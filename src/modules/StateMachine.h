@@ -0,0 +1,196 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "Clock.h"
+
+typedef void (*FsmHandler)();
+typedef bool (*FsmGuard)();
+
+// Event 0 of every machine: the state's timeout has run out
+const uint8_t FSM_EVENT_TIMEOUT = 0;
+// Transition target of an internal transition: the action runs, the state stays
+// (no exit/enter, timeout keeps running)
+const uint8_t FSM_INTERNAL = 0xFF;
+
+// One entry per state, indexed by the state value
+struct FsmState {
+    const char* name;
+    FsmHandler enter;   // After the transition's action; may post() events
+    FsmHandler tick;    // Every update() while in the state, nullptr = event-driven only
+    FsmHandler exit;    // Before the transition's action
+    uint32_t timeoutMs; // FSM_EVENT_TIMEOUT this long after entry, 0 = none
+};
+
+// One row of the transition table. Rows must be sorted by (from, event);
+// rows with the same key are tried in order and the first whose guard passes
+// is taken.
+struct FsmTransition {
+    uint8_t from;
+    uint8_t event;
+    FsmGuard guard;    // nullptr = always
+    uint8_t to;        // FSM_INTERNAL = stay
+    FsmHandler action; // nullptr = none
+};
+
+// Compile-time table check for static_assert: states/events in range, rows sorted
+constexpr bool fsmRowValid(const FsmTransition& t, uint8_t states, uint8_t events) {
+    return t.from < states && t.event < events && (t.to < states || t.to == FSM_INTERNAL);
+}
+constexpr bool fsmTableValid(const FsmTransition* rows, uint8_t count, uint8_t states, uint8_t events,
+                             uint8_t i = 0) {
+    return i >= count ||
+           (fsmRowValid(rows[i], states, events) &&
+            (i == 0 || rows[i - 1].from * events + rows[i - 1].event <= rows[i].from * events + rows[i].event) &&
+            fsmTableValid(rows, count, states, events, i + 1));
+}
+
+// Called after every transition taken (to = FSM_INTERNAL for internal ones)
+typedef void (*FsmObserver)(uint8_t from, uint8_t event, uint8_t to);
+
+// Table-driven state machine: constexpr state and transition tables (see
+// fsmTableValid()), dispatch in O(1) through a [state][event] index built in
+// setup(). Events are handled run-to-completion: events posted by handlers
+// while one is being dispatched are queued (FSM_EVENT_QUEUE_DEPTH) and handled
+// right after it, in order. Events without a matching row are dropped.
+// Besides timeouts nothing runs between events unless a state has a tick.
+template <uint8_t STATES, uint8_t EVENTS, uint8_t ROWS>
+class StateMachine {
+public:
+    // eventNames: EVENTS names for describe()
+    void setup(const FsmState* states, const FsmTransition* rows, const char* const* eventNames,
+               uint8_t initial, FsmObserver observer = nullptr) {
+        _states = states;
+        _rows = rows;
+        _eventNames = eventNames;
+        _observer = observer;
+        memset(_first, NO_ROW, sizeof(_first));
+        for (uint8_t i = ROWS; i-- > 0;) {
+            _first[rows[i].from][rows[i].event] = i; // Lowest row of each key
+        }
+        enterState(initial);
+    }
+
+    // Call from loop(): state timeout and tick handler
+    void update() {
+        if (_timeout.expired()) {
+            _timeout.clear();
+            dispatch(FSM_EVENT_TIMEOUT);
+        }
+        if (_states[_state].tick) _states[_state].tick();
+    }
+
+    // Handle event now (queued if a handler is running). True if a row was taken;
+    // always true for a queued event.
+    bool dispatch(uint8_t event) {
+        if (_busy) return post(event);
+        _busy = true;
+        bool taken = handle(event);
+        while (_queueCount > 0) {
+            uint8_t next = _queue[_queueFirst];
+            _queueFirst = (_queueFirst + 1) % FSM_EVENT_QUEUE_DEPTH;
+            _queueCount--;
+            handle(next);
+        }
+        _busy = false;
+        return taken;
+    }
+
+    // Queue event for after the one being handled (from handlers)
+    bool post(uint8_t event) {
+        if (!_busy) return dispatch(event);
+        if (_queueCount >= FSM_EVENT_QUEUE_DEPTH) {
+            _dropped++;
+            return false;
+        }
+        _queue[(_queueFirst + _queueCount) % FSM_EVENT_QUEUE_DEPTH] = event;
+        _queueCount++;
+        return true;
+    }
+
+    uint8_t state() const { return _state; }
+    const char* stateName(uint8_t state) const { return state < STATES ? _states[state].name : "?"; }
+    const char* eventName(uint8_t event) const { return event < EVENTS ? _eventNames[event] : "?"; }
+    uint32_t timeoutRemainingMs() const { return _timeout.remainingMs(); }
+
+    // Coverage: times each row was taken, events no row took, events lost (queue full)
+    uint16_t hits(uint8_t row) const { return row < ROWS ? _hits[row] : 0; }
+    unsigned long unhandled() const { return _unhandled; }
+    uint16_t dropped() const { return _dropped; }
+
+    // Table dump, one line per call (ReportLineGenerator layout):
+    //   FSM states=<n> events=<n> rows=<n> state=<name> unhandled=<n> dropped=<n>
+    //   <row> <from> <event> -> <to>|= [guard] hits=<n>
+    //   END
+    bool describe(uint8_t index, char* line, uint8_t size) const {
+        if (index == 0) {
+            snprintf(line, size, "FSM states=%u events=%u rows=%u state=%s unhandled=%lu dropped=%u", STATES,
+                     EVENTS, ROWS, stateName(_state), _unhandled, _dropped);
+            return true;
+        }
+        uint8_t row = index - 1;
+        if (row > ROWS) return false;
+        if (row == ROWS) {
+            snprintf(line, size, "END");
+            return true;
+        }
+        const FsmTransition& t = _rows[row];
+        snprintf(line, size, "%u %s %s -> %s%s hits=%u", row, stateName(t.from), eventName(t.event),
+                 t.to == FSM_INTERNAL ? "=" : stateName(t.to), t.guard ? " [guard]" : "", _hits[row]);
+        return true;
+    }
+
+    static const uint8_t NO_ROW = 0xFF;
+    static_assert(ROWS < NO_ROW, "Too many transitions for a uint8_t row index");
+
+private:
+    const FsmState* _states = nullptr;
+    const FsmTransition* _rows = nullptr;
+    const char* const* _eventNames = nullptr;
+    FsmObserver _observer = nullptr;
+    uint8_t _first[STATES][EVENTS]; // First row of each (state, event), NO_ROW if none
+    uint8_t _state = 0;
+    Deadline _timeout;
+    bool _busy = false;
+    uint8_t _queue[FSM_EVENT_QUEUE_DEPTH];
+    uint8_t _queueFirst = 0;
+    uint8_t _queueCount = 0;
+    uint16_t _hits[ROWS] = {0};
+    unsigned long _unhandled = 0;
+    uint16_t _dropped = 0;
+
+    bool handle(uint8_t event) {
+        if (event >= EVENTS) return false;
+        for (uint8_t i = _first[_state][event]; i < ROWS; ++i) {
+            const FsmTransition& t = _rows[i];
+            if (t.from != _state || t.event != event) break;
+            if (t.guard && !t.guard()) continue;
+            if (_hits[i] != 0xFFFF) _hits[i]++;
+            uint8_t from = _state;
+            if (t.to == FSM_INTERNAL) {
+                if (t.action) t.action();
+            } else {
+                if (_states[from].exit) _states[from].exit();
+                if (t.action) t.action();
+                enterState(t.to);
+            }
+            if (_observer) _observer(from, event, t.to);
+            return true;
+        }
+        _unhandled++;
+        return false;
+    }
+
+    void enterState(uint8_t state) {
+        _state = state;
+        if (_states[state].timeoutMs) {
+            _timeout.set(_states[state].timeoutMs);
+        } else {
+            _timeout.clear();
+        }
+        if (_states[state].enter) _states[state].enter();
+    }
+};
+
+#endif // STATE_MACHINE_H
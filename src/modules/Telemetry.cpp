@@ -0,0 +1,183 @@
+#include "Telemetry.h"
+#include "BluetoothCmd.h"
+
+static void put16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    put16(out, (uint16_t)value);
+    put16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* in) {
+    return in[0] | ((uint16_t)in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+void Telemetry::setup(TelemetrySampler sampler, TelemetrySlotSampler slotSampler) {
+    _sampler = sampler;
+    _slotSampler = slotSampler;
+}
+
+void Telemetry::start(uint16_t periodMs) {
+    if (periodMs == 0) {
+        _interval.stop(); // A sample on its way still goes out whole
+        return;
+    }
+    if (periodMs < TELEMETRY_MIN_PERIOD_MS) periodMs = TELEMETRY_MIN_PERIOD_MS;
+    _interval.start(periodMs);
+    _loops = 0;
+    _loopMaxUs = 0;
+    _passTimed = false;
+}
+
+void Telemetry::update(bool replyBusy) {
+    if (!isRunning() && !isSending()) return;
+
+    // Pass time from the Clock snapshots: nothing extra to read
+    uint32_t nowUs = (uint32_t)Clock::us();
+    if (_passTimed) {
+        uint32_t passUs = nowUs - _lastPassUs;
+        if (passUs > _loopMaxUs) _loopMaxUs = passUs < 0xFFFF ? passUs : 0xFFFF;
+    }
+    if (_loops < 0xFFFF) _loops++;
+    _lastPassUs = nowUs;
+    _passTimed = true;
+
+    if (_interval.due()) {
+        if (isSending() || replyBusy) {
+            _sample.dropped++; // Port still busy: skip this one rather than queue up
+        } else {
+            uint16_t dropped = _sample.dropped;
+            uint16_t seq = _sample.seq + 1;
+            _sample = TelemetrySample();
+            _sample.seq = seq;
+            _sample.dropped = dropped;
+            _sample.ms = (uint32_t)Clock::ms();
+            _sample.loops = _loops;
+            _sample.loopMaxUs = _loopMaxUs;
+            if (_sampler) _sampler(_sample);
+            _loops = 0;
+            _loopMaxUs = 0;
+            _nextFrame = 0;
+        }
+    }
+
+    // Queue the sample's frames as the ring frees up (slot frames read the
+    // slots when queued, within a few ms of the system frame)
+    uint8_t frame[MAX_FRAME];
+    while (_nextFrame != NO_FRAME) {
+        uint8_t length = 4 + (_nextFrame == 0 ? SYSTEM_PAYLOAD : 6 + slotCount(_nextFrame) * SLOT_BYTES);
+        if (TELEMETRY_TX_RING_BYTES - _txCount < length) break;
+        buildFrame(_nextFrame, frame);
+        for (uint8_t i = 0; i < length; ++i) {
+            _tx[_txHead] = frame[i];
+            _txHead = (_txHead + 1) % TELEMETRY_TX_RING_BYTES;
+        }
+        _txCount += length;
+        _nextFrame = _nextFrame < SLOT_FRAMES ? _nextFrame + 1 : NO_FRAME;
+    }
+    drain();
+}
+
+// As much of the ring as the UART TX buffer takes right now
+void Telemetry::drain() {
+    while (_txCount > 0) {
+        int room = Serial.availableForWrite();
+        if (room <= 0) return; // Continue on the next pass
+        uint8_t tail = (_txHead + TELEMETRY_TX_RING_BYTES - _txCount) % TELEMETRY_TX_RING_BYTES;
+        uint8_t chunk = TELEMETRY_TX_RING_BYTES - tail; // Contiguous part
+        if (chunk > _txCount) chunk = _txCount;
+        if (room < chunk) chunk = room;
+        Serial.write(&_tx[tail], chunk);
+        _txCount -= chunk;
+    }
+}
+
+uint8_t Telemetry::slotCount(uint8_t index) {
+    uint8_t first = (index - 1) * TELEMETRY_SLOTS_PER_FRAME;
+    return NUM_SLOTS - first < TELEMETRY_SLOTS_PER_FRAME ? NUM_SLOTS - first : TELEMETRY_SLOTS_PER_FRAME;
+}
+
+// Frame index of the current sample into frame; its length
+uint8_t Telemetry::buildFrame(uint8_t index, uint8_t* frame) {
+    uint8_t* payload = &frame[3];
+    uint8_t length;
+    if (index == 0) {
+        put16(&payload[0], _sample.seq);
+        put32(&payload[2], _sample.ms);
+        payload[6] = _sample.entryState;
+        payload[7] = _sample.exitState;
+        payload[8] = _sample.cars;
+        payload[9] = _sample.slots;
+        put16(&payload[10], _sample.loops);
+        put16(&payload[12], _sample.loopMaxUs);
+        put16(&payload[14], _sample.lateMs);
+        put16(&payload[16], _sample.dropped);
+        length = SYSTEM_PAYLOAD;
+        frame[2] = TELEMETRY_FRAME_SYSTEM;
+    } else {
+        uint8_t first = (index - 1) * TELEMETRY_SLOTS_PER_FRAME;
+        uint8_t count = slotCount(index);
+        put16(&payload[0], _sample.seq);
+        payload[2] = first;
+        payload[3] = count;
+        payload[4] = 0;
+        payload[5] = 0;
+        length = 6;
+        for (uint8_t i = 0; i < count; ++i) {
+            TelemetrySlot slot;
+            if (_slotSampler) _slotSampler(first + i, slot);
+            if (slot.free) payload[4] |= 1 << i;
+            if (slot.parked) payload[5] |= 1 << i;
+            put16(&payload[length], slot.distanceMm);
+            put32(&payload[length + 2], slot.parkedS);
+            length += SLOT_BYTES;
+        }
+        frame[2] = TELEMETRY_FRAME_SLOTS;
+    }
+    frame[0] = BluetoothCmd::FRAME_SYNC;
+    frame[1] = 1 + length; // TYPE + payload, like the JOURNAL export
+    frame[3 + length] = BluetoothCmd::crc8(&frame[1], 2 + length);
+    return 4 + length;
+}
+
+bool Telemetry::decodeSystem(const uint8_t* payload, uint8_t length, TelemetrySample& sample) {
+    if (length != SYSTEM_PAYLOAD) return false;
+    sample.seq = get16(&payload[0]);
+    sample.ms = get32(&payload[2]);
+    sample.entryState = payload[6];
+    sample.exitState = payload[7];
+    sample.cars = payload[8];
+    sample.slots = payload[9];
+    sample.loops = get16(&payload[10]);
+    sample.loopMaxUs = get16(&payload[12]);
+    sample.lateMs = get16(&payload[14]);
+    sample.dropped = get16(&payload[16]);
+    return true;
+}
+
+bool Telemetry::decodeSlots(const uint8_t* payload, uint8_t length, uint16_t& seq, uint8_t& first,
+                            uint8_t& count, TelemetrySlot* slots, uint8_t maxSlots) {
+    if (length < 6) return false;
+    seq = get16(&payload[0]);
+    first = payload[2];
+    count = payload[3];
+    if (count > TELEMETRY_SLOTS_PER_FRAME || length != 6 + count * SLOT_BYTES || first + count > maxSlots) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        TelemetrySlot& slot = slots[first + i];
+        const uint8_t* in = &payload[6 + i * SLOT_BYTES];
+        slot.free = (payload[4] >> i) & 1;
+        slot.parked = (payload[5] >> i) & 1;
+        slot.distanceMm = get16(in);
+        slot.parkedS = get32(in + 2);
+    }
+    return true;
+}
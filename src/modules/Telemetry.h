@@ -0,0 +1,100 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "../config.h"
+#include <Arduino.h>
+#include "Clock.h"
+
+// Garage-wide part of a sample
+struct TelemetrySample {
+    uint16_t seq = 0;       // +1 per sample taken (gaps = samples lost on the way)
+    uint32_t ms = 0;        // Clock::ms() (low 32 bits)
+    uint8_t entryState = 0; // SystemState
+    uint8_t exitState = 0;  // ExitState
+    uint8_t cars = 0;       // Sessions + parked cars
+    uint8_t slots = NUM_SLOTS;
+    uint16_t loops = 0;     // loop() passes since the previous sample (saturates)
+    uint16_t loopMaxUs = 0; // Longest of them (saturates)
+    uint16_t lateMs = 0;    // Scheduler::maxLatenessMs()
+    uint16_t dropped = 0;   // Samples skipped so far (TX still busy)
+};
+
+// One slot of a sample
+struct TelemetrySlot {
+    bool free = false;       // Occupancy snapshot
+    bool parked = false;     // Parking timer running
+    uint16_t distanceMm = 0; // Latest reading, TELEMETRY_NO_ECHO if none
+    uint32_t parkedS = 0;    // Parking time of the running timer
+};
+
+const uint16_t TELEMETRY_NO_ECHO = 0xFFFF;
+
+// The sketch fills in what the module does not know about
+typedef void (*TelemetrySampler)(TelemetrySample& sample); // States, cars, lateness
+typedef void (*TelemetrySlotSampler)(uint8_t slot, TelemetrySlot& out);
+
+// Binary telemetry stream on the Bluetooth serial link ("TELEMETRY <ms>").
+// Every period one sample goes out as a batch of frames in the JOURNAL
+// layout 0xA5 LEN TYPE payload CRC8, fixed per build (multi-byte values
+// little-endian):
+//   TELEMETRY_FRAME_SYSTEM: seq u16, ms u32, entry state, exit state, cars,
+//       slots, loops u16, loop max us u16, scheduler lateness ms u16,
+//       dropped u16
+//   TELEMETRY_FRAME_SLOTS (one per TELEMETRY_SLOTS_PER_FRAME slots): seq u16,
+//       first slot, count, free bits, parked bits (bit i = slot first + i),
+//       then per slot distance mm u16 and parking time s u32
+// Frames are queued in a TX ring of TELEMETRY_TX_RING_BYTES as it frees up
+// and written only as far as Serial.availableForWrite() allows, so a sample
+// never blocks loop() at 9600 baud. A sample due while the previous one (or
+// another reply) still has the port is skipped and counted in dropped.
+class Telemetry {
+public:
+    void setup(TelemetrySampler sampler, TelemetrySlotSampler slotSampler);
+    // Sample every periodMs (at least TELEMETRY_MIN_PERIOD_MS), 0 = stop
+    void start(uint16_t periodMs);
+    bool isRunning() const { return _interval.periodMs != 0; }
+    uint16_t periodMs() const { return _interval.periodMs; }
+    // Call from loop() every pass: loop statistics, due sample, TX ring.
+    // replyBusy: another reply owns the port, no new sample is started.
+    void update(bool replyBusy);
+    // A sample is partly written: other output has to wait
+    bool isSending() const { return _txCount > 0 || _nextFrame != NO_FRAME; }
+    uint16_t dropped() const { return _sample.dropped; }
+
+    // Layout, shared with the host decoder (payload = the bytes after TYPE)
+    static bool decodeSystem(const uint8_t* payload, uint8_t length, TelemetrySample& sample);
+    // Slots of a TELEMETRY_FRAME_SLOTS payload into slots[first..]; false if malformed
+    static bool decodeSlots(const uint8_t* payload, uint8_t length, uint16_t& seq, uint8_t& first,
+                            uint8_t& count, TelemetrySlot* slots, uint8_t maxSlots);
+
+    static const uint8_t TELEMETRY_FRAME_SYSTEM = 0xC0;
+    static const uint8_t TELEMETRY_FRAME_SLOTS = 0xC1;
+    static const uint8_t SYSTEM_PAYLOAD = 18;
+    static const uint8_t SLOT_BYTES = 6;
+    static const uint8_t SLOT_FRAMES = (NUM_SLOTS + TELEMETRY_SLOTS_PER_FRAME - 1) / TELEMETRY_SLOTS_PER_FRAME;
+    static const uint8_t MAX_FRAME = 4 + 6 + TELEMETRY_SLOTS_PER_FRAME * SLOT_BYTES;
+
+private:
+    static const uint8_t NO_FRAME = 0xFF;
+
+    TelemetrySampler _sampler = nullptr;
+    TelemetrySlotSampler _slotSampler = nullptr;
+    Interval _interval;
+    TelemetrySample _sample;     // Sample going out (dropped counts on)
+    uint8_t _nextFrame = NO_FRAME; // Next frame of it to queue: 0 = system, 1.. = slot frames
+    uint8_t _tx[TELEMETRY_TX_RING_BYTES];
+    uint8_t _txHead = 0;  // Next byte to queue
+    uint8_t _txCount = 0; // Bytes waiting for the UART
+    uint16_t _loops = 0;
+    uint16_t _loopMaxUs = 0;
+    uint32_t _lastPassUs = 0;
+    bool _passTimed = false; // _lastPassUs is from the previous pass
+
+    static uint8_t slotCount(uint8_t index); // Slots in slot frame index (1..)
+    uint8_t buildFrame(uint8_t index, uint8_t* frame);
+    void drain();
+};
+
+static_assert(Telemetry::MAX_FRAME <= TELEMETRY_TX_RING_BYTES, "a telemetry frame must fit the TX ring");
+
+#endif // TELEMETRY_H
@@ -7,43 +7,45 @@ void ParkingTimer::setup(Display& display) {
 }
 */
 
-void ParkingTimer::start(uint8_t slot) {
-    if (slot < NUM_SLOTS && !isRunning[slot]) {
-        startTs[slot] = millis();
-        durationMs[slot] = 0; // Reset duration when starting
-        isRunning[slot] = true;
+void ParkingTimer::start(uint8_t slot, uint16_t session) {
+    if (slot < NUM_SLOTS && !isRunning(slot)) {
+        stampS[slot] = Clock::seconds(); // Start time; the previous duration is dropped
+        runningMask |= slotBit(slot);
+        sessionId[slot] = session;
         // Serial.print("Timer started for slot: "); Serial.println(slot);
     }
 }
 
 void ParkingTimer::stop(uint8_t slot) {
-    if (slot < NUM_SLOTS && isRunning[slot]) {
-        durationMs[slot] = millis() - startTs[slot];
-        isRunning[slot] = false;
-        // logToLCD(slot, durationMs[slot]); // Call internal log function if needed
+    if (slot < NUM_SLOTS && isRunning(slot)) {
+        stampS[slot] = Clock::seconds() - stampS[slot]; // Keep the duration from now on
+        runningMask &= ~slotBit(slot);
+        // logToLCD(slot, stampS[slot] * 1000UL); // Call internal log function if needed
         // Serial.print("Timer stopped for slot: "); Serial.print(slot);
         // Serial.print(", Duration: "); Serial.print(getDurationSeconds(slot)); Serial.println(" s");
     }
 }
 
-unsigned long ParkingTimer::getDurationSeconds(uint8_t slot) {
+uint32_t ParkingTimer::durationS(uint8_t slot) const {
+    if (slot >= NUM_SLOTS) return 0; // Invalid slot
+    // Current elapsed time if still running, final duration if stopped
+    return isRunning(slot) ? Clock::seconds() - stampS[slot] : stampS[slot];
+}
+
+void ParkingTimer::reset(uint8_t slot) {
     if (slot < NUM_SLOTS) {
-        if (isRunning[slot]) {
-            // Return current elapsed time if still running
-            return (millis() - startTs[slot]) / 1000;
-        } else {
-            // Return final duration if stopped
-            return durationMs[slot] / 1000;
-        }
+        stampS[slot] = 0;
+        runningMask &= ~slotBit(slot);
+        sessionId[slot] = 0;
     }
-    return 0; // Invalid slot
 }
 
-void ParkingTimer::reset(uint8_t slot) {
+void ParkingTimer::restore(uint8_t slot, uint16_t session, uint32_t elapsedS) {
     if (slot < NUM_SLOTS) {
-        startTs[slot] = 0;
-        durationMs[slot] = 0;
-        isRunning[slot] = false;
+        // May go below zero shortly after boot: unsigned, so durationS() is still right
+        stampS[slot] = Clock::seconds() - elapsedS;
+        runningMask |= slotBit(slot);
+        sessionId[slot] = session;
     }
 }
 
@@ -3,20 +3,29 @@
 
 #include "../config.h"
 #include <Arduino.h>
+#include "SlotMask.h"
+#include "Clock.h"
 
 // Forward declaration if Display class is used for logging inside Timer
 // class Display; 
 
+// Per-slot parking time. A running timer is also the record of a parked car
+// (runningMask), so per slot it only keeps one timestamp and the vehicle number.
+// Whole seconds on Clock::seconds(): no wrap, and the same unit as the journal.
 struct ParkingTimer {
-    unsigned long startTs[NUM_SLOTS] = {0};
-    unsigned long durationMs[NUM_SLOTS] = {0};
-    bool isRunning[NUM_SLOTS] = {false};
+    uint32_t stampS[NUM_SLOTS] = {0};       // Clock::seconds() at start while running, duration once stopped
+    uint16_t sessionId[NUM_SLOTS] = {0};    // Vehicle session the slot's timer belongs to (0 = none)
+    SlotMask runningMask = 0;               // Bit set = timer running
 
     // void setup(Display& display); // Optional: Link to display for logging
-    void start(uint8_t slot);
+    void start(uint8_t slot, uint16_t session = 0);
     void stop(uint8_t slot);
-    unsigned long getDurationSeconds(uint8_t slot);
+    unsigned long getDurationSeconds(uint8_t slot) const { return durationS(slot); }
     void reset(uint8_t slot);
+    // Running timer that started elapsedS ago (session restored after a reset)
+    void restore(uint8_t slot, uint16_t session, uint32_t elapsedS);
+    bool isRunning(uint8_t slot) const { return (runningMask & slotBit(slot)) != 0; }
+    uint32_t durationS(uint8_t slot) const;
 
 private:
     // Display* _display = nullptr; // Optional: Pointer to display instance
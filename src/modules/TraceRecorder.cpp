@@ -0,0 +1,253 @@
+#include "TraceRecorder.h"
+#include "BluetoothCmd.h"
+#include "Clock.h"
+
+// Payload bytes per TraceType (COMMAND: plus 2 per argument)
+static const uint8_t PAYLOAD_LENGTH[TRACE_TYPE_COUNT] = {2, 3, 3, 2, 3, 1, 2};
+
+static uint8_t buildFrame(uint8_t* frame, uint8_t type, uint8_t payloadLength) {
+    frame[0] = BluetoothCmd::FRAME_SYNC;
+    frame[1] = 1 + payloadLength; // TYPE + payload, like the JOURNAL export
+    frame[2] = type;
+    frame[3 + payloadLength] = BluetoothCmd::crc8(&frame[1], 2 + payloadLength);
+    return 4 + payloadLength;
+}
+
+uint8_t TraceRecorder::encode(const TraceEvent& event, uint32_t previousMs, uint8_t* out) {
+    uint32_t delta = event.ms - previousMs;
+    uint8_t length = 0;
+    if (delta < 15) {
+        out[length++] = (event.type << 4) | delta;
+    } else {
+        out[length++] = (event.type << 4) | 15;
+        delta -= 15;
+        do {
+            uint8_t low = delta & 0x7F;
+            delta >>= 7;
+            out[length++] = delta ? (low | 0x80) : low;
+        } while (delta);
+    }
+    memcpy(&out[length], event.payload, event.length);
+    return length + event.length;
+}
+
+uint8_t TraceRecorder::decode(const uint8_t* data, uint16_t length, uint32_t previousMs, TraceEvent& event) {
+    if (length == 0) return 0;
+    uint8_t type = data[0] >> 4;
+    if (type >= TRACE_TYPE_COUNT) return 0;
+    uint32_t delta = data[0] & 0x0F;
+    uint8_t used = 1;
+    if (delta == 15) {
+        uint32_t extra = 0;
+        uint8_t shift = 0;
+        uint8_t b;
+        do {
+            if (used >= length || shift > 28) return 0;
+            b = data[used++];
+            extra |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        delta += extra;
+    }
+    uint8_t payloadLength = PAYLOAD_LENGTH[type];
+    if (type == TRACE_TYPE_COMMAND) {
+        if (used + 2 > length) return 0;
+        uint8_t argc = data[used + 1];
+        if (argc > (TRACE_MAX_PAYLOAD - 2) / 2) return 0;
+        payloadLength += 2 * argc;
+    }
+    if (used + payloadLength > length) return 0;
+    event.ms = previousMs + delta;
+    event.type = type;
+    event.length = payloadLength;
+    memcpy(event.payload, &data[used], payloadLength);
+    return used + payloadLength;
+}
+
+#if TRACE_ENABLED
+
+static void put16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+uint8_t TraceRecorder::_ring[TRACE_RAM_BYTES];
+uint16_t TraceRecorder::_head = 0;
+uint16_t TraceRecorder::_count = 0;
+uint32_t TraceRecorder::_baseMs = 0;
+uint32_t TraceRecorder::_lastMs = 0;
+uint16_t TraceRecorder::_overwritten = 0;
+uint16_t TraceRecorder::_echoUs[NUM_SLOTS];
+uint16_t TraceRecorder::_exportLeft = 0;
+uint16_t TraceRecorder::_exportRecords = 0;
+uint16_t TraceRecorder::_exportBytes = 0;
+bool TraceRecorder::_exportOpen = false;
+
+void TraceRecorder::boot() {
+    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+        _echoUs[i] = NO_READING; // First reading of every slot is recorded
+    }
+    uint8_t payload[2] = {EXPORT_VERSION, NUM_SLOTS};
+    record(TRACE_TYPE_BOOT, payload, sizeof(payload));
+}
+
+void TraceRecorder::ir(uint8_t channel, uint8_t edge, uint32_t edgeUs) {
+    // Age from the start of the current ms (the record's time), not from now
+    uint32_t nowUs = (uint32_t)Clock::us();
+    int32_t intoMs = (int32_t)(nowUs - (uint32_t)Clock::ms() * 1000UL);
+    int32_t ageUs = (int32_t)(nowUs - edgeUs) - intoMs;
+    uint32_t age = ageUs > 0 ? (uint32_t)ageUs / TRACE_IR_AGE_US : 0;
+    uint8_t payload[3] = {(uint8_t)((channel << 1) | (edge & 1)), 0, 0};
+    put16(&payload[1], age < 0xFFFF ? age : 0xFFFF);
+    record(TRACE_TYPE_IR, payload, sizeof(payload));
+}
+
+void TraceRecorder::echo(uint8_t slot, uint32_t echoUs) {
+    if (slot >= NUM_SLOTS) return;
+    uint16_t us = echoUs < NO_READING ? echoUs : NO_READING - 1;
+    uint16_t last = _echoUs[slot];
+    if (last != NO_READING && (us == 0) == (last == 0)) {
+        uint16_t change = us > last ? us - last : last - us;
+        if (change < TRACE_ECHO_STEP_US) return; // Noise: the replay does not need it
+    }
+    _echoUs[slot] = us;
+    uint8_t payload[3] = {slot, 0, 0};
+    put16(&payload[1], us);
+    record(TRACE_TYPE_ECHO, payload, sizeof(payload));
+}
+
+void TraceRecorder::command(uint8_t index, const int16_t* args, uint8_t argc) {
+    if (argc > (TRACE_MAX_PAYLOAD - 2) / 2) argc = (TRACE_MAX_PAYLOAD - 2) / 2;
+    uint8_t payload[TRACE_MAX_PAYLOAD] = {index, argc};
+    for (uint8_t i = 0; i < argc; ++i) {
+        put16(&payload[2 + 2 * i], (uint16_t)args[i]);
+    }
+    record(TRACE_TYPE_COMMAND, payload, 2 + 2 * argc);
+}
+
+void TraceRecorder::state(uint8_t machine, uint8_t instance, uint8_t state) {
+    uint8_t payload[3] = {machine, instance, state};
+    record(TRACE_TYPE_STATE, payload, sizeof(payload));
+}
+
+void TraceRecorder::barrier(bool open) {
+    uint8_t payload = open ? 1 : 0;
+    record(TRACE_TYPE_BARRIER, &payload, 1);
+}
+
+void TraceRecorder::platform(int16_t angle) {
+    uint8_t payload[2];
+    put16(payload, (uint16_t)angle);
+    record(TRACE_TYPE_PLATFORM, payload, sizeof(payload));
+}
+
+void TraceRecorder::record(uint8_t type, const uint8_t* payload, uint8_t length) {
+    TraceEvent event;
+    event.ms = (uint32_t)Clock::ms();
+    event.type = type;
+    event.length = length;
+    memcpy(event.payload, payload, length);
+    uint8_t buffer[TRACE_MAX_RECORD];
+    uint8_t size = encode(event, _lastMs, buffer);
+
+    // Make room: the oldest records go (a running export loses them too)
+    TraceEvent old;
+    while (TRACE_RAM_BYTES - _count < size) {
+        uint8_t scratch[TRACE_MAX_RECORD];
+        uint8_t oldSize = peek(scratch, old);
+        if (oldSize == 0) break; // peek() emptied a corrupt ring
+        drop(oldSize, old.ms);
+        _exportLeft = _exportLeft > oldSize ? _exportLeft - oldSize : 0;
+        _overwritten++;
+    }
+
+    for (uint8_t i = 0; i < size; ++i) {
+        _ring[_head] = buffer[i];
+        _head = (_head + 1) % TRACE_RAM_BYTES;
+    }
+    _count += size;
+    _lastMs = event.ms;
+}
+
+bool TraceRecorder::pop(TraceEvent& event) {
+    uint8_t buffer[TRACE_MAX_RECORD];
+    uint8_t length = peek(buffer, event);
+    if (length == 0) return false;
+    drop(length, event.ms);
+    return true;
+}
+
+// Oldest record: raw bytes into out, decoded into event; its length (0 = none)
+uint8_t TraceRecorder::peek(uint8_t* out, TraceEvent& event) {
+    uint16_t available = _count < TRACE_MAX_RECORD ? _count : TRACE_MAX_RECORD;
+    uint16_t tail = (_head + TRACE_RAM_BYTES - _count) % TRACE_RAM_BYTES;
+    for (uint16_t i = 0; i < available; ++i) {
+        out[i] = _ring[(tail + i) % TRACE_RAM_BYTES];
+    }
+    uint8_t length = decode(out, available, _baseMs, event);
+    if (length == 0 && _count > 0) {
+        // Cannot happen unless RAM was overwritten: start over
+        _count = 0;
+        _baseMs = _lastMs;
+    }
+    return length;
+}
+
+void TraceRecorder::drop(uint8_t length, uint32_t ms) {
+    _count -= length;
+    _baseMs = ms;
+}
+
+#endif // TRACE_ENABLED
+
+uint8_t TraceRecorder::exportFrame(uint8_t index, uint8_t* frame, uint8_t size) {
+    if (size < 4 + 4 + EXPORT_BYTES) return 0;
+    uint8_t* payload = &frame[3];
+
+    if (index == 0) {
+        payload[0] = EXPORT_VERSION;
+#if TRACE_ENABLED
+        _exportLeft = _count;
+        _exportRecords = 0;
+        _exportBytes = 0;
+        _exportOpen = true;
+        put16(&payload[1], TRACE_RAM_BYTES);
+        put16(&payload[3], _count);
+        put16(&payload[5], _overwritten);
+#else
+        memset(&payload[1], 0, 6); // Nothing recorded in this build
+#endif
+        return buildFrame(frame, TRACE_FRAME_HEADER, 7);
+    }
+
+#if TRACE_ENABLED
+    if (!_exportOpen) return 0; // End frame already sent
+
+    uint32_t baseMs = _baseMs;
+    uint8_t length = 0;
+    uint8_t raw[TRACE_MAX_RECORD];
+    TraceEvent event;
+    while (_exportLeft > 0) {
+        uint8_t n = peek(raw, event);
+        if (n == 0 || length + n > EXPORT_BYTES) break;
+        memcpy(&payload[4 + length], raw, n);
+        drop(n, event.ms);
+        length += n;
+        _exportRecords++;
+        _exportBytes += n;
+        _exportLeft = _exportLeft > n ? _exportLeft - n : 0;
+    }
+    if (length > 0) {
+        memcpy(payload, &baseMs, sizeof(baseMs)); // Little-endian on AVR and host
+        return buildFrame(frame, TRACE_FRAME_RECORDS, 4 + length);
+    }
+
+    _exportOpen = false;
+    put16(&payload[0], _exportRecords);
+    put16(&payload[2], _exportBytes);
+#else
+    if (index > 1) return 0;
+    memset(payload, 0, 4);
+#endif
+    return buildFrame(frame, TRACE_FRAME_END, 4);
+}
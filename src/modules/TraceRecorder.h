@@ -0,0 +1,132 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "../config.h"
+#include <Arduino.h>
+
+// Record types (4 bits, append only: saved traces use the numbers)
+enum TraceType : uint8_t {
+    TRACE_TYPE_BOOT = 0, // setup(): trace version, NUM_SLOTS
+    TRACE_TYPE_IR,       // Debounced beam edge: channel << 1 | IrEdge, age (u16)
+    TRACE_TYPE_ECHO,     // Slot reading: slot, echo time in us (u16, 0 = no echo)
+    TRACE_TYPE_COMMAND,  // Bluetooth command: table index, argc, argc int16 args
+    TRACE_TYPE_STATE,    // State change: TraceMachine, instance, new state
+    TRACE_TYPE_BARRIER,  // Barrier command: 1 = open, 0 = close
+    TRACE_TYPE_PLATFORM, // Platform command: target angle (int16)
+    TRACE_TYPE_COUNT
+};
+
+// State machines in TRACE_TYPE_STATE records
+enum TraceMachine : uint8_t {
+    TRACE_ENTRY_LANE = 0, // Instance 0, SystemState
+    TRACE_EXIT_LANE,      // Instance 0, ExitState
+    TRACE_SESSION         // Instance = slot, SessionPhase
+};
+
+const uint8_t TRACE_MAX_PAYLOAD = 10; // COMMAND with 4 arguments
+const uint8_t TRACE_MAX_RECORD = 1 + 5 + TRACE_MAX_PAYLOAD;
+const uint8_t TRACE_IR_AGE_US = 4; // Saturates at 262 ms
+
+// One decoded record
+struct TraceEvent {
+    uint32_t ms;    // Clock::ms() (low 32 bits)
+    uint8_t type;   // TraceType
+    uint8_t length; // Payload bytes
+    uint8_t payload[TRACE_MAX_PAYLOAD];
+};
+
+// Field recorder for the inputs that drive the garage and what the firmware
+// made of them, so an incident can be replayed on the host (env
+// native_replay). Records go into a RAM ring of TRACE_RAM_BYTES; when it is
+// full the oldest ones are overwritten.
+//
+// Encoding: a header byte TYPE << 4 | DELTA, DELTA being the ms since the
+// previous record (15: a LEB128 varint with DELTA - 15 follows), then the
+// payload, fixed per type except COMMAND (2 + 2 * argc). Multi-byte values
+// are little-endian. Most records take 2..4 bytes.
+//
+// Record points are macros like the profiler's: with TRACE_ENABLED 0
+// (default) they compile to nothing and TRACE answers an empty trace.
+class TraceRecorder {
+public:
+    // TRACE reply (SerialReport frame generator, JOURNAL frame layout
+    // 0xA5 LEN TYPE payload CRC8):
+    //   TRACE_FRAME_HEADER: version, capacity (u16), bytes (u16), overwritten (u16)
+    //   TRACE_FRAME_RECORDS: baseMs (u32, what the first delta counts from),
+    //                        whole records, oldest first
+    //   TRACE_FRAME_END: records sent (u16), bytes sent (u16)
+    // Sent records leave the ring. Only what was in it at the header goes
+    // out; records added meanwhile wait for the next TRACE.
+    static uint8_t exportFrame(uint8_t index, uint8_t* frame, uint8_t size);
+
+    // Encoding, shared with the host tools.
+    // Writes event (delta from previousMs) to out, returns its length.
+    static uint8_t encode(const TraceEvent& event, uint32_t previousMs, uint8_t* out);
+    // Reads one record from data; bytes used, 0 if it is cut short or invalid
+    static uint8_t decode(const uint8_t* data, uint16_t length, uint32_t previousMs, TraceEvent& event);
+
+    static const uint8_t EXPORT_VERSION = 1;
+    static const uint8_t EXPORT_BYTES = 48; // Record bytes per frame
+    static const uint8_t TRACE_FRAME_HEADER = 0xD0;
+    static const uint8_t TRACE_FRAME_RECORDS = 0xD1;
+    static const uint8_t TRACE_FRAME_END = 0xD2;
+
+#if TRACE_ENABLED
+    static void boot();
+    // Stamped when debounced, with the age of the raw edge it stands for
+    // (units of TRACE_IR_AGE_US, from the record's ms): the replay needs
+    // beam pulses to the microsecond, a pulse just over the debounce time
+    // must not come back as a glitch.
+    static void ir(uint8_t channel, uint8_t edge, uint32_t edgeUs);
+    // Only readings that moved by TRACE_ECHO_STEP_US (or lost/found the echo)
+    static void echo(uint8_t slot, uint32_t echoUs);
+    static void command(uint8_t index, const int16_t* args, uint8_t argc);
+    static void state(uint8_t machine, uint8_t instance, uint8_t state);
+    static void barrier(bool open);
+    static void platform(int16_t angle);
+
+    // Oldest record out of the ring; false if it is empty
+    static bool pop(TraceEvent& event);
+    static uint16_t bytes() { return _count; }
+    static uint16_t overwritten() { return _overwritten; } // Records lost to a full ring
+
+private:
+    static uint8_t _ring[TRACE_RAM_BYTES];
+    static uint16_t _head;  // Next byte to write
+    static uint16_t _count; // Bytes in the ring
+    static uint32_t _baseMs; // Time the oldest record's delta counts from
+    static uint32_t _lastMs; // Time of the newest record
+    static uint16_t _overwritten;
+    static uint16_t _echoUs[NUM_SLOTS]; // Last recorded reading per slot (NO_READING: none)
+    static uint16_t _exportLeft; // Bytes of the running export not sent yet
+    static uint16_t _exportRecords;
+    static uint16_t _exportBytes;
+    static bool _exportOpen;
+
+    static const uint16_t NO_READING = 0xFFFF;
+
+    static void record(uint8_t type, const uint8_t* payload, uint8_t length);
+    static uint8_t peek(uint8_t* out, TraceEvent& event);
+    static void drop(uint8_t length, uint32_t ms);
+#endif
+};
+
+#if TRACE_ENABLED
+#define TRACE_BOOT() TraceRecorder::boot()
+#define TRACE_IR(channel, edge, edgeUs) TraceRecorder::ir(channel, edge, edgeUs)
+#define TRACE_ECHO(slot, echoUs) TraceRecorder::echo(slot, echoUs)
+#define TRACE_COMMAND(index, args, argc) TraceRecorder::command(index, args, argc)
+#define TRACE_STATE(machine, instance, value) TraceRecorder::state(machine, instance, value)
+#define TRACE_BARRIER(open) TraceRecorder::barrier(open)
+#define TRACE_PLATFORM(angle) TraceRecorder::platform(angle)
+#else
+#define TRACE_BOOT() do {} while (0)
+#define TRACE_IR(channel, edge, edgeUs) do {} while (0)
+#define TRACE_ECHO(slot, echoUs) do {} while (0)
+#define TRACE_COMMAND(index, args, argc) do {} while (0)
+#define TRACE_STATE(machine, instance, value) do {} while (0)
+#define TRACE_BARRIER(open) do {} while (0)
+#define TRACE_PLATFORM(angle) do {} while (0)
+#endif
+
+#endif // TRACE_RECORDER_H
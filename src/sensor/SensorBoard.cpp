@@ -0,0 +1,99 @@
+// Sensor board firmware (env uno_sensor): ranges every slot continuously with
+// the same SlotSensor/OccupancyFilter code as the single-board build and
+// serves the results as I2C slave at SENSOR_BOARD_ADDR (see SensorLink.h).
+// The main board no longer waits for a single echo.
+#include <Arduino.h>
+#include <Wire.h>
+#include "../config.h"
+#include "../modules/SlotSensor.h"
+#include "../modules/SensorLink.h"
+#include "../modules/FastPin.h"
+
+SlotSensor slotSensor;
+SensorRegisterFile registers;
+
+// "Changed" line to the main board: driven low to signal, released (input,
+// pulled up on the main board) otherwise
+typedef FastPin<PIN_SENSOR_IRQ_OUT> ChangeLine;
+bool changeLineLow = false;
+
+SlotMask roundMask = 0;      // Slots of the scan in flight
+bool requestedScan = false;  // Scan in flight was asked for by the main board
+unsigned long roundStartMs = 0;
+
+// --- I2C slave callbacks (interrupt context) ---
+void onReceive(int count) {
+    uint8_t data[1 + SENSOR_MASK_BYTES];
+    uint8_t length = 0;
+    while (count-- > 0 && Wire.available()) {
+        uint8_t b = Wire.read();
+        if (length < sizeof(data)) data[length++] = b;
+    }
+    registers.onWrite(data, length);
+}
+
+void onRequest() {
+    uint8_t data[32]; // Wire buffer size: the master reads at most this much per transaction
+    uint8_t length = registers.onRead(data, sizeof(data));
+    Wire.write(data, length);
+}
+
+// Copies the finished scan's slots into the register file
+void publishSlots(SlotMask slots) {
+    for (; slots; slots &= slots - 1) {
+        uint8_t slot = lowestSlot(slots);
+        float distance = slotSensor.latestDistance(slot);
+        uint16_t distanceMm = distance < 0 ? SENSOR_NO_ECHO : (uint16_t)(distance * 10);
+        bool fault = slotSensor.confidence(slot) == 0; // No valid echo in the whole filter window
+        registers.setSlot(slot, slotSensor.isSlotFree(slot), fault, distanceMm);
+    }
+}
+
+void setup() {
+    ChangeLine::input(); // Released
+    ChangeLine::low();   // Output latch low: output() then pulls the line down
+    slotSensor.setup();
+
+    Wire.begin(SENSOR_BOARD_ADDR);
+    Wire.onReceive(onReceive);
+    Wire.onRequest(onRequest);
+
+    registers.setRanging(true);
+    roundMask = ALL_SLOTS_MASK;
+    roundStartMs = millis();
+    slotSensor.startScan(roundMask);
+}
+
+void loop() {
+    slotSensor.update();
+
+    if (slotSensor.isScanComplete()) {
+        if (roundMask) {
+            publishSlots(roundMask);
+            if (requestedScan) registers.setScanDone();
+            roundMask = 0;
+            requestedScan = false;
+        }
+        // Requests from the main board go first, full rounds are paced
+        SlotMask request = registers.takeScanRequest();
+        if (request) {
+            roundMask = request;
+            requestedScan = true;
+        } else if (millis() - roundStartMs >= SENSOR_BOARD_ROUND_MS) {
+            roundMask = ALL_SLOTS_MASK;
+            roundStartMs = millis();
+        }
+        if (roundMask) slotSensor.startScan(roundMask);
+    }
+
+    // Mirror the pending change on the open-drain line
+    bool pending = registers.changePending();
+    if (pending != changeLineLow) {
+        changeLineLow = pending;
+        if (pending) {
+            ChangeLine::output();
+        } else {
+            ChangeLine::input();
+        }
+    }
+}
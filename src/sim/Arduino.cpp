@@ -0,0 +1,130 @@
+#include "Arduino.h"
+#include "SimClock.h"
+#include "SimHardware.h"
+
+HardwareSerial Serial;
+
+// ======================= Time =======================
+
+// Wrapped to 32 bits like the AVR counters, so rollover bugs show up here too
+unsigned long micros() {
+    SimClock::halCall();
+    return (uint32_t)SimClock::nowUs();
+}
+
+unsigned long millis() {
+    SimClock::halCall();
+    return (uint32_t)(SimClock::nowUs() / 1000);
+}
+
+void delay(unsigned long ms) {
+    SimClock::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    SimClock::advance(us);
+}
+
+// ======================= Digital I/O =======================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    SimClock::halCall();
+    SimGpio::setMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    SimClock::halCall();
+    SimGpio::write(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+    SimClock::halCall();
+    return SimGpio::level(pin);
+}
+
+// Busy-waits like the AVR version, but jumps straight to the next device
+// event instead of spinning: wait for the previous pulse to end, then for the
+// start, then for the end of this one. 0 on timeout.
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+    uint64_t deadline = SimClock::nowUs() + timeout;
+    uint64_t startUs = 0;
+    for (uint8_t phase = 0; phase < 3; ++phase) {
+        bool waitFor = phase == 1 ? (state != LOW) : (state == LOW); // Level that ends this phase
+        while ((SimGpio::level(pin) != LOW) != waitFor) {
+            if (SimClock::nowUs() >= deadline) return 0;
+            uint64_t next = SimClock::nextEventUs();
+            SimClock::advanceTo(next < deadline ? next : deadline);
+        }
+        if (phase == 1) startUs = SimClock::nowUs();
+    }
+    SimClock::halCall();
+    return (unsigned long)(SimClock::nowUs() - startUs);
+}
+
+// ======================= Interrupts =======================
+
+void noInterrupts() {
+    SimClock::disableInterrupts();
+}
+
+void interrupts() {
+    SimClock::enableInterrupts();
+}
+
+// ======================= Serial =======================
+
+void HardwareSerial::begin(unsigned long) {}
+
+int HardwareSerial::available() {
+    return SimSerial::available();
+}
+
+int HardwareSerial::peek() {
+    return SimSerial::peek();
+}
+
+int HardwareSerial::read() {
+    return SimSerial::read();
+}
+
+int HardwareSerial::availableForWrite() {
+    return SimSerial::availableForWrite();
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+    SimSerial::output(b);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        SimSerial::output(data[i]);
+    }
+    return length;
+}
+
+size_t HardwareSerial::print(long value, int base) {
+    if (base == 10 && value < 0) {
+        return write('-') + print((unsigned long)-value, base);
+    }
+    return print((unsigned long)value, base);
+}
+
+size_t HardwareSerial::print(unsigned long value, int base) {
+    char buf[8 * sizeof(long) + 1];
+    char* p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if (base < 2) base = 10;
+    do {
+        uint8_t digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value);
+    return write(p);
+}
+
+size_t HardwareSerial::print(double value, int digits) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+}
@@ -0,0 +1,114 @@
+#ifndef ARDUINO_SIM_H
+#define ARDUINO_SIM_H
+
+// Arduino core stand-in for the native (host) build. Same surface as the
+// parts of the AVR core the sketch and src/modules use, backed by the
+// simulator in SimClock/SimHardware: time is virtual (see SimClock.h), pins are
+// simulated devices, Serial is an in-memory port.
+//
+// Host differences to keep in mind: int is 32 bits and unsigned long 64 bits.
+// micros()/millis() still wrap at 32 bits like on the board (after 71.6 min
+// and 49.7 days of virtual time; see --uptime in SimMain.cpp), so time stamps
+// must be uint32_t, not unsigned long, for the wrap to cancel out.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+static const uint8_t A0 = 14;
+static const uint8_t A1 = 15;
+static const uint8_t A2 = 16;
+static const uint8_t A3 = 17;
+static const uint8_t A4 = 18;
+static const uint8_t A5 = 19;
+static const uint8_t NUM_DIGITAL_PINS = 20;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F(string_literal) (string_literal)
+
+// --- Time (virtual) ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// --- Digital I/O (simulated pins) ---
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+
+// --- Interrupts (masks simulated device events, see SimClock) ---
+void noInterrupts();
+void interrupts();
+
+template <class T, class L, class H>
+T constrain(T x, L low, H high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+inline bool isPrintable(char c) { return c >= 32 && c < 127; }
+
+// Minimal String: the modules only pass it through to c_str()
+class String {
+public:
+    String(const char* text = "") : _s(text ? text : "") {}
+    String(const std::string& text) : _s(text) {}
+    unsigned int length() const { return _s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    String& operator+=(const String& other) { _s += other._s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool operator==(const char* other) const { return _s == other; }
+
+private:
+    std::string _s;
+};
+
+// In-memory serial port: bytes come from SimSerial::inject(), output is
+// collected by SimSerial (and echoed to stdout if enabled)
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available();
+    int peek();
+    int read();
+    int availableForWrite();
+    void flush() {}
+
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* data, size_t length);
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write(text.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value, int base = 10);
+    size_t print(unsigned long value, int base = 10);
+    size_t print(int value, int base = 10) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = 10) { return print((unsigned long)value, base); }
+    size_t print(unsigned char value, int base = 10) { return print((unsigned long)value, base); }
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <class T> size_t println(const T& value) { return print(value) + println(); }
+    template <class T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_SIM_H
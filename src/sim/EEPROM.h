@@ -0,0 +1,22 @@
+#ifndef EEPROM_SIM_H
+#define EEPROM_SIM_H
+
+#include "Arduino.h"
+#include "SimHardware.h"
+
+// EEPROM library stand-in backed by SimEeprom (1 KB, like the ATmega328P)
+struct EEPROMClass {
+    uint8_t read(int address) { return SimEeprom::read(address); }
+    void write(int address, uint8_t value) { SimEeprom::write(address, value); }
+    void update(int address, uint8_t value) {
+        if (read(address) != value) write(address, value);
+    }
+    uint16_t length() { return SimEeprom::SIZE; }
+};
+
+static EEPROMClass EEPROM;
+
+// <avr/eeprom.h>: false while a cell write is in progress
+inline bool eeprom_is_ready() { return SimEeprom::ready(); }
+
+#endif // EEPROM_SIM_H
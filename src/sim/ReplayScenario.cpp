@@ -0,0 +1,308 @@
+#include "Arduino.h"
+#include "SimClock.h"
+#include "SimHardware.h"
+#include "SimScenario.h"
+#include "SimSketch.h"
+#include "SimTrace.h"
+#include "../modules/IrSensors.h"
+#include <time.h>
+
+#if !TRACE_ENABLED
+#error "the replay scenario needs TRACE_ENABLED=1 (env native_replay)"
+#endif
+
+// Replays a field trace against the firmware at full speed (env native_replay):
+//
+//   .pio/build/native_replay/program --replay FILE --seconds 0 [--tolerance MS] [--diffs N]
+//
+// FILE is a capture of TRACE replies from the board's serial port, or the
+// --trace file of another simulator run. The recorded inputs drive the
+// simulated devices at their recorded times: beam edges at the raw edge the
+// firmware debounced (the record's time less its age), slot readings
+// ECHO_LEAD_MS early (before the ping that measured them) and commands as
+// text lines. The firmware's own trace is drained after every loop pass, and
+// its state changes and barrier/platform commands are matched against the
+// recorded ones: same record within --tolerance ms (default 250). The run
+// stops RUN_OUT_MS after the last record, prints the first --diffs
+// mismatches (default 20) and a summary with the replay throughput, and the
+// program exits with status 1 if anything did not match.
+//
+// Times count from the BOOT record on both sides. A trace without one (the
+// ring wrapped on the board) starts at its first record on an empty garage,
+// so expect differences until the replay has caught up with the garage.
+
+static const uint32_t MAX_RECORDS = 262144;
+static const uint32_t ECHO_LEAD_MS = SLOT_ECHO_TIMEOUT_US / 1000 + 10;
+static const uint32_t RUN_OUT_MS = 2000;
+
+struct ReplayInput {
+    int64_t atUs; // From the BOOT record
+    const TraceEvent* event;
+};
+
+struct ReplayOutput {
+    int64_t atMs;
+    const TraceEvent* event;
+    bool matched;
+};
+
+static TraceEvent s_trace[MAX_RECORDS];     // Loaded trace
+static TraceEvent s_replayed[MAX_RECORDS];  // Outputs of the replay run
+static ReplayInput s_inputs[MAX_RECORDS];
+static ReplayOutput s_expected[MAX_RECORDS];
+static ReplayOutput s_actual[MAX_RECORDS];
+static uint32_t s_traceCount = 0;
+static uint32_t s_inputCount = 0;
+static uint32_t s_nextInput = 0;
+static uint32_t s_expectedCount = 0;
+static uint32_t s_actualCount = 0;
+static uint32_t s_commandsSkipped = 0;
+static int64_t s_lastMs = 0;     // Last record of the trace
+static bool s_booted = false;    // Replay firmware's BOOT record seen
+static uint32_t s_bootMs = 0;
+static uint32_t s_toleranceMs = 250;
+static uint32_t s_maxDiffs = 20;
+static double s_wallStart = 0;
+
+static double wallSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool isOutput(uint8_t type) {
+    return type == TRACE_TYPE_STATE || type == TRACE_TYPE_BARRIER || type == TRACE_TYPE_PLATFORM;
+}
+
+static bool sameOutput(const TraceEvent& a, const TraceEvent& b) {
+    return a.type == b.type && a.length == b.length && !memcmp(a.payload, b.payload, a.length);
+}
+
+static void describe(const TraceEvent& e, char* text, size_t size) {
+    switch (e.type) {
+        case TRACE_TYPE_STATE:
+            if (e.payload[0] == TRACE_ENTRY_LANE) {
+                snprintf(text, size, "entry %s", simEntryStateName(e.payload[2]));
+            } else if (e.payload[0] == TRACE_EXIT_LANE) {
+                snprintf(text, size, "exit %s", simExitStateName(e.payload[2]));
+            } else {
+                snprintf(text, size, "session slot %u phase %u", e.payload[1] + 1, e.payload[2]);
+            }
+            break;
+        case TRACE_TYPE_BARRIER:
+            snprintf(text, size, "barrier %s", e.payload[0] ? "open" : "close");
+            break;
+        case TRACE_TYPE_PLATFORM:
+            snprintf(text, size, "platform %d deg", (int16_t)(e.payload[0] | (e.payload[1] << 8)));
+            break;
+        default:
+            snprintf(text, size, "type %u", e.type);
+            break;
+    }
+}
+
+// Sort the inputs by injection time (nearly sorted already: insertion sort, stable)
+static void sortInputs() {
+    for (uint32_t i = 1; i < s_inputCount; ++i) {
+        ReplayInput input = s_inputs[i];
+        uint32_t j = i;
+        while (j > 0 && s_inputs[j - 1].atUs > input.atUs) {
+            s_inputs[j] = s_inputs[j - 1];
+            j--;
+        }
+        s_inputs[j] = input;
+    }
+}
+
+static bool loadTrace(const char* path) {
+    SimTraceInfo info;
+    if (!SimTrace::load(path, s_trace, MAX_RECORDS, s_traceCount, info)) {
+        fprintf(stderr, "cannot read %s (or more than %lu records)\n", path, (unsigned long)MAX_RECORDS);
+        return false;
+    }
+    if (info.badFrames) fprintf(stderr, "replay: %lu bad frames skipped\n", (unsigned long)info.badFrames);
+    if (info.overwritten) {
+        fprintf(stderr, "replay: %lu records were overwritten on the board\n", (unsigned long)info.overwritten);
+    }
+
+    uint32_t first = 0;
+    while (first < s_traceCount && s_trace[first].type != TRACE_TYPE_BOOT) first++;
+    if (first == s_traceCount) {
+        fprintf(stderr, "replay: no BOOT record, starting at the first record\n");
+        first = 0;
+    } else if (s_trace[first].payload[1] != NUM_SLOTS) {
+        fprintf(stderr, "replay: trace has %u slots, this build %u\n", s_trace[first].payload[1], NUM_SLOTS);
+        return false;
+    }
+    if (s_traceCount == 0) return true;
+    uint32_t originMs = s_trace[first].ms;
+
+    for (uint32_t i = first; i < s_traceCount; ++i) {
+        const TraceEvent& e = s_trace[i];
+        if (e.type == TRACE_TYPE_BOOT && i != first) {
+            fprintf(stderr, "replay: the board restarted, replaying up to the restart\n");
+            break;
+        }
+        int64_t atMs = (uint32_t)(e.ms - originMs);
+        s_lastMs = atMs;
+        if (isOutput(e.type)) {
+            s_expected[s_expectedCount++] = ReplayOutput{atMs, &e, false};
+            continue;
+        }
+        if (e.type == TRACE_TYPE_BOOT) continue;
+        int64_t leadUs = 0;
+        if (e.type == TRACE_TYPE_IR) {
+            leadUs = (int64_t)(e.payload[1] | (e.payload[2] << 8)) * TRACE_IR_AGE_US;
+        } else if (e.type == TRACE_TYPE_ECHO) {
+            leadUs = ECHO_LEAD_MS * 1000LL;
+        }
+        int64_t atUs = atMs * 1000 - leadUs;
+        s_inputs[s_inputCount++] = ReplayInput{atUs > 0 ? atUs : 0, &e};
+    }
+    sortInputs();
+    return true;
+}
+
+static void inject(const TraceEvent& e) {
+    switch (e.type) {
+        case TRACE_TYPE_IR: {
+            uint8_t channel = e.payload[0] >> 1;
+            bool triggered = (e.payload[0] & 1) == IR_TRIGGERED;
+            SimIrBeam::set(channel == IR_ENTRY ? PIN_IR_ENTRY : PIN_IR_EXIT, triggered);
+            break;
+        }
+        case TRACE_TYPE_ECHO: {
+            uint16_t echoUs = e.payload[1] | (e.payload[2] << 8);
+            SimUltrasonic::setDistanceCm(e.payload[0], echoUs ? echoUs / SLOT_ECHO_US_PER_CM : -1);
+            break;
+        }
+        case TRACE_TYPE_COMMAND: {
+            const char* name = simCommandName(e.payload[0]);
+            // TRACE would take the records this scenario compares
+            if (!name || !strcmp(name, "TRACE")) {
+                s_commandsSkipped++;
+                break;
+            }
+            char line[64];
+            int length = snprintf(line, sizeof(line), "%s", name);
+            for (uint8_t i = 0; i < e.payload[1]; ++i) {
+                int16_t arg = e.payload[2 + 2 * i] | (e.payload[3 + 2 * i] << 8);
+                length += snprintf(line + length, sizeof(line) - length, " %d", arg);
+            }
+            snprintf(line + length, sizeof(line) - length, "\n");
+            SimSerial::inject(line);
+            break;
+        }
+    }
+}
+
+// What the replayed firmware did since the last pass
+static void drainFirmwareTrace() {
+    TraceEvent e;
+    while (TraceRecorder::pop(e)) {
+        if (!s_booted) {
+            if (e.type == TRACE_TYPE_BOOT) {
+                s_booted = true;
+                s_bootMs = e.ms;
+            }
+            continue;
+        }
+        if (!isOutput(e.type) || s_actualCount >= MAX_RECORDS) continue;
+        s_replayed[s_actualCount] = e;
+        s_actual[s_actualCount] = ReplayOutput{(uint32_t)(e.ms - s_bootMs), &s_replayed[s_actualCount], false};
+        s_actualCount++;
+    }
+}
+
+bool simScenarioBegin(int argc, char** argv) {
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            s_toleranceMs = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "--diffs") && i + 1 < argc) {
+            s_maxDiffs = strtoul(argv[++i], nullptr, 0);
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: --replay FILE [--tolerance MS] [--diffs N] --seconds 0\n");
+        return false;
+    }
+    if (!loadTrace(path)) return false;
+    s_wallStart = wallSeconds();
+    return true;
+}
+
+void simScenarioStep() {
+    drainFirmwareTrace();
+    if (!s_booted) return;
+    int64_t nowUs = (int64_t)SimClock::nowUs() - (int64_t)s_bootMs * 1000;
+    while (s_nextInput < s_inputCount && s_inputs[s_nextInput].atUs <= nowUs) {
+        inject(*s_inputs[s_nextInput++].event);
+    }
+    if (nowUs / 1000 > s_lastMs + RUN_OUT_MS) simStop();
+}
+
+static void printDiff(char sign, const ReplayOutput& output, const char* what) {
+    char text[48];
+    describe(*output.event, text, sizeof(text));
+    printf("%c %10.3f %-28s %s\n", sign, output.atMs / 1e3, text, what);
+}
+
+void simScenarioEnd() {
+    drainFirmwareTrace();
+    double wall = wallSeconds() - s_wallStart;
+
+    // Each recorded output takes the first unmatched equal one within the tolerance
+    uint32_t matched = 0;
+    int64_t maxDtMs = 0;
+    int64_t sumDtMs = 0;
+    uint32_t from = 0;
+    for (uint32_t i = 0; i < s_expectedCount; ++i) {
+        ReplayOutput& expected = s_expected[i];
+        while (from < s_actualCount && s_actual[from].atMs < expected.atMs - (int64_t)s_toleranceMs) from++;
+        for (uint32_t j = from; j < s_actualCount && s_actual[j].atMs <= expected.atMs + (int64_t)s_toleranceMs; ++j) {
+            if (s_actual[j].matched || !sameOutput(*expected.event, *s_actual[j].event)) continue;
+            s_actual[j].matched = expected.matched = true;
+            int64_t dt = s_actual[j].atMs - expected.atMs;
+            if (dt < 0) dt = -dt;
+            if (dt > maxDtMs) maxDtMs = dt;
+            sumDtMs += dt;
+            matched++;
+            break;
+        }
+    }
+
+    // Mismatches in time order; replay outputs after the end of the trace do not count
+    uint32_t missing = 0;
+    uint32_t extra = 0;
+    uint32_t shown = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < s_expectedCount || j < s_actualCount) {
+        bool takeExpected = j >= s_actualCount || (i < s_expectedCount && s_expected[i].atMs <= s_actual[j].atMs);
+        if (takeExpected) {
+            const ReplayOutput& e = s_expected[i++];
+            if (e.matched) continue;
+            missing++;
+            if (shown++ < s_maxDiffs) printDiff('-', e, "recorded, not replayed");
+        } else {
+            const ReplayOutput& a = s_actual[j++];
+            if (a.matched || a.atMs > s_lastMs + (int64_t)s_toleranceMs) continue;
+            extra++;
+            if (shown++ < s_maxDiffs) printDiff('+', a, "replayed, not recorded");
+        }
+    }
+
+    double spanS = s_lastMs / 1e3;
+    printf("replay: records=%lu inputs=%lu commands_skipped=%lu expected=%lu replayed=%lu matched=%lu "
+           "missing=%lu extra=%lu max_dt_ms=%lld mean_dt_ms=%.1f span_s=%.1f wall_s=%.3f "
+           "records_per_s=%.0f speedup=%.0f result=%s\n",
+           (unsigned long)s_traceCount, (unsigned long)s_inputCount, (unsigned long)s_commandsSkipped,
+           (unsigned long)s_expectedCount, (unsigned long)s_actualCount, (unsigned long)matched,
+           (unsigned long)missing, (unsigned long)extra, (long long)maxDtMs,
+           matched ? (double)sumDtMs / matched : 0.0, spanS, wall, wall > 0 ? s_traceCount / wall : 0.0,
+           wall > 0 ? spanS / wall : 0.0, missing || extra ? "DIFF" : "MATCH");
+    if (missing || extra) simFail();
+}
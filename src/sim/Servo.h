@@ -0,0 +1,43 @@
+#ifndef SERVO_SIM_H
+#define SERVO_SIM_H
+
+#include "Arduino.h"
+#include "SimHardware.h"
+
+// Servo library stand-in: commands go to SimServo, which moves the horn at a
+// finite slew rate
+class Servo {
+public:
+    uint8_t attach(int pin, int minUs = 544, int maxUs = 2400) {
+        _index = SimServo::attach(pin);
+        _minUs = minUs;
+        _maxUs = maxUs;
+        return _index < 0 ? 0 : 1;
+    }
+    void detach() { _index = -1; }
+    bool attached() const { return _index >= 0; }
+
+    // Like the library: small values are degrees, larger ones microseconds
+    void write(int value) {
+        if (value < _minUs) {
+            value = constrain(value, 0, 180);
+            writeMicroseconds(_minUs + (long)(_maxUs - _minUs) * value / 180);
+        } else {
+            writeMicroseconds(value);
+        }
+    }
+    void writeMicroseconds(int us) {
+        _us = constrain(us, _minUs, _maxUs);
+        SimServo::command(_index, (float)(_us - _minUs) * 180 / (_maxUs - _minUs));
+    }
+    int read() const { return (int)((long)(_us - _minUs) * 180 / (_maxUs - _minUs)); }
+    int readMicroseconds() const { return _us; }
+
+private:
+    int8_t _index = -1;
+    int _minUs = 544;
+    int _maxUs = 2400;
+    int _us = 1500;
+};
+
+#endif // SERVO_SIM_H
@@ -0,0 +1,102 @@
+#include "SimClock.h"
+#include <math.h>
+
+SimClock::Event SimClock::_events[MAX_EVENTS];
+uint8_t SimClock::_eventCount = 0;
+uint32_t SimClock::_eventSeq = 0;
+uint64_t SimClock::_nowUs = 0;
+bool SimClock::_interruptsEnabled = true;
+bool SimClock::_inEvent = false;
+uint64_t SimClock::_eventsFired = 0;
+uint8_t SimClock::_maxPending = 0;
+
+uint32_t SimClock::halCallUs = 4;
+uint32_t SimClock::loopOverheadUs = 8;
+
+void SimClock::advance(uint32_t us) {
+    advanceTo(_nowUs + us);
+}
+
+void SimClock::advanceTo(uint64_t timeUs) {
+    if (_inEvent) return; // Interrupt context: time stands still
+    if (timeUs < _nowUs) timeUs = _nowUs;
+    if (_interruptsEnabled) fireDue(timeUs);
+    _nowUs = timeUs;
+}
+
+void SimClock::enableInterrupts() {
+    _interruptsEnabled = true;
+    if (!_inEvent) fireDue(_nowUs); // Deliver what arrived while masked (late, like real hardware)
+}
+
+bool SimClock::at(uint64_t timeUs, SimEvent callback, void* context, uint32_t arg) {
+    if (_eventCount >= MAX_EVENTS) return false;
+    Event& e = _events[_eventCount++];
+    e.timeUs = timeUs;
+    e.seq = _eventSeq++;
+    e.callback = callback;
+    e.context = context;
+    e.arg = arg;
+    if (_eventCount > _maxPending) _maxPending = _eventCount;
+    return true;
+}
+
+uint64_t SimClock::nextEventUs() {
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < _eventCount; ++i) {
+        if (_events[i].timeUs < next) next = _events[i].timeUs;
+    }
+    return next;
+}
+
+// Fires events up to limitUs in (time, scheduling) order. An event may
+// schedule new ones; they are picked up in the same pass if they are due.
+void SimClock::fireDue(uint64_t limitUs) {
+    while (true) {
+        int8_t found = -1;
+        for (uint8_t i = 0; i < _eventCount; ++i) {
+            const Event& e = _events[i];
+            if (e.timeUs > limitUs) continue;
+            if (found < 0 || e.timeUs < _events[found].timeUs ||
+                (e.timeUs == _events[found].timeUs && e.seq < _events[found].seq)) {
+                found = i;
+            }
+        }
+        if (found < 0) return;
+
+        Event e = _events[found];
+        _events[found] = _events[--_eventCount];
+        if (e.timeUs > _nowUs) _nowUs = e.timeUs;
+        _inEvent = true;
+        e.callback(e.context, e.arg);
+        _inEvent = false;
+        _eventsFired++;
+    }
+}
+
+uint32_t SimRandom::next() {
+    uint32_t x = _state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _state = x;
+    return x;
+}
+
+float SimRandom::uniform() {
+    return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float SimRandom::gaussian() {
+    // Box-Muller, one value per call
+    float u1 = uniform();
+    float u2 = uniform();
+    if (u1 < 1e-7f) u1 = 1e-7f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+float SimRandom::exponential(float mean) {
+    float u = uniform();
+    if (u < 1e-7f) u = 1e-7f;
+    return -mean * logf(u);
+}
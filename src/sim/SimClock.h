@@ -0,0 +1,85 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+// Device events run in "interrupt context": they may drive pins (and so call
+// pin-change handlers) but never advance the clock themselves
+typedef void (*SimEvent)(void* context, uint32_t arg);
+
+// Virtual time of the native build. Nothing waits for the wall clock: time
+// moves forward only when the firmware spends it, i.e.
+//  - every HAL call (micros(), millis(), digital I/O) costs halCallUs,
+//  - delay()/delayMicroseconds() and pulseIn() jump ahead,
+//  - the loop driver charges loopOverheadUs per loop() call.
+// Device models schedule timed events (echo edges, IR beam changes) that fire
+// in time order as the clock passes them, unless interrupts are masked, in
+// which case they fire as soon as interrupts() is called again. Same inputs,
+// same run: there is no randomness that is not seeded (SimRandom).
+class SimClock {
+public:
+    static uint64_t nowUs() { return _nowUs; }
+
+    // Move time forward, delivering due events on the way
+    static void advance(uint32_t us);
+    static void advanceTo(uint64_t timeUs);
+    // Charge one HAL call (no-op inside device events)
+    static void halCall() { advance(halCallUs); }
+
+    // Schedule callback at timeUs; false if the event table is full
+    static bool at(uint64_t timeUs, SimEvent callback, void* context = nullptr, uint32_t arg = 0);
+    static bool after(uint32_t delayUs, SimEvent callback, void* context = nullptr, uint32_t arg = 0) {
+        return at(_nowUs + delayUs, callback, context, arg);
+    }
+    // Time of the earliest pending event (UINT64_MAX if none)
+    static uint64_t nextEventUs();
+
+    static void disableInterrupts() { _interruptsEnabled = false; }
+    static void enableInterrupts();
+    static bool inEvent() { return _inEvent; }
+
+    // Cost model (tune to taste; defaults are in the range of the AVR core)
+    static uint32_t halCallUs;      // micros()/millis()/digitalRead()/digitalWrite()
+    static uint32_t loopOverheadUs; // loop() call + core housekeeping
+
+    static uint64_t eventsFired() { return _eventsFired; }
+    static uint8_t maxPendingEvents() { return _maxPending; }
+
+private:
+    static const uint8_t MAX_EVENTS = 64;
+    struct Event {
+        uint64_t timeUs;
+        uint32_t seq; // Same time: first scheduled fires first
+        SimEvent callback;
+        void* context;
+        uint32_t arg;
+    };
+
+    static Event _events[MAX_EVENTS];
+    static uint8_t _eventCount;
+    static uint32_t _eventSeq;
+    static uint64_t _nowUs;
+    static bool _interruptsEnabled;
+    static bool _inEvent;
+    static uint64_t _eventsFired;
+    static uint8_t _maxPending;
+
+    static void fireDue(uint64_t limitUs);
+};
+
+// Deterministic pseudo random numbers (xorshift32). Independent streams, so
+// scenario draws do not shift when the firmware pings the sensors more often.
+class SimRandom {
+public:
+    explicit SimRandom(uint32_t seed = 1) { this->seed(seed); }
+    void seed(uint32_t seed) { _state = seed ? seed : 1; }
+    uint32_t next();
+    float uniform(); // [0, 1)
+    float gaussian(); // Mean 0, sigma 1
+    float exponential(float mean);
+
+private:
+    uint32_t _state;
+};
+
+#endif // SIM_CLOCK_H
@@ -0,0 +1,529 @@
+#include "SimHardware.h"
+#include "../modules/PinChangeIrq.h"
+#include "../modules/SensorLink.h"
+
+SimRandom simDeviceRandom;
+
+// ======================= GPIO =======================
+
+uint8_t SimGpio::_mode[NUM_DIGITAL_PINS];
+uint8_t SimGpio::_latch[NUM_DIGITAL_PINS];
+uint8_t SimGpio::_driven[NUM_DIGITAL_PINS];
+unsigned long SimGpio::_toggles[NUM_DIGITAL_PINS];
+SimPinListener SimGpio::_listeners[NUM_DIGITAL_PINS];
+
+void SimGpio::reset() {
+    memset(_mode, INPUT, sizeof(_mode));
+    memset(_latch, LOW, sizeof(_latch));
+    memset(_driven, 0, sizeof(_driven));
+    memset(_toggles, 0, sizeof(_toggles));
+    memset(_listeners, 0, sizeof(_listeners));
+}
+
+// An external driver wins over the pin's own latch (pull-up or output)
+uint8_t SimGpio::level(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS) return LOW;
+    if (_driven[pin]) return _driven[pin] - 1;
+    return _latch[pin];
+}
+
+// Like the AVR core: INPUT clears the pull-up, INPUT_PULLUP sets it
+void SimGpio::setMode(uint8_t pin, uint8_t mode) {
+    if (pin >= NUM_DIGITAL_PINS) return;
+    uint8_t before = level(pin);
+    _mode[pin] = mode;
+    if (mode == INPUT) _latch[pin] = LOW;
+    if (mode == INPUT_PULLUP) _latch[pin] = HIGH;
+    changed(pin, before);
+}
+
+// On an input this switches the pull-up, as digitalWrite() does on the AVR
+void SimGpio::write(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_DIGITAL_PINS) return;
+    uint8_t before = SimGpio::level(pin);
+    _latch[pin] = level ? HIGH : LOW;
+    changed(pin, before);
+}
+
+void SimGpio::drive(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_DIGITAL_PINS) return;
+    uint8_t before = SimGpio::level(pin);
+    _driven[pin] = (level ? HIGH : LOW) + 1;
+    changed(pin, before);
+}
+
+void SimGpio::listen(uint8_t pin, SimPinListener listener) {
+    if (pin < NUM_DIGITAL_PINS) _listeners[pin] = listener;
+}
+
+void SimGpio::changed(uint8_t pin, uint8_t before) {
+    uint8_t now = level(pin);
+    if (now == before) return;
+    _toggles[pin]++;
+    // Only attached pins have a handler; PCINT itself fires on any change
+    PinChangeIrq::pinChanged(pin, now, (uint32_t)SimClock::nowUs());
+    if (_listeners[pin]) _listeners[pin](pin, now);
+}
+
+// ======================= HC-SR04 =======================
+
+float SimUltrasonic::_distanceCm[NUM_SLOTS];
+unsigned long SimUltrasonic::_pings[NUM_SLOTS];
+uint8_t SimUltrasonic::_echoHigh[NUM_SLOTS];
+uint8_t SimUltrasonic::_busy[NUM_SLOTS];
+float SimUltrasonic::_noiseCm = 0;
+float SimUltrasonic::_dropout = 0;
+
+static bool s_garageChanged = true; // Distances changed since SimI2c::step() last looked
+
+static const uint32_t ECHO_RISE_FLAG = 0x80; // In the event argument: rising edge
+
+void SimUltrasonic::begin() {
+    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+        _distanceCm[i] = 200; // Empty slot: the far wall
+        _pings[i] = 0;
+        _echoHigh[i] = 0;
+        _busy[i] = 0;
+    }
+#if !SLOT_SENSOR_REMOTE
+    for (uint8_t ch = 0; ch < SLOT_ECHO_CHANNELS; ++ch) {
+        SimGpio::listen(PINS_TRIG[ch], onTrigger);
+        SimGpio::drive(PINS_ECHO[ch], LOW);
+    }
+#if SLOT_IO_MULTIPLEXED
+    for (uint8_t b = 0; b < SLOT_MUX_ADDR_BITS; ++b) {
+        SimGpio::listen(PINS_SENSOR_ADDR[b], onAddress);
+    }
+#endif
+#endif
+}
+
+void SimUltrasonic::setDistanceCm(uint8_t slot, float cm) {
+    if (slot >= NUM_SLOTS) return;
+    _distanceCm[slot] = cm;
+    s_garageChanged = true;
+}
+
+void SimUltrasonic::setNoise(float sigmaCm, float dropoutRate) {
+    _noiseCm = sigmaCm;
+    _dropout = dropoutRate;
+}
+
+uint8_t SimUltrasonic::selectedSlot() {
+#if SLOT_IO_MULTIPLEXED
+    uint8_t slot = 0;
+    for (uint8_t b = 0; b < SLOT_MUX_ADDR_BITS; ++b) {
+        if (SimGpio::level(PINS_SENSOR_ADDR[b])) slot |= 1 << b;
+    }
+    return slot < NUM_SLOTS ? slot : NUM_SLOTS - 1;
+#else
+    return 0;
+#endif
+}
+
+// The HC-SR04 starts its burst on the falling edge of the trigger pulse
+void SimUltrasonic::onTrigger(uint8_t pin, uint8_t level) {
+    if (level != LOW) return;
+    uint8_t slot = 0;
+    for (uint8_t ch = 0; ch < SLOT_ECHO_CHANNELS; ++ch) {
+        if (PINS_TRIG[ch] == pin) slot = ch;
+    }
+    if (SLOT_ECHO_CHANNELS == 1) slot = selectedSlot();
+    if (_busy[slot]) return; // Still listening for the last echo
+
+    _busy[slot] = 1;
+    _pings[slot]++;
+    uint32_t widthUs = NO_ECHO_US;
+    float cm = _distanceCm[slot];
+    if (cm >= 0 && simDeviceRandom.uniform() >= _dropout) {
+        cm += _noiseCm * simDeviceRandom.gaussian();
+        if (cm < 2) cm = 2; // Minimum range
+        widthUs = (uint32_t)(cm * SLOT_ECHO_US_PER_CM);
+        if (widthUs > NO_ECHO_US) widthUs = NO_ECHO_US;
+    }
+    SimClock::after(ECHO_DELAY_US, onEchoEdge, nullptr, (widthUs << 8) | ECHO_RISE_FLAG | slot);
+}
+
+void SimUltrasonic::onEchoEdge(void*, uint32_t arg) {
+    uint8_t slot = arg & 0x7F;
+    if (arg & ECHO_RISE_FLAG) {
+        _echoHigh[slot] = 1;
+        SimClock::after(arg >> 8, onEchoEdge, nullptr, slot);
+    } else {
+        _echoHigh[slot] = 0;
+        _busy[slot] = 0;
+    }
+    updateEchoLine(SLOT_ECHO_CHANNELS == 1 ? 0 : slot);
+}
+
+// Multiplexed wiring: the shared echo line shows whichever sensor is addressed
+void SimUltrasonic::onAddress(uint8_t, uint8_t) {
+    updateEchoLine(0);
+}
+
+void SimUltrasonic::updateEchoLine(uint8_t channel) {
+    uint8_t slot = SLOT_ECHO_CHANNELS == 1 ? selectedSlot() : channel;
+    SimGpio::drive(PINS_ECHO[channel], _echoHigh[slot] ? HIGH : LOW);
+}
+
+// ======================= IR beams =======================
+
+void SimIrBeam::begin() {
+    SimGpio::drive(PIN_IR_ENTRY, LOW);
+    SimGpio::drive(PIN_IR_EXIT, LOW);
+}
+
+void SimIrBeam::set(uint8_t pin, bool vehiclePresent) {
+    SimGpio::drive(pin, vehiclePresent ? HIGH : LOW);
+}
+
+void SimIrBeam::setAfter(uint32_t delayUs, uint8_t pin, bool vehiclePresent) {
+    SimClock::after(delayUs, onEvent, nullptr, ((uint32_t)vehiclePresent << 8) | pin);
+}
+
+void SimIrBeam::bounce(uint8_t pin, uint8_t count, uint32_t flipUs) {
+    uint8_t level = SimGpio::level(pin);
+    for (uint8_t i = 0; i < count; ++i) {
+        level = !level;
+        setAfter(i * flipUs, pin, level);
+    }
+}
+
+void SimIrBeam::onEvent(void*, uint32_t arg) {
+    set(arg & 0xFF, (arg >> 8) != 0);
+}
+
+// ======================= Servos =======================
+
+SimServo::State SimServo::_servos[MAX_SERVOS];
+uint8_t SimServo::_count = 0;
+float SimServo::slewDegPerS = 600;
+
+int8_t SimServo::find(uint8_t pin) {
+    for (uint8_t i = 0; i < _count; ++i) {
+        if (_servos[i].pin == pin) return i;
+    }
+    return -1;
+}
+
+int8_t SimServo::attach(uint8_t pin) {
+    int8_t index = find(pin);
+    if (index >= 0) return index;
+    if (_count >= MAX_SERVOS) return -1;
+    State& s = _servos[_count];
+    s.pin = pin;
+    s.fromAngle = 90; // The library starts out at 1500 us
+    s.toAngle = 90;
+    s.commandUs = SimClock::nowUs();
+    return _count++;
+}
+
+void SimServo::command(int8_t index, float angle) {
+    if (index < 0 || index >= _count) return;
+    State& s = _servos[index];
+    s.fromAngle = position(s); // Retargeted mid-move: continue from where the horn is
+    s.toAngle = angle;
+    s.commandUs = SimClock::nowUs();
+}
+
+float SimServo::position(const State& s) {
+    float travel = (SimClock::nowUs() - s.commandUs) * slewDegPerS / 1e6f;
+    float distance = s.toAngle - s.fromAngle;
+    if (travel >= fabsf(distance)) return s.toAngle;
+    return distance > 0 ? s.fromAngle + travel : s.fromAngle - travel;
+}
+
+float SimServo::angle(uint8_t pin) {
+    int8_t index = find(pin);
+    return index < 0 ? -1 : position(_servos[index]);
+}
+
+float SimServo::target(uint8_t pin) {
+    int8_t index = find(pin);
+    return index < 0 ? -1 : _servos[index].toAngle;
+}
+
+// ======================= LCD =======================
+
+// PCF8574 backpack wiring (see Display.cpp)
+static const uint8_t LCD_PIN_RS = 0x01;
+static const uint8_t LCD_PIN_EN = 0x04;
+
+char SimLcd::_text[LCD_ROWS][LCD_COLS + 1];
+uint8_t SimLcd::_prev = 0;
+bool SimLcd::_fourBit = false;
+bool SimLcd::_haveHigh = false;
+uint8_t SimLcd::_high = 0;
+uint8_t SimLcd::_address = 0;
+unsigned long SimLcd::_updates = 0;
+static bool s_lcdChanged = false;
+
+void SimLcd::reset() {
+    for (uint8_t row = 0; row < LCD_ROWS; ++row) {
+        memset(_text[row], ' ', LCD_COLS);
+        _text[row][LCD_COLS] = '\0';
+    }
+    _prev = 0;
+    _fourBit = false; // Power-on: 8-bit interface
+    _haveHigh = false;
+    _address = 0;
+    _updates = 0;
+}
+
+const char* SimLcd::line(uint8_t row) {
+    return row < LCD_ROWS ? _text[row] : "";
+}
+
+// Expander bytes: the controller latches D4..D7 on the falling edge of EN
+void SimLcd::receive(const uint8_t* data, uint8_t length) {
+    s_lcdChanged = false;
+    for (uint8_t i = 0; i < length; ++i) {
+        if ((_prev & LCD_PIN_EN) && !(data[i] & LCD_PIN_EN)) {
+            latch(_prev >> 4, (_prev & LCD_PIN_RS) != 0);
+        }
+        _prev = data[i];
+    }
+    if (s_lcdChanged) _updates++;
+}
+
+void SimLcd::latch(uint8_t nibble, bool data) {
+    if (!_fourBit) {
+        execute(nibble << 4, data); // D0..D3 are not wired: they read as 0
+        return;
+    }
+    if (!_haveHigh) {
+        _high = nibble;
+        _haveHigh = true;
+        return;
+    }
+    _haveHigh = false;
+    execute((_high << 4) | nibble, data);
+}
+
+void SimLcd::execute(uint8_t value, bool data) {
+    if (data) {
+        // DDRAM: row 0 at 0x00, row 1 at 0x40 (2-line mode)
+        uint8_t row = _address >= 0x40 ? 1 : 0;
+        uint8_t col = _address - (row ? 0x40 : 0);
+        if (row < LCD_ROWS && col < LCD_COLS && _text[row][col] != (char)value) {
+            _text[row][col] = value;
+            s_lcdChanged = true;
+        }
+        _address = (_address + 1) & 0x7F;
+        return;
+    }
+    if (value & 0x80) { // Set DDRAM address
+        _address = value & 0x7F;
+    } else if ((value & 0xE0) == 0x20) { // Function set
+        bool fourBit = !(value & 0x10);
+        if (fourBit != _fourBit) _haveHigh = false;
+        _fourBit = fourBit;
+    } else if ((value & 0xFE) == 0x02) { // Return home
+        _address = 0;
+    } else if (value == 0x01) { // Clear
+        for (uint8_t row = 0; row < LCD_ROWS; ++row) {
+            for (uint8_t col = 0; col < LCD_COLS; ++col) {
+                if (_text[row][col] != ' ') s_lcdChanged = true;
+                _text[row][col] = ' ';
+            }
+        }
+        _address = 0;
+    }
+    // Entry mode, display control, shifts: Display.cpp only uses the defaults
+}
+
+// ======================= Serial =======================
+
+uint8_t SimSerial::_in[256];
+size_t SimSerial::_inLength = 0;
+size_t SimSerial::_inPos = 0;
+unsigned long SimSerial::_bytesOut = 0;
+uint64_t SimSerial::_txDoneUs = 0;
+unsigned long SimSerial::_txStalls = 0;
+uint64_t SimSerial::_txStallUs = 0;
+bool SimSerial::echo = false;
+void (*SimSerial::tap)(uint8_t b) = nullptr;
+
+void SimSerial::inject(const char* text) {
+    inject((const uint8_t*)text, strlen(text));
+}
+
+void SimSerial::inject(const uint8_t* data, size_t length) {
+    if (_inPos == _inLength) {
+        _inPos = 0;
+        _inLength = 0;
+    }
+    // Compact when the tail is full (the firmware reads everything each poll)
+    if (_inLength + length > sizeof(_in) && _inPos > 0) {
+        memmove(_in, _in + _inPos, _inLength - _inPos);
+        _inLength -= _inPos;
+        _inPos = 0;
+    }
+    for (size_t i = 0; i < length && _inLength < sizeof(_in); ++i) {
+        _in[_inLength++] = data[i];
+    }
+}
+
+int SimSerial::read() {
+    return _inPos < _inLength ? _in[_inPos++] : -1;
+}
+
+int SimSerial::peek() {
+    return _inPos < _inLength ? _in[_inPos] : -1;
+}
+
+// Bytes in the TX buffer (the one on the wire included)
+uint32_t SimSerial::txQueued() {
+    uint64_t now = SimClock::nowUs();
+    return now >= _txDoneUs ? 0 : (uint32_t)((_txDoneUs - now + BYTE_US - 1) / BYTE_US);
+}
+
+int SimSerial::availableForWrite() {
+    return TX_BUFFER - 1 - (int)txQueued(); // Like the core: one slot stays empty
+}
+
+void SimSerial::output(uint8_t b) {
+    if (txQueued() >= TX_BUFFER - 1u) {
+        // Full: wait until the oldest byte has gone out
+        uint64_t startUs = SimClock::nowUs();
+        SimClock::advanceTo(_txDoneUs - (uint64_t)(TX_BUFFER - 2) * BYTE_US);
+        _txStalls++;
+        _txStallUs += SimClock::nowUs() - startUs;
+    }
+    uint64_t now = SimClock::nowUs();
+    _txDoneUs = (_txDoneUs > now ? _txDoneUs : now) + BYTE_US;
+    _bytesOut++;
+    if (echo) putchar(b);
+    if (tap) tap(b);
+}
+
+// ======================= EEPROM =======================
+
+uint8_t SimEeprom::_data[SIZE];
+uint64_t SimEeprom::_readyUs = 0;
+unsigned long SimEeprom::_writes = 0;
+
+void SimEeprom::reset() {
+    memset(_data, 0xFF, sizeof(_data));
+    _readyUs = 0;
+}
+
+void SimEeprom::waitReady() {
+    SimClock::halCall();
+    if (!ready()) SimClock::advanceTo(_readyUs);
+}
+
+uint8_t SimEeprom::read(uint16_t address) {
+    waitReady();
+    return address < SIZE ? _data[address] : 0xFF;
+}
+
+void SimEeprom::write(uint16_t address, uint8_t value) {
+    waitReady();
+    if (address >= SIZE) return;
+    _data[address] = value;
+    _writes++;
+    _readyUs = SimClock::nowUs() + WRITE_US;
+}
+
+bool SimEeprom::load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    size_t length = fread(_data, 1, SIZE, file);
+    fclose(file);
+    return length == SIZE;
+}
+
+bool SimEeprom::save(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    size_t length = fwrite(_data, 1, SIZE, file);
+    fclose(file);
+    return length == SIZE;
+}
+
+// ======================= I2C =======================
+
+unsigned long SimI2c::_transfers = 0;
+
+#if SLOT_SENSOR_REMOTE
+static SensorBoardStandIn s_sensorBoard;
+static uint64_t s_scanSeenUs = 0; // When the pending SCAN request was first seen
+static const uint32_t SIM_BOARD_SCAN_US = 40000; // Board time to range the requested slots
+#endif
+
+void SimI2c::begin() {
+#if SLOT_SENSOR_REMOTE
+    s_sensorBoard.attach(); // Registers its own handler; the LCD shares the bus, so replace it
+#endif
+    I2cBus::setHostHandler(transfer);
+}
+
+I2cStatus SimI2c::transfer(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                           uint8_t* rx, uint8_t rxLength) {
+    _transfers++;
+    (void)rx; // Only the sensor board is ever read
+    if (address == LCD_ADDR) {
+        if (rxLength > 0) return I2C_NACK_DATA; // Write-only here
+        SimLcd::receive(tx, txLength);
+        return I2C_OK;
+    }
+#if SLOT_SENSOR_REMOTE
+    if (address == SENSOR_BOARD_ADDR) {
+        I2cStatus status = SensorBoardStandIn::transfer(address, tx, txLength, rx, rxLength);
+        SimGpio::drive(PIN_SENSOR_IRQ, s_sensorBoard.registers().changePending() ? LOW : HIGH);
+        return status;
+    }
+#endif
+    return I2C_NACK_ADDRESS;
+}
+
+// The sensor board sees the same garage as SimUltrasonic (without noise)
+void SimI2c::step() {
+#if SLOT_SENSOR_REMOTE
+    if (s_garageChanged) {
+        s_garageChanged = false;
+        for (uint8_t slot = 0; slot < NUM_SLOTS; ++slot) {
+            float cm = SimUltrasonic::distanceCm(slot);
+            if (cm < 0) {
+                s_sensorBoard.setSlot(slot, false, SENSOR_NO_ECHO, true);
+            } else {
+                s_sensorBoard.setSlot(slot, cm >= SLOT_OCCUPIED_THRESHOLD_CM, (uint16_t)(cm * 10));
+            }
+        }
+    }
+    if (s_sensorBoard.scanRequest() == 0) {
+        s_scanSeenUs = 0;
+    } else if (s_scanSeenUs == 0) {
+        s_scanSeenUs = SimClock::nowUs();
+    } else if (SimClock::nowUs() - s_scanSeenUs >= SIM_BOARD_SCAN_US) {
+        s_sensorBoard.finishScan();
+    }
+    SimGpio::drive(PIN_SENSOR_IRQ, s_sensorBoard.registers().changePending() ? LOW : HIGH);
+#endif
+}
+
+// ======================= Wiring =======================
+
+void SimHardware::begin(uint32_t seed) {
+    simDeviceRandom.seed(seed);
+    SimGpio::reset();
+    SimLcd::reset();
+    SimEeprom::reset();
+    SimUltrasonic::begin();
+    SimIrBeam::begin();
+    SimI2c::begin();
+#if SLOT_SENSOR_REMOTE
+    SimGpio::drive(PIN_SENSOR_IRQ, HIGH);
+    SimI2c::step();
+#endif
+}
+
+uint8_t SimHardware::platformSlot() {
+    float angle = platformAngle();
+    uint8_t best = 0;
+    for (uint8_t slot = 1; slot < NUM_SLOTS; ++slot) {
+        if (fabsf(platformSlotAngle(slot) - angle) < fabsf(platformSlotAngle(best) - angle)) best = slot;
+    }
+    return best;
+}
@@ -0,0 +1,219 @@
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+#include "Arduino.h"
+#include "SimClock.h"
+#include "../config.h"
+#include "../modules/I2cBus.h"
+
+// Simulated garage hardware for the native build, wired like config.h says.
+// Device models only talk to the firmware through pins, the I2C host handler
+// and the serial port, so the sketch and src/modules run unchanged.
+
+// Noise and dropouts of the device models (seeded by SimHardware::begin())
+extern SimRandom simDeviceRandom;
+
+typedef void (*SimPinListener)(uint8_t pin, uint8_t level);
+
+// Pin levels. Outputs follow digitalWrite(); inputs are driven by devices
+// (drive()), which raises the pin-change interrupt like PCINT would.
+class SimGpio {
+public:
+    static void reset();
+    static uint8_t level(uint8_t pin);
+    static uint8_t mode(uint8_t pin) { return pin < NUM_DIGITAL_PINS ? _mode[pin] : INPUT; }
+    static void setMode(uint8_t pin, uint8_t mode);
+    // Firmware side (digitalWrite)
+    static void write(uint8_t pin, uint8_t level);
+    // Device side: an external driver puts level on the pin
+    static void drive(uint8_t pin, uint8_t level);
+    // Called on every output level change of pin (one listener per pin)
+    static void listen(uint8_t pin, SimPinListener listener);
+    // Output level changes seen on a pin (buzzer beeps, LED updates)
+    static unsigned long toggles(uint8_t pin) { return pin < NUM_DIGITAL_PINS ? _toggles[pin] : 0; }
+
+private:
+    static uint8_t _mode[NUM_DIGITAL_PINS];
+    static uint8_t _latch[NUM_DIGITAL_PINS];  // Output / pull-up latch
+    static uint8_t _driven[NUM_DIGITAL_PINS]; // 0 = not driven, else level + 1
+    static unsigned long _toggles[NUM_DIGITAL_PINS];
+    static SimPinListener _listeners[NUM_DIGITAL_PINS];
+    static void changed(uint8_t pin, uint8_t before);
+};
+
+// HC-SR04 bank. A falling trigger edge pings the selected sensor (its own pin
+// pair, or the multiplexer address with SLOT_IO_MULTIPLEXED); the echo line
+// goes high after ECHO_DELAY_US for the round trip time of the slot's
+// distance, or NO_ECHO_US when nothing answers. Triggers during an echo are
+// ignored, as on the real module.
+class SimUltrasonic {
+public:
+    static void begin();
+    static void setDistanceCm(uint8_t slot, float cm); // < 0: no echo
+    static float distanceCm(uint8_t slot) { return slot < NUM_SLOTS ? _distanceCm[slot] : -1; }
+    // Gaussian noise (cm, sigma) on every reading and the share of lost echoes
+    static void setNoise(float sigmaCm, float dropoutRate);
+    static unsigned long pings(uint8_t slot) { return slot < NUM_SLOTS ? _pings[slot] : 0; }
+
+    static const uint32_t ECHO_DELAY_US = 450;
+    static const uint32_t NO_ECHO_US = 38000;
+
+private:
+    static float _distanceCm[NUM_SLOTS];
+    static unsigned long _pings[NUM_SLOTS];
+    static uint8_t _echoHigh[NUM_SLOTS];
+    static uint8_t _busy[NUM_SLOTS];
+    static float _noiseCm;
+    static float _dropout;
+
+    static void onTrigger(uint8_t pin, uint8_t level);
+    static void onAddress(uint8_t pin, uint8_t level);
+    static void onEchoEdge(void* context, uint32_t arg);
+    static uint8_t selectedSlot();
+    static void updateEchoLine(uint8_t channel);
+};
+
+// IR break beams at the gate: HIGH while a vehicle is at the sensor
+class SimIrBeam {
+public:
+    static void begin();
+    static void set(uint8_t pin, bool vehiclePresent);
+    // Same, at a later virtual time
+    static void setAfter(uint32_t delayUs, uint8_t pin, bool vehiclePresent);
+    // Contact bounce: count short flips of flipUs each, starting now
+    static void bounce(uint8_t pin, uint8_t count, uint32_t flipUs);
+
+private:
+    static void onEvent(void* context, uint32_t arg);
+};
+
+// Hobby servos: the horn follows the last command at a finite slew rate
+class SimServo {
+public:
+    static int8_t attach(uint8_t pin);
+    static void command(int8_t index, float angle);
+    // Actual horn angle now (-1 if no servo is attached to pin)
+    static float angle(uint8_t pin);
+    static float target(uint8_t pin);
+    static bool isMoving(uint8_t pin) { return angle(pin) != target(pin); }
+    static float slewDegPerS; // SG90 at 5 V: about 0.1 s per 60 degrees
+
+private:
+    static const uint8_t MAX_SERVOS = 4;
+    struct State {
+        uint8_t pin;
+        float fromAngle;
+        float toAngle;
+        uint64_t commandUs;
+    };
+    static State _servos[MAX_SERVOS];
+    static uint8_t _count;
+    static int8_t find(uint8_t pin);
+    static float position(const State& s);
+};
+
+// HD44780 behind a PCF8574 backpack, decoded from the I2C byte stream
+// (4-bit mode, DDRAM writes, clear/home; enough for Display.cpp)
+class SimLcd {
+public:
+    static void reset();
+    static void receive(const uint8_t* data, uint8_t length);
+    static const char* line(uint8_t row); // LCD_COLS characters
+    static unsigned long updates() { return _updates; } // Transfers that changed the text
+
+private:
+    static char _text[LCD_ROWS][LCD_COLS + 1];
+    static uint8_t _prev;
+    static bool _fourBit;
+    static bool _haveHigh;
+    static uint8_t _high;
+    static uint8_t _address;
+    static unsigned long _updates;
+    static void latch(uint8_t nibble, bool data);
+    static void execute(uint8_t value, bool data);
+};
+
+// Serial port contents (the HC-05 side). Output goes through a model of the
+// core's TX buffer: TX_BUFFER bytes, shifted out at SERIAL_BAUD_RATE (10 bits
+// per byte). Writing into a full buffer waits, in virtual time, like the
+// core's busy-wait, and counts as a stall.
+class SimSerial {
+public:
+    static void inject(const char* text);
+    static void inject(const uint8_t* data, size_t length);
+    static int available() { return (int)(_inLength - _inPos); }
+    static int read();
+    static int peek();
+    static void output(uint8_t b);
+    static int availableForWrite();
+    static unsigned long bytesOut() { return _bytesOut; }
+    static unsigned long txStalls() { return _txStalls; }     // Writes that had to wait
+    static uint64_t txStallUs() { return _txStallUs; }        // Time spent waiting
+    static bool echo; // Copy firmware output to stdout
+    static void (*tap)(uint8_t b); // Sees every byte as it is sent (host decoders)
+
+    static const uint8_t TX_BUFFER = 64;
+    static const uint32_t BYTE_US = (10000000UL + SERIAL_BAUD_RATE - 1) / SERIAL_BAUD_RATE;
+
+private:
+    static uint8_t _in[256];
+    static size_t _inLength;
+    static size_t _inPos;
+    static unsigned long _bytesOut;
+    static uint64_t _txDoneUs; // When the last queued byte has left
+    static unsigned long _txStalls;
+    static uint64_t _txStallUs;
+
+    static uint32_t txQueued();
+};
+
+// Data EEPROM. A cell write keeps it busy for WRITE_US; like avr-libc,
+// read() and write() first wait (in virtual time) for a write in progress.
+// The image can be loaded from and saved to a file, so one run can pick up
+// where the previous one was switched off.
+class SimEeprom {
+public:
+    static void reset(); // Erased: all 0xFF
+    static uint8_t read(uint16_t address);
+    static void write(uint16_t address, uint8_t value);
+    static bool ready() { return SimClock::nowUs() >= _readyUs; }
+    static bool load(const char* path);
+    static bool save(const char* path);
+    static unsigned long writes() { return _writes; }
+
+    static const uint16_t SIZE = 1024;
+    static const uint32_t WRITE_US = 3400; // Erase + write, datasheet typical 3.3 ms
+
+private:
+    static uint8_t _data[SIZE];
+    static uint64_t _readyUs;
+    static unsigned long _writes;
+    static void waitReady();
+};
+
+// I2C devices on the host bus: the LCD and, in remote builds, the sensor board
+class SimI2c {
+public:
+    static void begin();
+    static I2cStatus transfer(uint8_t address, const uint8_t* tx, uint8_t txLength,
+                              uint8_t* rx, uint8_t rxLength);
+    // Remote builds: copy the garage model into the sensor board registers
+    static void step();
+    static unsigned long transfers() { return _transfers; }
+
+private:
+    static unsigned long _transfers;
+};
+
+// Everything above, wired to the config.h pin map
+class SimHardware {
+public:
+    static void begin(uint32_t seed);
+    // Pin of the platform/barrier servo horn, for scenario code
+    static float barrierAngle() { return SimServo::angle(PIN_BARRIER_SERVO); }
+    static float platformAngle() { return SimServo::angle(PIN_PLATFORM_SERVO); }
+    // Slot the platform faces (nearest slot angle)
+    static uint8_t platformSlot();
+};
+
+#endif // SIM_HARDWARE_H
@@ -0,0 +1,250 @@
+#include "Arduino.h"
+#include "SimClock.h"
+#include "SimHardware.h"
+#include "SimScenario.h"
+#include "SimTrace.h"
+#include "SimTelemetry.h"
+#include <stdarg.h>
+#include <time.h>
+
+// Native entry point: runs the sketch's setup()/loop() on virtual time until
+// --seconds of garage time have passed, with a scenario moving cars around it.
+//
+//   .pio/build/native/program [--seconds N] [--seed N] [--quiet] [--serial]
+//                             [--eeprom FILE] [--uptime S] [--trace FILE]
+//                             [--telemetry MS [--telemetry-csv FILE]]
+//
+// --seconds 0 runs until the scenario calls simStop().
+// --eeprom loads the EEPROM image from FILE (if it exists) and saves it at the
+// end, so the next run boots like the garage after a power cut.
+// --uptime starts the virtual clock S seconds after power-on instead of at 0,
+// to run across the millis()/micros() wraps without simulating the weeks
+// before them (e.g. --uptime 4294900 crosses both within 70 s).
+// --trace writes the firmware's input/transition trace (TraceRecorder) to
+// FILE in the TRACE export format, for replay with env native_replay.
+// --telemetry subscribes to the TELEMETRY stream every MS and decodes it on
+// the host side of the serial port (see SimTelemetry.h).
+
+void setup();
+void loop();
+
+static bool s_quiet = false;
+static bool s_stop = false;
+static bool s_failed = false;
+
+bool simQuiet() {
+    return s_quiet;
+}
+
+void simStop() {
+    s_stop = true;
+}
+
+void simFail() {
+    s_failed = true;
+}
+
+void simLog(const char* format, ...) {
+    if (s_quiet) return;
+    printf("[%10.3f] ", SimClock::nowUs() / 1e6);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    putchar('\n');
+}
+
+// --- Default scenario: one car at a time, in and out again ---
+// The driver reacts to what the garage shows: drives through once the barrier
+// is up, parks when the LCD names the slot, leaves after a while.
+
+enum DemoStep : uint8_t {
+    DEMO_ARRIVE,    // Waiting to pull up at the entry beam
+    DEMO_AT_GATE,   // In the entry beam, waiting for the barrier
+    DEMO_ENTERING,  // Driving through the entry
+    DEMO_GUIDED,    // Inside, waiting for the LCD to name a slot
+    DEMO_PARKING,   // Driving into the slot
+    DEMO_PARKED,
+    DEMO_LEAVING,   // Slot empty again, on the way to the exit
+    DEMO_AT_EXIT,   // In the exit beam, waiting for the barrier
+    DEMO_EXITING    // Driving through the exit
+};
+
+static DemoStep s_step = DEMO_ARRIVE;
+static uint64_t s_stepUs = 0; // When the current step started
+static int s_slot = -1;
+static unsigned long s_cars = 0;
+
+static void demoGo(DemoStep step) {
+    s_step = step;
+    s_stepUs = SimClock::nowUs();
+}
+
+static uint64_t demoElapsedMs() {
+    return (SimClock::nowUs() - s_stepUs) / 1000;
+}
+
+static bool barrierUp() {
+    return SimHardware::barrierAngle() >= BARRIER_OPEN_ANGLE - 5;
+}
+
+__attribute__((weak)) bool simScenarioBegin(int, char**) {
+    demoGo(DEMO_ARRIVE);
+    return true;
+}
+
+__attribute__((weak)) void simScenarioStep() {
+    switch (s_step) {
+        case DEMO_ARRIVE:
+            if (demoElapsedMs() >= 1000) {
+                simLog("car %lu at the entry", s_cars + 1);
+                SimIrBeam::set(PIN_IR_ENTRY, true);
+                demoGo(DEMO_AT_GATE);
+            }
+            break;
+        case DEMO_AT_GATE:
+            if (barrierUp()) demoGo(DEMO_ENTERING);
+            break;
+        case DEMO_ENTERING:
+            if (demoElapsedMs() >= 1000) {
+                SimIrBeam::set(PIN_IR_ENTRY, false);
+                demoGo(DEMO_GUIDED);
+            }
+            break;
+        case DEMO_GUIDED:
+            if (sscanf(SimLcd::line(1), "<<< Slot %d >>>", &s_slot) == 1) {
+                s_slot--;
+                demoGo(DEMO_PARKING);
+            }
+            break;
+        case DEMO_PARKING:
+            if (demoElapsedMs() >= 2000) {
+                simLog("car %lu parks in slot %d (platform at %.0f deg)", s_cars + 1, s_slot + 1,
+                       SimHardware::platformAngle());
+                SimUltrasonic::setDistanceCm(s_slot, 8);
+                demoGo(DEMO_PARKED);
+            }
+            break;
+        case DEMO_PARKED:
+            if (demoElapsedMs() >= 10000) {
+                simLog("car %lu leaves slot %d", s_cars + 1, s_slot + 1);
+                SimUltrasonic::setDistanceCm(s_slot, 200);
+                demoGo(DEMO_LEAVING);
+            }
+            break;
+        case DEMO_LEAVING:
+            if (demoElapsedMs() >= 3000) {
+                SimIrBeam::set(PIN_IR_EXIT, true);
+                demoGo(DEMO_AT_EXIT);
+            }
+            break;
+        case DEMO_AT_EXIT:
+            if (barrierUp()) demoGo(DEMO_EXITING);
+            break;
+        case DEMO_EXITING:
+            if (demoElapsedMs() >= 1000) {
+                SimIrBeam::set(PIN_IR_EXIT, false);
+                s_cars++;
+                demoGo(DEMO_ARRIVE);
+            }
+            break;
+    }
+}
+
+__attribute__((weak)) void simScenarioEnd() {
+    printf("cars_through=%lu\n", s_cars);
+}
+
+// --- Driver ---
+
+static double wallSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    double seconds = 60;
+    uint32_t seed = 1;
+    const char* eepromPath = nullptr;
+    double uptime = 0;
+    const char* tracePath = nullptr;
+    unsigned long telemetryMs = 0;
+    const char* telemetryCsv = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "--quiet")) {
+            s_quiet = true;
+        } else if (!strcmp(argv[i], "--serial")) {
+            SimSerial::echo = true;
+        } else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) {
+            eepromPath = argv[++i];
+        } else if (!strcmp(argv[i], "--uptime") && i + 1 < argc) {
+            uptime = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) {
+            telemetryMs = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "--telemetry-csv") && i + 1 < argc) {
+            telemetryCsv = argv[++i];
+        }
+    }
+
+    SimClock::advanceTo((uint64_t)(uptime * 1e6)); // Nothing scheduled yet: just moves the clock
+    uint64_t bootUs = SimClock::nowUs();
+    SimHardware::begin(seed);
+    if (eepromPath) SimEeprom::load(eepromPath);
+    if (tracePath && !SimTrace::create(tracePath)) {
+        fprintf(stderr, "cannot write %s\n", tracePath);
+        return 1;
+    }
+    if (telemetryMs && !SimTelemetry::begin(telemetryMs, telemetryCsv)) {
+        fprintf(stderr, "cannot write %s\n", telemetryCsv);
+        return 1;
+    }
+    if (!simScenarioBegin(argc, argv)) return 1;
+
+    double wallStart = wallSeconds();
+    setup();
+
+    uint64_t endUs = seconds > 0 ? SimClock::nowUs() + (uint64_t)(seconds * 1e6) : UINT64_MAX;
+    unsigned long lcdUpdates = SimLcd::updates();
+    unsigned long loops = 0;
+    uint64_t loopTotalUs = 0;
+    uint64_t loopMaxUs = 0;
+    while (SimClock::nowUs() < endUs && !s_stop) {
+        uint64_t startUs = SimClock::nowUs();
+        loop();
+        uint64_t loopUs = SimClock::nowUs() - startUs;
+        loops++;
+        loopTotalUs += loopUs;
+        if (loopUs > loopMaxUs) loopMaxUs = loopUs;
+        SimClock::advance(SimClock::loopOverheadUs);
+
+        SimI2c::step();
+        simScenarioStep();
+        SimTrace::step();
+        if (SimLcd::updates() != lcdUpdates) {
+            lcdUpdates = SimLcd::updates();
+            simLog("LCD |%s|%s|", SimLcd::line(0), SimLcd::line(1));
+        }
+    }
+    double wall = wallSeconds() - wallStart;
+    double virtualSeconds = (SimClock::nowUs() - bootUs) / 1e6;
+
+    simScenarioEnd();
+    SimTrace::close();
+    SimTelemetry::end(virtualSeconds);
+    if (eepromPath && !SimEeprom::save(eepromPath)) {
+        fprintf(stderr, "cannot write %s\n", eepromPath);
+    }
+    printf("virtual_s=%.3f wall_s=%.3f speedup=%.1f loops=%lu loop_mean_us=%.1f loop_max_us=%llu "
+           "events=%llu\n",
+           virtualSeconds, wall, wall > 0 ? virtualSeconds / wall : 0.0, loops,
+           loops ? (double)loopTotalUs / loops : 0.0, (unsigned long long)loopMaxUs,
+           (unsigned long long)SimClock::eventsFired());
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef SIM_SCENARIO_H
+#define SIM_SCENARIO_H
+
+#include <stdint.h>
+
+// What happens around the firmware in a native run. SimMain.cpp has a weak
+// default (a demo car driving through the garage); link a file that defines
+// these to run something else.
+
+// Before setup(): parse scenario options (argv still holds the driver's own
+// --seconds/--seed/--quiet; ignore what you do not know). False aborts the run.
+bool simScenarioBegin(int argc, char** argv);
+// Between loop() calls: move cars, inject commands. Time only moves in loop().
+void simScenarioStep();
+// After the last loop(): print results
+void simScenarioEnd();
+
+// End the run after this step (--seconds 0 runs until a scenario calls it)
+void simStop();
+// The program exits with status 1 (e.g. a replay that did not match)
+void simFail();
+
+// Timestamped line on stdout (suppressed with --quiet)
+void simLog(const char* format, ...) __attribute__((format(printf, 1, 2)));
+bool simQuiet();
+
+#endif // SIM_SCENARIO_H
@@ -0,0 +1,118 @@
+// Native build: PlatformIO only turns .ino files into C++ for Arduino
+// frameworks, so the sketch is compiled from here. It already declares its
+// functions up front, so it builds as plain C++. The accessors below give
+// scenarios a read-only view of its globals (SimSketch.h).
+#include <Arduino.h>
+#include "../ParkingSystem.ino"
+
+#include "SimSketch.h"
+
+static const char* const EXIT_STATE_NAMES[] = {"EXIT_IDLE", "EXIT_MATCH", "EXIT_OPEN"};
+static_assert(EXIT_OPEN == 2, "Update the state names in SimSketch.cpp");
+
+uint8_t simEntryState() {
+    return entryLane.state();
+}
+
+uint8_t simEntryStateCount() {
+    return ENTRY_STATE_COUNT;
+}
+
+const char* simEntryStateName(uint8_t state) {
+    return entryLane.stateName(state);
+}
+
+uint8_t simEntryTransitionCount() {
+    return ENTRY_TRANSITION_COUNT;
+}
+
+void simEntryTransitionLabel(uint8_t row, char* label, uint8_t size) {
+    if (row >= ENTRY_TRANSITION_COUNT) {
+        snprintf(label, size, "?");
+        return;
+    }
+    const FsmTransition& t = ENTRY_TRANSITIONS[row];
+    snprintf(label, size, "%s %s -> %s", entryLane.stateName(t.from), entryLane.eventName(t.event),
+             t.to == FSM_INTERNAL ? "=" : entryLane.stateName(t.to));
+}
+
+uint16_t simEntryTransitionHits(uint8_t row) {
+    return entryLane.hits(row);
+}
+
+unsigned long simEntryUnhandled() {
+    return entryLane.unhandled();
+}
+
+uint8_t simExitState() {
+    return exitState;
+}
+
+uint8_t simExitStateCount() {
+    return sizeof(EXIT_STATE_NAMES) / sizeof(EXIT_STATE_NAMES[0]);
+}
+
+const char* simExitStateName(uint8_t state) {
+    return state < simExitStateCount() ? EXIT_STATE_NAMES[state] : "?";
+}
+
+const char* simCommandName(uint8_t index) {
+    return index < BT_COMMAND_COUNT ? BT_COMMANDS[index].name : nullptr;
+}
+
+bool simEntryIdle() {
+    return entryLane.state() == IDLE;
+}
+
+bool simEntryBarrierOpen() {
+    return entryLane.state() == BARRIER_OPEN;
+}
+
+bool simEntryFull() {
+    return entryLane.state() == FULL;
+}
+
+bool simExitIdle() {
+    return exitState == EXIT_IDLE;
+}
+
+bool simExitBarrierOpen() {
+    return exitState == EXIT_OPEN;
+}
+
+int8_t simGuidedSlot() {
+    if (platformSession < 0 || sessions[platformSession].phase != SESSION_GUIDING) return -1;
+    return sessions[platformSession].slot;
+}
+
+SlotMask simParkedMask() {
+    return parkingTimer.runningMask;
+}
+
+uint8_t simAllocationPolicy() {
+    return slotAllocator.policy();
+}
+
+unsigned long simAllocations() {
+    return slotAllocator.allocations();
+}
+
+long simAllocationSavedMs() {
+    return slotAllocator.totalSavedMs();
+}
+
+unsigned long simLostDepartures() {
+    return lostDepartures;
+}
+
+unsigned long simIrGlitches() {
+    return irSensors.glitches();
+}
+
+unsigned long simIrEventDrops() {
+    return irSensors.eventDrops();
+}
+
+unsigned long simIrOverflows() {
+    return IrSensors::overflows();
+}
@@ -0,0 +1,49 @@
+#ifndef SIM_SKETCH_H
+#define SIM_SKETCH_H
+
+#include "../config.h"
+#include "../modules/SlotMask.h"
+
+// Read-only view of the sketch's globals for scenarios. Defined in
+// SimSketch.cpp, the one file that sees the sketch, so the sketch itself
+// needs no simulator hooks.
+
+uint8_t simEntryState(); // SystemState
+uint8_t simEntryStateCount();
+const char* simEntryStateName(uint8_t state);
+uint8_t simExitState();  // ExitState
+uint8_t simExitStateCount();
+const char* simExitStateName(uint8_t state);
+
+// Entry lane transition table coverage: rows, "FROM EVENT -> TO" label, times taken
+uint8_t simEntryTransitionCount();
+void simEntryTransitionLabel(uint8_t row, char* label, uint8_t size);
+uint16_t simEntryTransitionHits(uint8_t row);
+unsigned long simEntryUnhandled(); // Events no row took (dropped by design)
+
+bool simEntryIdle();        // Entry lane in IDLE (waiting for a car)
+bool simEntryBarrierOpen(); // Entry lane in BARRIER_OPEN
+bool simEntryFull();        // Entry lane showing "Garage Full"
+bool simExitIdle();         // Exit lane in EXIT_IDLE
+bool simExitBarrierOpen();  // Exit lane in EXIT_OPEN
+// Bluetooth command table (BT_COMMANDS): name of entry index, nullptr past the end
+const char* simCommandName(uint8_t index);
+
+// Slot of the car being guided in right now (-1 if none)
+int8_t simGuidedSlot();
+// Slots with a parked car (running parking timers)
+SlotMask simParkedMask();
+
+// Slot allocator: active policy, allocations, expected alignment time saved
+// against first-free in total (SlotAllocator::totalSavedMs())
+uint8_t simAllocationPolicy();
+unsigned long simAllocations();
+long simAllocationSavedMs();
+
+// Firmware counters of lost or dropped events
+unsigned long simLostDepartures();
+unsigned long simIrGlitches();
+unsigned long simIrEventDrops();
+unsigned long simIrOverflows();
+
+#endif // SIM_SKETCH_H
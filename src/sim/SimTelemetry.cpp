@@ -0,0 +1,143 @@
+#include "SimTelemetry.h"
+#include "SimHardware.h"
+#include "../modules/BluetoothCmd.h"
+#include <stdio.h>
+
+enum RxState : uint8_t { RX_SYNC, RX_LEN, RX_BODY };
+
+static uint16_t s_periodMs = 0;
+static FILE* s_csv = nullptr;
+
+// Frame receiver
+static RxState s_rx = RX_SYNC;
+static uint8_t s_frame[1 + 255 + 1]; // LEN, TYPE + payload, CRC
+static uint16_t s_received = 0;
+
+// Sample being reassembled
+static TelemetrySample s_sample;
+static TelemetrySlot s_slots[NUM_SLOTS];
+static bool s_open = false;    // System frame seen, slots missing
+static uint16_t s_slotsSeen = 0;
+
+static unsigned long s_frames = 0;
+static unsigned long s_badFrames = 0;  // CRC or layout
+static unsigned long s_samples = 0;    // Complete samples
+static unsigned long s_incomplete = 0; // Samples with slot frames missing (not the one cut off at the end)
+static unsigned long s_seqGaps = 0;    // Samples missing between complete ones
+static uint16_t s_lastSeq = 0;
+static uint32_t s_firstMs = 0;
+static uint32_t s_lastMs = 0;
+static uint16_t s_maxLoopUs = 0;
+static uint16_t s_maxLateMs = 0;
+static uint16_t s_dropped = 0;         // Firmware's count in the last sample
+static unsigned long s_bytes = 0;      // Telemetry frame bytes
+
+bool SimTelemetry::begin(uint16_t periodMs, const char* csvPath) {
+    if (csvPath) {
+        s_csv = fopen(csvPath, "w");
+        if (!s_csv) return false;
+        fprintf(s_csv, "seq,ms,entry,exit,cars,loops,loop_max_us,late_ms,dropped");
+        for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+            fprintf(s_csv, ",s%u_free,s%u_parked,s%u_mm,s%u_parked_s", i + 1, i + 1, i + 1, i + 1);
+        }
+        fprintf(s_csv, "\n");
+    }
+    s_periodMs = periodMs;
+    SimSerial::tap = feed;
+    // Read by the first Bluetooth poll after setup(), like a phone subscribing
+    char line[24];
+    snprintf(line, sizeof(line), "TELEMETRY %u\n", periodMs);
+    SimSerial::inject(line);
+    return true;
+}
+
+void SimTelemetry::feed(uint8_t b) {
+    switch (s_rx) {
+        case RX_SYNC:
+            if (b == BluetoothCmd::FRAME_SYNC) s_rx = RX_LEN;
+            break; // Text replies in between are skipped
+        case RX_LEN:
+            s_frame[0] = b;
+            s_received = 0;
+            s_rx = b ? RX_BODY : RX_SYNC;
+            break;
+        case RX_BODY: {
+            s_frame[1 + s_received++] = b;
+            uint8_t length = s_frame[0];
+            if (s_received < length + 1u) break;
+            s_rx = RX_SYNC;
+            if (BluetoothCmd::crc8(s_frame, 1 + length) != s_frame[1 + length]) {
+                s_badFrames++;
+                break;
+            }
+            frame(s_frame[1], &s_frame[2], length - 1);
+            break;
+        }
+    }
+}
+
+void SimTelemetry::frame(uint8_t type, const uint8_t* payload, uint8_t length) {
+    if (type == Telemetry::TELEMETRY_FRAME_SYSTEM) {
+        s_frames++;
+        s_bytes += 4 + length;
+        if (s_open) s_incomplete++;
+        s_open = Telemetry::decodeSystem(payload, length, s_sample) && s_sample.slots == NUM_SLOTS;
+        if (!s_open) s_badFrames++;
+        s_slotsSeen = 0;
+    } else if (type == Telemetry::TELEMETRY_FRAME_SLOTS) {
+        s_frames++;
+        s_bytes += 4 + length;
+        uint16_t seq;
+        uint8_t first, count;
+        if (!Telemetry::decodeSlots(payload, length, seq, first, count, s_slots, NUM_SLOTS)) {
+            s_badFrames++;
+            return;
+        }
+        if (!s_open || seq != s_sample.seq || first != s_slotsSeen) return; // Stray: sample counted incomplete
+        s_slotsSeen += count;
+        if (s_slotsSeen == NUM_SLOTS) complete();
+    }
+    // Other frames (JOURNAL, TRACE exports) are not ours
+}
+
+void SimTelemetry::complete() {
+    s_open = false;
+    if (s_samples == 0) {
+        s_firstMs = s_sample.ms;
+    } else {
+        s_seqGaps += (uint16_t)(s_sample.seq - s_lastSeq - 1);
+    }
+    s_samples++;
+    s_lastSeq = s_sample.seq;
+    s_lastMs = s_sample.ms;
+    s_dropped = s_sample.dropped;
+    if (s_sample.loopMaxUs > s_maxLoopUs) s_maxLoopUs = s_sample.loopMaxUs;
+    if (s_sample.lateMs > s_maxLateMs) s_maxLateMs = s_sample.lateMs;
+    if (!s_csv) return;
+    fprintf(s_csv, "%u,%lu,%u,%u,%u,%u,%u,%u,%u", s_sample.seq, (unsigned long)s_sample.ms, s_sample.entryState,
+            s_sample.exitState, s_sample.cars, s_sample.loops, s_sample.loopMaxUs, s_sample.lateMs,
+            s_sample.dropped);
+    for (uint8_t i = 0; i < NUM_SLOTS; ++i) {
+        const TelemetrySlot& slot = s_slots[i];
+        if (slot.distanceMm == TELEMETRY_NO_ECHO) {
+            fprintf(s_csv, ",%d,%d,,%lu", slot.free, slot.parked, (unsigned long)slot.parkedS);
+        } else {
+            fprintf(s_csv, ",%d,%d,%u,%lu", slot.free, slot.parked, slot.distanceMm, (unsigned long)slot.parkedS);
+        }
+    }
+    fprintf(s_csv, "\n");
+}
+
+void SimTelemetry::end(double virtualSeconds) {
+    if (!SimSerial::tap) return;
+    SimSerial::tap = nullptr;
+    if (s_csv) fclose(s_csv);
+    double spanS = s_samples > 1 ? (uint32_t)(s_lastMs - s_firstMs) / 1e3 : 0;
+    printf("telemetry: period_ms=%u samples=%lu incomplete=%lu bad_frames=%lu seq_gaps=%lu dropped=%u "
+           "interval_ms=%.1f bytes=%lu line_use=%.1f%% max_loop_us=%u max_late_ms=%u tx_stalls=%lu "
+           "tx_stall_ms=%.1f\n",
+           s_periodMs, s_samples, s_incomplete, s_badFrames, s_seqGaps, s_dropped,
+           s_samples > 1 ? spanS * 1e3 / (s_samples - 1) : 0.0, s_bytes,
+           virtualSeconds > 0 ? 100.0 * s_bytes * SimSerial::BYTE_US / (virtualSeconds * 1e6) : 0.0, s_maxLoopUs,
+           s_maxLateMs, SimSerial::txStalls(), SimSerial::txStallUs() / 1e3);
+}
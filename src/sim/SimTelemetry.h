@@ -0,0 +1,23 @@
+#ifndef SIM_TELEMETRY_H
+#define SIM_TELEMETRY_H
+
+#include <stdint.h>
+#include "../modules/Telemetry.h"
+
+// Host decoder for the TELEMETRY stream (--telemetry MS): subscribes the
+// firmware before setup(), reads every byte it sends (SimSerial::tap),
+// reassembles the samples from their frames and checks them: CRC, layout,
+// all slots present, no sequence gaps. end() prints one summary line, and
+// --telemetry-csv FILE gets one row per complete sample.
+class SimTelemetry {
+public:
+    static bool begin(uint16_t periodMs, const char* csvPath);
+    static void end(double virtualSeconds);
+
+private:
+    static void feed(uint8_t b);
+    static void frame(uint8_t type, const uint8_t* payload, uint8_t length);
+    static void complete();
+};
+
+#endif // SIM_TELEMETRY_H
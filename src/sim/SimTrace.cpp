@@ -0,0 +1,87 @@
+#include "SimTrace.h"
+#include "../modules/BluetoothCmd.h"
+#include <stdio.h>
+
+static FILE* s_file = nullptr;
+
+bool SimTrace::create(const char* path) {
+    s_file = fopen(path, "wb");
+    return s_file != nullptr;
+}
+
+void SimTrace::step() {
+#if TRACE_ENABLED
+    if (s_file && TraceRecorder::bytes() >= TRACE_RAM_BYTES / 2) exportAll();
+#endif
+}
+
+void SimTrace::close() {
+    if (!s_file) return;
+    exportAll();
+    fclose(s_file);
+    s_file = nullptr;
+}
+
+// One TRACE reply, as the board would send it
+void SimTrace::exportAll() {
+    uint8_t frame[64];
+    uint8_t length;
+    for (uint8_t i = 0; (length = TraceRecorder::exportFrame(i, frame, sizeof(frame))) != 0; ++i) {
+        fwrite(frame, 1, length, s_file);
+    }
+}
+
+bool SimTrace::load(const char* path, TraceEvent* events, uint32_t maxEvents, uint32_t& count,
+                    SimTraceInfo& info) {
+    count = 0;
+    info = SimTraceInfo();
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    // Frame: 0xA5 LEN TYPE payload CRC8 (CRC over LEN, TYPE and payload)
+    uint8_t frame[2 + 255 + 1];
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (c != BluetoothCmd::FRAME_SYNC) continue;
+        int len = fgetc(f);
+        if (len == EOF) break;
+        frame[0] = (uint8_t)len;
+        if (len == 0 || fread(&frame[1], 1, len + 1, f) != (size_t)len + 1) {
+            info.badFrames++;
+            continue;
+        }
+        if (BluetoothCmd::crc8(frame, 1 + len) != frame[1 + len]) {
+            info.badFrames++;
+            continue; // Resynchronises on the next 0xA5
+        }
+        uint8_t type = frame[1];
+        const uint8_t* payload = &frame[2];
+        uint8_t payloadLength = len - 1;
+        if (type == TraceRecorder::TRACE_FRAME_HEADER && payloadLength >= 7) {
+            info.exports++;
+            info.overwritten += payload[5] | (payload[6] << 8);
+        } else if (type == TraceRecorder::TRACE_FRAME_RECORDS && payloadLength >= 4) {
+            uint32_t ms = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) |
+                          ((uint32_t)payload[3] << 24);
+            uint16_t pos = 4;
+            while (pos < payloadLength) {
+                if (count >= maxEvents) {
+                    fclose(f);
+                    return false;
+                }
+                uint8_t used = TraceRecorder::decode(&payload[pos], payloadLength - pos, ms, events[count]);
+                if (used == 0) {
+                    info.badFrames++;
+                    break;
+                }
+                ms = events[count++].ms;
+                pos += used;
+            }
+        } else if (type != TraceRecorder::TRACE_FRAME_END) {
+            continue; // Some other reply (JOURNAL export)
+        }
+        info.frames++;
+    }
+    fclose(f);
+    return true;
+}
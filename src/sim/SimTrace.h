@@ -0,0 +1,35 @@
+#ifndef SIM_TRACE_H
+#define SIM_TRACE_H
+
+#include <stdint.h>
+#include "../modules/TraceRecorder.h"
+
+// Trace files on the host. A trace file is the byte stream of TRACE replies
+// (TraceRecorder::exportFrame()), i.e. what a capture of the board's serial
+// port holds; text and anything else between frames is skipped.
+struct SimTraceInfo {
+    uint32_t frames = 0;      // Valid trace frames
+    uint32_t badFrames = 0;   // Frames with a bad CRC or length
+    uint32_t exports = 0;     // TRACE replies (header frames)
+    uint32_t overwritten = 0; // Records the board lost to a full ring (sum over exports)
+};
+
+class SimTrace {
+public:
+    // --trace: write the firmware's trace to path as it fills up
+    static bool create(const char* path);
+    // After every loop pass: export once the ring is half full
+    static void step();
+    // Export the rest and close the file
+    static void close();
+
+    // Decode every record of a trace file, oldest first. False if the file
+    // cannot be read or holds more than maxEvents records.
+    static bool load(const char* path, TraceEvent* events, uint32_t maxEvents, uint32_t& count,
+                     SimTraceInfo& info);
+
+private:
+    static void exportAll();
+};
+
+#endif // SIM_TRACE_H
@@ -0,0 +1,595 @@
+#include "Arduino.h"
+#include "SimClock.h"
+#include "SimHardware.h"
+#include "SimScenario.h"
+#include "SimSketch.h"
+#include "../modules/SlotAllocator.h"
+
+// Load generator for the native build (env native_traffic): cars arrive as a
+// Poisson stream, queue at the entry, get guided to a slot, stay for a drawn
+// dwell time and leave through the exit queue. Every driver reacts only to
+// what the garage shows (barrier up, guided slot, "Garage Full"), so the
+// numbers measure the firmware, not the scenario.
+//
+// Options (besides --seconds/--seed/--quiet):
+//   --rate N          arrivals per hour (default 60)
+//   --dwell SPEC      exp:MEAN | fixed:S | uniform:MIN:MAX | normal:MEAN:SD, seconds
+//                     (default exp:600)
+//   --prefill N       slots 0..N-1 hold cars the firmware does not know (N = NUM_SLOTS: full garage)
+//   --noise CM        gaussian noise on every ultrasonic reading (sigma)
+//   --dropout P       share of lost echoes (0..1)
+//   --bounce N        IR beam bounces per transition
+//   --policy N        slot allocation policy, sent as "POLICY N" at the start
+//                     (default: SLOT_ALLOCATION_POLICY)
+//   --out PREFIX      write PREFIX.json (summary) and PREFIX.csv (one row per car)
+//
+// Missed events: the driver re-triggers a beam the firmware did not react to
+// within MISSED_TIMEOUT_US; a car parked or gone from its slot that the
+// firmware does not notice within the same time counts once per car.
+
+static const uint8_t MAX_VEHICLES = 64;        // Cars in the system at once
+static const uint16_t MAX_SAMPLES = 16384;     // Wait samples kept for percentiles
+static const uint32_t TICK_US = 1000;          // Driver reaction granularity
+static const uint32_t HEADWAY_US = 2000000;    // Next car pulls up this long after the beam cleared
+static const uint32_t PASS_US = 1500000;       // Driving through a barrier
+static const uint32_t PARK_US = 2000000;       // Driving into the slot
+static const uint32_t TO_EXIT_US = 3000000;    // Slot to exit beam
+static const uint32_t MISSED_TIMEOUT_US = 5000000;
+static const uint32_t RETRIGGER_US = 500000;   // Back off and pull up again
+static const float PARKED_CM = 8;
+static const float EMPTY_CM = 200;
+static const uint32_t MIN_DWELL_MS = 1000;
+
+enum VehicleStep : uint8_t {
+    V_FREE = 0,
+    V_ENTRY_QUEUE, // Waiting behind the entry beam
+    V_AT_ENTRY,    // In the entry beam, waiting for the barrier
+    V_ENTERING,    // Driving through the entry
+    V_WAIT_GUIDE,  // Inside, waiting for the platform to name a slot
+    V_PARKING,     // Driving into the guided slot
+    V_PARKED,
+    V_TO_EXIT,     // Left the slot, driving to the exit
+    V_EXIT_QUEUE,  // Waiting behind the exit beam
+    V_AT_EXIT,     // In the exit beam, waiting for the barrier
+    V_EXITING      // Driving through the exit
+};
+
+struct Vehicle {
+    VehicleStep step;
+    int8_t slot;
+    bool missedPark;
+    bool missedDeparture;
+    uint32_t id;
+    uint32_t dwellMs;
+    uint32_t passSeq;  // Order of passing the entry (the platform serves in this order)
+    uint64_t stepUs;   // Start of the current step
+    uint64_t arriveUs;
+    uint64_t gateUs;   // Pulled into the entry beam
+    uint64_t entryOpenUs;
+    uint64_t parkedUs;
+    uint64_t leftSlotUs;
+    uint64_t exitGateUs;
+    uint64_t exitOpenUs;
+};
+
+// Wait samples in ms
+struct Samples {
+    uint32_t values[MAX_SAMPLES];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t max;
+};
+
+enum DwellKind : uint8_t { DWELL_EXP, DWELL_FIXED, DWELL_UNIFORM, DWELL_NORMAL };
+
+static Vehicle s_vehicles[MAX_VEHICLES];
+static SimRandom s_traffic; // Arrivals and dwell times only: unaffected by sensor pings
+static uint64_t s_nextArrivalUs = 0;
+static uint64_t s_nextTickUs = 0;
+static int8_t s_entryBeam = -1; // Vehicle in the beam
+static int8_t s_exitBeam = -1;
+static uint64_t s_entryFreeUs = 0; // Beam cleared at
+static uint64_t s_exitFreeUs = 0;
+static uint32_t s_nextId = 1;
+static uint32_t s_passSeq = 0;
+static uint64_t s_startUs = 0;
+
+// Options
+static float s_ratePerHour = 60;
+static DwellKind s_dwellKind = DWELL_EXP;
+static float s_dwellA = 600; // Mean / fixed / min
+static float s_dwellB = 0;   // Max / SD
+static char s_dwellSpec[32] = "exp:600";
+static uint8_t s_prefill = 0;
+static float s_noiseCm = 0;
+static float s_dropout = 0;
+static uint8_t s_bounce = 0;
+static int s_policy = -1; // -1: firmware default
+static const char* s_outPrefix = nullptr;
+static uint32_t s_seed = 1;
+static double s_seconds = 60;
+
+// Results
+static unsigned long s_arrivals = 0;
+static unsigned long s_turnedAway = 0;  // No room in the scenario's vehicle pool
+static unsigned long s_admitted = 0;
+static unsigned long s_completed = 0;
+static unsigned long s_rejectedFull = 0;
+static unsigned long s_missedEntry = 0;
+static unsigned long s_missedExit = 0;
+static unsigned long s_missedPark = 0;
+static unsigned long s_missedDeparture = 0;
+static Samples s_entryWait; // Beam to barrier up
+static Samples s_queueWait; // Arrival to barrier up
+static Samples s_exitWait;  // Exit beam to barrier up
+static Samples s_guideWait; // Through the entry to slot named
+static uint64_t s_entryStateUs[8];
+static uint64_t s_exitStateUs[8];
+static uint64_t s_lastSampleUs = 0;
+static uint8_t s_lastEntryState = 0;
+static uint8_t s_lastExitState = 0;
+static FILE* s_csv = nullptr;
+
+static void addSample(Samples& s, uint64_t us) {
+    uint32_t ms = (uint32_t)(us / 1000);
+    if (s.count < MAX_SAMPLES) s.values[s.count] = ms;
+    s.count++;
+    s.sum += ms;
+    if (ms > s.max) s.max = ms;
+}
+
+static int compareU32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// Nearest-rank percentiles over the kept samples
+static void percentiles(Samples& s, uint32_t& p50, uint32_t& p90, uint32_t& p99) {
+    uint32_t n = s.count < MAX_SAMPLES ? s.count : MAX_SAMPLES;
+    p50 = p90 = p99 = 0;
+    if (n == 0) return;
+    qsort(s.values, n, sizeof(uint32_t), compareU32);
+    p50 = s.values[(n - 1) * 50 / 100];
+    p90 = s.values[(n - 1) * 90 / 100];
+    p99 = s.values[(n - 1) * 99 / 100];
+}
+
+static uint32_t drawDwellMs() {
+    float seconds = s_dwellA;
+    switch (s_dwellKind) {
+        case DWELL_EXP: seconds = s_traffic.exponential(s_dwellA); break;
+        case DWELL_FIXED: break;
+        case DWELL_UNIFORM: seconds = s_dwellA + (s_dwellB - s_dwellA) * s_traffic.uniform(); break;
+        case DWELL_NORMAL: seconds = s_dwellA + s_dwellB * s_traffic.gaussian(); break;
+    }
+    uint32_t ms = seconds > 0 ? (uint32_t)(seconds * 1000) : 0;
+    return ms < MIN_DWELL_MS ? MIN_DWELL_MS : ms;
+}
+
+static bool parseDwell(const char* spec) {
+    float a = 0, b = 0;
+    if (sscanf(spec, "exp:%f", &a) == 1) {
+        s_dwellKind = DWELL_EXP;
+    } else if (sscanf(spec, "fixed:%f", &a) == 1) {
+        s_dwellKind = DWELL_FIXED;
+    } else if (sscanf(spec, "uniform:%f:%f", &a, &b) == 2 && b >= a) {
+        s_dwellKind = DWELL_UNIFORM;
+    } else if (sscanf(spec, "normal:%f:%f", &a, &b) == 2) {
+        s_dwellKind = DWELL_NORMAL;
+    } else {
+        return false;
+    }
+    s_dwellA = a;
+    s_dwellB = b;
+    snprintf(s_dwellSpec, sizeof(s_dwellSpec), "%s", spec);
+    return true;
+}
+
+static void scheduleArrival() {
+    float meanUs = 3600e6f / s_ratePerHour;
+    s_nextArrivalUs = SimClock::nowUs() + (uint64_t)s_traffic.exponential(meanUs);
+}
+
+// Beam change as the driver causes it (with contact bounce if configured)
+static void setBeam(uint8_t pin, bool present) {
+    if (s_bounce) SimIrBeam::bounce(pin, s_bounce * 2, 300);
+    SimIrBeam::setAfter(s_bounce * 600, pin, present);
+}
+
+static bool barrierUp() {
+    return SimHardware::barrierAngle() >= BARRIER_OPEN_ANGLE - 5;
+}
+
+static void go(Vehicle& v, VehicleStep step) {
+    v.step = step;
+    v.stepUs = SimClock::nowUs();
+}
+
+static uint64_t elapsedUs(const Vehicle& v) {
+    return SimClock::nowUs() - v.stepUs;
+}
+
+// CSV field: ms from fromUs to us, empty if it did not happen
+static void csvMs(uint64_t us, uint64_t fromUs) {
+    if (us) {
+        fprintf(s_csv, ",%llu", (unsigned long long)((us - fromUs) / 1000));
+    } else {
+        fputc(',', s_csv);
+    }
+}
+
+static void finish(Vehicle& v, const char* outcome) {
+    if (s_csv) {
+        fprintf(s_csv, "%lu,%s,", (unsigned long)v.id, outcome);
+        if (v.slot >= 0) fprintf(s_csv, "%d", v.slot + 1);
+        fprintf(s_csv, ",%.3f", (v.arriveUs - s_startUs) / 1e6);
+        csvMs(v.gateUs, v.arriveUs);
+        csvMs(v.entryOpenUs, v.arriveUs);
+        csvMs(v.parkedUs, v.arriveUs);
+        csvMs(v.leftSlotUs, v.arriveUs);
+        fprintf(s_csv, ",%lu", (unsigned long)v.dwellMs);
+        csvMs(v.exitGateUs, v.arriveUs);
+        csvMs(v.exitOpenUs, v.arriveUs);
+        csvMs(SimClock::nowUs(), v.arriveUs);
+        fprintf(s_csv, ",%d,%d\n", v.missedPark, v.missedDeparture);
+    }
+    v.step = V_FREE;
+}
+
+// Oldest vehicle in step by key (arrival for queues, pass order inside)
+static int8_t oldest(VehicleStep step, bool byPassSeq) {
+    int8_t found = -1;
+    for (uint8_t i = 0; i < MAX_VEHICLES; ++i) {
+        const Vehicle& v = s_vehicles[i];
+        if (v.step != step) continue;
+        if (found < 0) {
+            found = i;
+        } else if (byPassSeq ? v.passSeq < s_vehicles[found].passSeq : v.id < s_vehicles[found].id) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+static void arrive() {
+    s_arrivals++;
+    for (uint8_t i = 0; i < MAX_VEHICLES; ++i) {
+        Vehicle& v = s_vehicles[i];
+        if (v.step != V_FREE) continue;
+        memset(&v, 0, sizeof(v));
+        v.id = s_nextId++;
+        v.slot = -1;
+        v.arriveUs = SimClock::nowUs();
+        go(v, V_ENTRY_QUEUE);
+        return;
+    }
+    s_turnedAway++;
+}
+
+static SlotMask claimedSlots() {
+    SlotMask mask = 0;
+    for (uint8_t i = 0; i < MAX_VEHICLES; ++i) {
+        const Vehicle& v = s_vehicles[i];
+        if (v.slot >= 0 && (v.step == V_PARKING || v.step == V_PARKED)) mask |= slotBit(v.slot);
+    }
+    return mask;
+}
+
+static void stepVehicle(uint8_t index) {
+    Vehicle& v = s_vehicles[index];
+    uint64_t now = SimClock::nowUs();
+    switch (v.step) {
+        case V_FREE:
+        case V_ENTRY_QUEUE:
+        case V_WAIT_GUIDE:
+        case V_EXIT_QUEUE:
+            break; // Queues are served in order below
+
+        case V_AT_ENTRY:
+            if (simEntryBarrierOpen() && barrierUp()) {
+                v.entryOpenUs = now;
+                addSample(s_entryWait, now - v.gateUs);
+                addSample(s_queueWait, now - v.arriveUs);
+                s_admitted++;
+                go(v, V_ENTERING);
+            } else if (simEntryFull()) {
+                // "Garage Full": back out and drive on
+                s_rejectedFull++;
+                setBeam(PIN_IR_ENTRY, false);
+                s_entryBeam = -1;
+                s_entryFreeUs = now;
+                finish(v, "full");
+            } else if (simEntryIdle() && elapsedUs(v) >= MISSED_TIMEOUT_US) {
+                // Still IDLE with a car in the beam: pull back and try again
+                s_missedEntry++;
+                simLog("car %lu: entry beam ignored, pulling up again", (unsigned long)v.id);
+                SimIrBeam::set(PIN_IR_ENTRY, false);
+                SimIrBeam::setAfter(RETRIGGER_US, PIN_IR_ENTRY, true);
+                go(v, V_AT_ENTRY);
+            }
+            break;
+
+        case V_ENTERING:
+            if (elapsedUs(v) >= PASS_US) {
+                setBeam(PIN_IR_ENTRY, false);
+                s_entryBeam = -1;
+                s_entryFreeUs = now;
+                v.passSeq = s_passSeq++;
+                go(v, V_WAIT_GUIDE);
+            }
+            break;
+
+        case V_PARKING:
+            if (elapsedUs(v) >= PARK_US) {
+                SimUltrasonic::setDistanceCm(v.slot, PARKED_CM);
+                v.parkedUs = now;
+                v.dwellMs = drawDwellMs();
+                go(v, V_PARKED);
+            }
+            break;
+
+        case V_PARKED:
+            if (!v.missedPark && !(simParkedMask() & slotBit(v.slot)) &&
+                elapsedUs(v) >= MISSED_TIMEOUT_US && elapsedUs(v) < (uint64_t)v.dwellMs * 1000) {
+                v.missedPark = true;
+                s_missedPark++;
+            }
+            if (elapsedUs(v) >= (uint64_t)v.dwellMs * 1000) {
+                SimUltrasonic::setDistanceCm(v.slot, EMPTY_CM);
+                v.leftSlotUs = now;
+                go(v, V_TO_EXIT);
+            }
+            break;
+
+        case V_TO_EXIT:
+            if (elapsedUs(v) >= TO_EXIT_US) {
+                if (!v.missedPark && (simParkedMask() & slotBit(v.slot))) {
+                    v.missedDeparture = true; // Timer still running for a slot that is empty
+                    s_missedDeparture++;
+                }
+                go(v, V_EXIT_QUEUE);
+            }
+            break;
+
+        case V_AT_EXIT:
+            if (simExitBarrierOpen() && barrierUp()) {
+                v.exitOpenUs = now;
+                addSample(s_exitWait, now - v.exitGateUs);
+                go(v, V_EXITING);
+            } else if (simExitIdle() && elapsedUs(v) >= MISSED_TIMEOUT_US) {
+                s_missedExit++;
+                simLog("car %lu: exit beam ignored, pulling up again", (unsigned long)v.id);
+                SimIrBeam::set(PIN_IR_EXIT, false);
+                SimIrBeam::setAfter(RETRIGGER_US, PIN_IR_EXIT, true);
+                go(v, V_AT_EXIT);
+            }
+            break;
+
+        case V_EXITING:
+            if (elapsedUs(v) >= PASS_US) {
+                setBeam(PIN_IR_EXIT, false);
+                s_exitBeam = -1;
+                s_exitFreeUs = now;
+                s_completed++;
+                finish(v, "done");
+            }
+            break;
+    }
+}
+
+static void serveQueues() {
+    uint64_t now = SimClock::nowUs();
+
+    // Next car pulls into the entry beam once the previous one is clear
+    if (s_entryBeam < 0 && now - s_entryFreeUs >= HEADWAY_US) {
+        int8_t i = oldest(V_ENTRY_QUEUE, false);
+        if (i >= 0) {
+            s_entryBeam = i;
+            s_vehicles[i].gateUs = now;
+            setBeam(PIN_IR_ENTRY, true);
+            go(s_vehicles[i], V_AT_ENTRY);
+        }
+    }
+
+    // The platform guides cars in the order they came in; the driver follows
+    // the slot it names (flashing LED / LCD) once nobody else is heading there
+    int8_t guided = simGuidedSlot();
+    if (guided >= 0 && !(claimedSlots() & slotBit(guided))) {
+        int8_t i = oldest(V_WAIT_GUIDE, true);
+        if (i >= 0) {
+            Vehicle& v = s_vehicles[i];
+            v.slot = guided;
+            addSample(s_guideWait, now - v.stepUs);
+            go(v, V_PARKING);
+        }
+    }
+
+    if (s_exitBeam < 0 && now - s_exitFreeUs >= HEADWAY_US) {
+        int8_t i = oldest(V_EXIT_QUEUE, false);
+        if (i >= 0) {
+            s_exitBeam = i;
+            s_vehicles[i].exitGateUs = now;
+            setBeam(PIN_IR_EXIT, true);
+            go(s_vehicles[i], V_AT_EXIT);
+        }
+    }
+}
+
+bool simScenarioBegin(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--rate") && hasValue) {
+            s_ratePerHour = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--dwell") && hasValue) {
+            if (!parseDwell(argv[++i])) {
+                fprintf(stderr, "bad --dwell %s\n", argv[i]);
+                return false;
+            }
+        } else if (!strcmp(argv[i], "--prefill") && hasValue) {
+            int n = atoi(argv[++i]);
+            s_prefill = n < 0 ? 0 : (n > NUM_SLOTS ? NUM_SLOTS : n);
+        } else if (!strcmp(argv[i], "--noise") && hasValue) {
+            s_noiseCm = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--dropout") && hasValue) {
+            s_dropout = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--bounce") && hasValue) {
+            s_bounce = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--policy") && hasValue) {
+            s_policy = atoi(argv[++i]);
+            if (s_policy < 0 || s_policy >= POLICY_COUNT) {
+                fprintf(stderr, "--policy must be 0..%d\n", POLICY_COUNT - 1);
+                return false;
+            }
+        } else if (!strcmp(argv[i], "--out") && hasValue) {
+            s_outPrefix = argv[++i];
+        } else if (!strcmp(argv[i], "--seed") && hasValue) {
+            s_seed = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "--seconds") && hasValue) {
+            s_seconds = atof(argv[++i]);
+        }
+    }
+    if (s_ratePerHour <= 0) {
+        fprintf(stderr, "--rate must be > 0\n");
+        return false;
+    }
+
+    s_traffic.seed(s_seed * 2654435761u + 1);
+    SimUltrasonic::setNoise(s_noiseCm, s_dropout);
+    for (uint8_t slot = 0; slot < s_prefill; ++slot) {
+        SimUltrasonic::setDistanceCm(slot, PARKED_CM);
+    }
+    if (s_outPrefix) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s.csv", s_outPrefix);
+        s_csv = fopen(path, "w");
+        if (!s_csv) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return false;
+        }
+        fprintf(s_csv, "id,outcome,slot,arrive_s,gate_ms,entry_open_ms,parked_ms,left_slot_ms,"
+                       "dwell_ms,exit_gate_ms,exit_open_ms,done_ms,missed_park,missed_departure\n");
+    }
+    scheduleArrival();
+    return true;
+}
+
+void simScenarioStep() {
+    uint64_t now = SimClock::nowUs();
+    if (s_startUs == 0) {
+        // First step: setup() is done, the clock starts here
+        s_startUs = now;
+        s_lastSampleUs = now;
+        s_lastEntryState = simEntryState();
+        s_lastExitState = simExitState();
+        if (s_policy >= 0) {
+            // Over the command link like an operator would (handled in the next loop pass)
+            char command[20];
+            snprintf(command, sizeof(command), "POLICY %d\n", s_policy);
+            SimSerial::inject(command);
+        }
+    }
+
+    // Time per state, charged to the state seen at the previous step
+    s_entryStateUs[s_lastEntryState & 7] += now - s_lastSampleUs;
+    s_exitStateUs[s_lastExitState & 7] += now - s_lastSampleUs;
+    s_lastSampleUs = now;
+    s_lastEntryState = simEntryState();
+    s_lastExitState = simExitState();
+
+    if (now < s_nextTickUs) return;
+    s_nextTickUs = now + TICK_US;
+
+    while (now >= s_nextArrivalUs) {
+        arrive();
+        s_nextArrivalUs += (uint64_t)s_traffic.exponential(3600e6f / s_ratePerHour);
+    }
+    for (uint8_t i = 0; i < MAX_VEHICLES; ++i) {
+        if (s_vehicles[i].step != V_FREE) stepVehicle(i);
+    }
+    serveQueues();
+}
+
+static void writeWait(FILE* f, const char* name, Samples& s, bool last) {
+    uint32_t p50, p90, p99;
+    percentiles(s, p50, p90, p99);
+    fprintf(f, "    \"%s\": {\"n\": %lu, \"mean\": %.1f, \"p50\": %lu, \"p90\": %lu, \"p99\": %lu, \"max\": %lu}%s\n",
+            name, (unsigned long)s.count, s.count ? (double)s.sum / s.count : 0.0, (unsigned long)p50,
+            (unsigned long)p90, (unsigned long)p99, (unsigned long)s.max, last ? "" : ",");
+}
+
+static void writeSummary(FILE* f, double hours, unsigned long inSystem) {
+    double total = (SimClock::nowUs() - s_startUs) / 1e6;
+    fprintf(f, "{\n");
+    fprintf(f, "  \"config\": {\"slots\": %u, \"seconds\": %.0f, \"seed\": %lu, \"rate_per_hour\": %.2f, "
+               "\"dwell\": \"%s\", \"prefill\": %u, \"noise_cm\": %.2f, \"dropout\": %.3f, \"bounce\": %u, "
+               "\"policy\": %u},\n",
+            NUM_SLOTS, s_seconds, (unsigned long)s_seed, s_ratePerHour, s_dwellSpec, s_prefill, s_noiseCm,
+            s_dropout, s_bounce, simAllocationPolicy());
+    fprintf(f, "  \"vehicles\": {\"arrivals\": %lu, \"admitted\": %lu, \"completed\": %lu, "
+               "\"rejected_full\": %lu, \"turned_away\": %lu, \"in_system\": %lu},\n",
+            s_arrivals, s_admitted, s_completed, s_rejectedFull, s_turnedAway, inSystem);
+    fprintf(f, "  \"vehicles_per_hour\": %.2f,\n", hours > 0 ? s_completed / hours : 0.0);
+    fprintf(f, "  \"admitted_per_hour\": %.2f,\n", hours > 0 ? s_admitted / hours : 0.0);
+    // Firmware's own estimate of the platform time its policy saved against first-free
+    unsigned long allocations = simAllocations();
+    fprintf(f, "  \"allocation\": {\"allocations\": %lu, \"saved_ms\": %ld, \"mean_saved_ms\": %.1f},\n",
+            allocations, simAllocationSavedMs(), allocations ? (double)simAllocationSavedMs() / allocations : 0.0);
+    fprintf(f, "  \"wait_ms\": {\n");
+    writeWait(f, "entry_gate", s_entryWait, false);
+    writeWait(f, "entry_queue", s_queueWait, false);
+    writeWait(f, "guidance", s_guideWait, false);
+    writeWait(f, "exit_gate", s_exitWait, true);
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"entry_state_s\": {");
+    for (uint8_t i = 0; i < simEntryStateCount(); ++i) {
+        fprintf(f, "%s\"%s\": %.3f", i ? ", " : "", simEntryStateName(i), s_entryStateUs[i] / 1e6);
+    }
+    fprintf(f, "},\n  \"exit_state_s\": {");
+    for (uint8_t i = 0; i < simExitStateCount(); ++i) {
+        fprintf(f, "%s\"%s\": %.3f", i ? ", " : "", simExitStateName(i), s_exitStateUs[i] / 1e6);
+    }
+    // Transition table coverage: every row should be taken in a long enough run
+    uint8_t covered = 0;
+    for (uint8_t i = 0; i < simEntryTransitionCount(); ++i) {
+        if (simEntryTransitionHits(i)) covered++;
+    }
+    fprintf(f, "},\n  \"entry_fsm\": {\"rows\": %u, \"covered\": %u, \"unhandled\": %lu, \"hits\": {",
+            simEntryTransitionCount(), covered, simEntryUnhandled());
+    for (uint8_t i = 0; i < simEntryTransitionCount(); ++i) {
+        char label[48];
+        simEntryTransitionLabel(i, label, sizeof(label));
+        fprintf(f, "%s\"%s\": %u", i ? ", " : "", label, simEntryTransitionHits(i));
+    }
+    fprintf(f, "}},\n  \"measured_s\": %.3f,\n", total);
+    fprintf(f, "  \"missed\": {\"entry\": %lu, \"exit\": %lu, \"park\": %lu, \"departure\": %lu, "
+               "\"lost_departures\": %lu, \"ir_glitches\": %lu, \"ir_event_drops\": %lu, \"ir_overflows\": %lu}\n",
+            s_missedEntry, s_missedExit, s_missedPark, s_missedDeparture, simLostDepartures(),
+            simIrGlitches(), simIrEventDrops(), simIrOverflows());
+    fprintf(f, "}\n");
+}
+
+void simScenarioEnd() {
+    unsigned long inSystem = 0;
+    for (uint8_t i = 0; i < MAX_VEHICLES; ++i) {
+        if (s_vehicles[i].step != V_FREE) inSystem++;
+    }
+    double hours = (SimClock::nowUs() - s_startUs) / 3600e6;
+
+    if (s_csv) {
+        fclose(s_csv);
+        s_csv = nullptr;
+    }
+    if (s_outPrefix) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s.json", s_outPrefix);
+        FILE* f = fopen(path, "w");
+        if (f) {
+            writeSummary(f, hours, inSystem);
+            fclose(f);
+        } else {
+            fprintf(stderr, "cannot write %s\n", path);
+        }
+    }
+    if (!simQuiet() || !s_outPrefix) writeSummary(stdout, hours, inSystem);
+}